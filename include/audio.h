@@ -2,21 +2,63 @@
 
 #include "buffer.h"
 #include <stdbool.h>
+#include <stdint.h>
+#include <poll.h>
 
-typedef int input_callback_t(float_buffer_t *buf);
+#define AUD_CHANNELS_MAX 8
+#define AUD_PERIOD_FRAMES_MAX 8192
+#define AUD_POLL_FDS_MAX 4
+
+// Called once per channel with that channel's de-interleaved samples.
+// In mmap mode with a single channel, buf points straight into the capture DMA area.
+typedef int input_callback_t(int channel, float_buffer_t *buf);
+
+typedef struct aud_params
+{
+    const char *device_name;
+    int sample_rate;
+    int channels;
+    bool do_input;
+    bool do_output;
+    bool use_mmap; // Access DMA areas directly, falls back to read/write if unsupported
+    int period_ms;
+    int buffer_ms;     // 0 for 4 periods
+    int period_max_ms; // Xruns grow the period up to this, 0 to keep it fixed
+    const char *sample_format; // S16, S24, S24_3, S32 or F32, NULL or "auto" for the first one the device supports
+} aud_params_t;
 
 // Lifecycle
 int aud_initialize();
 void aud_terminate();
 
 // Configuration
-int aud_configure(const char *device_name, int sample_rate, bool do_input, bool do_output);
+int aud_configure(const aud_params_t *params);
 int aud_start();
 
+// Channels the configured streams were negotiated with
+int aud_channels(void);
+
 // Streaming
-void aud_output(const float_buffer_t *buf);
+void aud_output(int channel, const float_buffer_t *buf);
+
+// Samples a channel should be topped up with, keeps about one device buffer queued ahead of playback
+int aud_output_space(int channel);
+
+// Samples queued on a channel since start, the position the next aud_output sample gets
+uint64_t aud_output_position(int channel);
+
+// Estimated monotonic time (ns) the sample at pos reaches the DAC, false until it was handed to the device
+bool aud_output_play_time(int channel, uint64_t pos, int64_t *ns);
 
-// Audio processing
+// Monotonic time (ns) the first frame of the block being passed to the input callback was captured
+int64_t aud_capture_block_time(void);
+
+// True while any channel has samples waiting for playback
+bool aud_output_pending(void);
+
+#define AUD_ERR_LOST -2 // Streams could not be restarted after a period change
+
+// Audio processing. Returns 0 when periods were processed, -1 when none were available, AUD_ERR_LOST.
 int aud_process_capture(input_callback_t *callback, float_buffer_t *buf);
 void aud_process_playback(void);
 
@@ -26,3 +68,10 @@ bool aud_process_playback_period(void);
 
 // Get poll descriptor for integration with poll/epoll/select
 int aud_get_poll_fd(void);
+
+// Playback poll descriptors with the events to watch, only while aud_output_pending()
+int aud_get_playback_poll_fds(struct pollfd *pfds, int max);
+
+// Handles readiness of one playback descriptor: writes queued periods the device has room for
+// and recovers errors. Returns true while output is still pending.
+bool aud_process_playback_event(int fd, unsigned short revents);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <stdint.h>
+
+#define BITARR_WORD_BITS 64
+#define BITARR_WORDS(bits) (((bits) + BITARR_WORD_BITS - 1) / BITARR_WORD_BITS)
+
+// Packed bitstream over caller provided words, bit i is bit (i % 64) of word i / 64
+typedef struct bitarr
+{
+    uint64_t *words;
+    int capacity; // In bits
+    int size;
+} bitarr_t;
+
+void bitarr_init(bitarr_t *ba, uint64_t *words, int capacity);
+
+void bitarr_clear(bitarr_t *ba);
+
+static inline int bitarr_get(const bitarr_t *ba, int i)
+{
+    return (int)(ba->words[i / BITARR_WORD_BITS] >> (i % BITARR_WORD_BITS)) & 1;
+}
+
+// Last bit appended, 0 when empty (the idle NRZI level)
+static inline int bitarr_last(const bitarr_t *ba)
+{
+    return ba->size > 0 ? bitarr_get(ba, ba->size - 1) : 0;
+}
+
+// Returns 0 on success, -1 if full
+int bitarr_append(bitarr_t *ba, int bit);
+
+// Appends n bits given one per byte, as the HDLC framer emits them. Returns -1 without appending if they do not fit.
+int bitarr_append_bytes(bitarr_t *ba, const uint8_t *bits, int n);
+
+// NRZI encodes count copies of byte (LSB first) continuing from the last level, e.g. 0x7E for flags.
+// Returns -1 without appending if they do not fit.
+int bitarr_append_nrzi_byte(bitarr_t *ba, uint8_t byte, int count);
+
+// Appends n NRZI levels of a segment opening with a 0 bit (an HDLC flag), inverted if needed so
+// that bit is a transition from the last level. NRZI is polarity independent.
+// Returns -1 without appending if they do not fit.
+int bitarr_append_nrzi_levels(bitarr_t *ba, const uint8_t *levels, int n);
+
+// Removes the first n bits, shifting the rest down
+void bitarr_drop_front(bitarr_t *ba, int n);
@@ -15,8 +15,14 @@ typedef struct bitclk_pll
     int signal_quality;
     int data_detect;
 
+    uint32_t dcd_history; // Transitions within the DCD window, drives data_detect
+    int bits_since_transition;
+
 } bitclk_t;
 
 void bitclk_init(bitclk_t *detector, float sample_rate, float bit_rate);
 
 int bitclk_detect(bitclk_t *detector, float soft_bit);
+
+// Runs n soft bits through the PLL, stores sampled bits (at most n) and returns their count
+int bitclk_detect_block(bitclk_t *detector, const float *soft_bits, int n, int *out_bits);
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// p-persistent CSMA channel access, KISS semantics: key up with probability (persist + 1) / 256
+// in each slot the channel is clear, wait a slot when it is busy or the draw fails
+
+#define CSMA_PERSIST_DEFAULT 63
+#define CSMA_SLOTTIME_MS_DEFAULT 100
+
+typedef enum csma_decision
+{
+    CSMA_WAIT = 0,
+    CSMA_TRANSMIT,
+} csma_decision_t;
+
+typedef struct csma_params
+{
+    int persist;     // 0-255
+    int slottime_ms; // Wait between attempts
+    bool full_duplex; // Ignore the channel state and transmit at once
+} csma_params_t;
+
+typedef struct csma
+{
+    csma_params_t params;
+    uint32_t rng;
+    uint64_t next_slot_ms; // No attempt before this, 0 when idle
+} csma_t;
+
+extern csma_params_t csma_params_default;
+
+void csma_init(csma_t *csma, const csma_params_t *params, uint32_t seed);
+
+// Called while frames are waiting. On CSMA_WAIT, *wait_ms holds the time until the next attempt.
+csma_decision_t csma_poll(csma_t *csma, bool busy, uint64_t now_ms, int *wait_ms);
+
+// Forgets the pending slot, to be called once the queued frames have been sent
+void csma_reset(csma_t *csma);
@@ -0,0 +1,25 @@
+#ifndef DECIM_H
+#define DECIM_H
+
+// Polyphase FIR decimator: windowed-sinc anti-alias low-pass evaluated only at output
+// instants. The history is stored twice so every output is one contiguous dot product.
+typedef struct decim
+{
+    int factor;
+    int taps;
+    int phase;
+    int pos;
+    float *coeffs;  // Time reversed, taps entries
+    float *history; // 2 * taps entries
+} decim_t;
+
+// passband_freq is the highest frequency of interest, the stopband starts where
+// its alias would land (output rate - passband_freq)
+void decim_init(decim_t *decim, int factor, float sample_rate, float passband_freq);
+
+// Returns the number of output samples written, at most n / factor + 1
+int decim_process_block(decim_t *decim, const float *in, float *out, int n);
+
+void decim_free(decim_t *decim);
+
+#endif
@@ -8,11 +8,17 @@
 #include "filter.h"
 #include "synth.h"
 
-typedef struct demod_goertzel
+// Delay line and mark/space Goertzel pair, shareable between demodulators with equal windows
+typedef struct demod_goertzel_front
 {
     ring_simple_t ring;
     goertzel_t mark_grz;
     goertzel_t space_grz;
+} demod_grz_front_t;
+
+typedef struct demod_goertzel
+{
+    demod_grz_front_t front;
     agc_t mark_agc;
     agc_t space_agc;
     float sym_clip;
@@ -32,6 +38,12 @@ typedef struct demod_goertzel_params
 extern demod_grz_params_t grz_params_optim;
 extern demod_grz_params_t grz_params_pesim;
 
+typedef enum demod_quad_disc
+{
+    QUAD_DISC_ATAN2 = 0, // Phase difference of atan2f, unwrapped
+    QUAD_DISC_CROSS,     // Cross product of consecutive I/Q over instantaneous power, no atan2f
+} demod_quad_disc_t;
+
 typedef struct demod_quad
 {
     float lo_i_prev;
@@ -39,9 +51,11 @@ typedef struct demod_quad
     float cos_inc;
     float sin_inc;
     float prev_phase;
+    float i_prev;
+    float q_prev;
     float scale;
-    bf_lpf_t i_lpf;
-    bf_lpf_t q_lpf;
+    demod_quad_disc_t disc;
+    bf_mlpf_t iq_lpf; // I in lane 0, Q in lane 1
     bf_lpf_t post_filter;
 } demod_quad_t;
 
@@ -51,15 +65,18 @@ typedef struct demod_quad_params
     float iq_lpf_cutoff_mul;
     int post_lpf_order;
     float post_lpf_cutoff_mul;
+    demod_quad_disc_t disc;
 } demod_quad_params_t;
 
 extern demod_quad_params_t quad_params_default;
+extern demod_quad_params_t quad_params_fast;
 
 typedef enum demod_type
 {
     DEMOD_GOERTZEL_OPTIM = 1 << 0,
     DEMOD_GOERTZEL_PESIM = 1 << 1,
     DEMOD_QUADRATURE = 1 << 2,
+    DEMOD_QUADRATURE_FAST = 1 << 3,
     // Convenience values for multiple selections
     DEMOD_ALL_GOERTZEL = DEMOD_GOERTZEL_OPTIM | DEMOD_GOERTZEL_PESIM,
     DEMOD_ALL = DEMOD_ALL_GOERTZEL | DEMOD_QUADRATURE,
@@ -91,12 +108,23 @@ void demod_grz_init(demod_grz_t *demod, demod_params_t *params, demod_grz_params
 
 float demod_grz_process(demod_grz_t *demod, float sample);
 
+void demod_grz_process_block(demod_grz_t *demod, const float *in, float *out, int n);
+
+void demod_grz_front_process_block(demod_grz_front_t *front, const float *in, float *mark_out, float *space_out, int n);
+
+// Back-end half of demod_grz_process_block, fed with front-end mark/space powers
+void demod_grz_back_process_block(demod_grz_t *demod, const float *mark, const float *space, float *out, int n);
+
+int demod_grz_front_equal(const demod_grz_front_t *a, const demod_grz_front_t *b);
+
 void demod_grz_free(demod_grz_t *demod);
 
 void demod_quad_init(demod_quad_t *demod, demod_params_t *params, demod_quad_params_t *adv_params);
 
 float demod_quad_process(demod_quad_t *demod, float sample);
 
+void demod_quad_process_block(demod_quad_t *demod, const float *in, float *out, int n);
+
 void demod_quad_free(demod_quad_t *demod);
 
 // "Abstract" functions
@@ -105,6 +133,9 @@ void demod_init(demod_t *demod, demod_type_t type, demod_params_t *params);
 
 float demod_process(demod_t *demod, float sample);
 
+// Demodulates n samples from in to out, dispatching on type once per block
+void demod_process_block(demod_t *demod, const float *in, float *out, int n);
+
 void demod_free(demod_t *demod);
 
 #endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Event loop over epoll with an fd-indexed dispatch table, every ready fd goes straight to its handler.
+// Event masks use poll(2) bits (POLLIN, POLLOUT, ...), which epoll shares.
+
+#define EVLOOP_MAX_FDS 1024
+#define EVLOOP_MAX_EVENTS 64
+
+typedef void evloop_handler_t(int fd, uint32_t revents, void *ctx);
+
+typedef struct evloop_entry
+{
+    evloop_handler_t *handler; // NULL for unregistered fds
+    void *ctx;
+    uint32_t events;
+    bool always_ready; // Regular files cannot be watched by epoll and are always readable
+} evloop_entry_t;
+
+typedef struct evloop
+{
+    int epoll_fd;
+    int always_ready_count;
+    evloop_entry_t entries[EVLOOP_MAX_FDS];
+} evloop_t;
+
+int evloop_init(evloop_t *loop);
+
+// Returns 0 on success, -1 on error
+int evloop_add(evloop_t *loop, int fd, uint32_t events, evloop_handler_t *handler, void *ctx);
+
+int evloop_modify(evloop_t *loop, int fd, uint32_t events);
+
+int evloop_remove(evloop_t *loop, int fd);
+
+// Waits up to timeout_ms, dispatches ready fds and returns their count, -1 on error (errno set)
+int evloop_run_once(evloop_t *loop, int timeout_ms);
+
+void evloop_free(evloop_t *loop);
@@ -1,14 +1,21 @@
 #pragma once
 
+// Butterworth cascades keep coefficients and state of each second (or fourth) order
+// section packed together in a single allocation. Kernels are unrolled for 1-3 sections.
+
+typedef struct bf_spf_section
+{
+    float A;
+    float d1;
+    float d2;
+    float w1;
+    float w2;
+} bf_spf_section_t;
+
 typedef struct bf_spf
 {
     int n;
-    float *A;
-    float *d1;
-    float *d2;
-    float *w0;
-    float *w1;
-    float *w2;
+    bf_spf_section_t *sections;
 } bf_spf_t;
 
 typedef bf_spf_t bf_lpf_t;
@@ -19,39 +26,83 @@ void bf_lpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_ra
 
 float bf_lpf_filter(bf_spf_t *filter, float sample);
 
+// Filters n samples, in and out may point to the same buffer
+void bf_lpf_filter_block(bf_spf_t *filter, const float *in, float *out, int n);
+
 void bf_lpf_free(bf_spf_t *filter);
 
 void bf_hpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_rate);
 
 float bf_hpf_filter(bf_spf_t *filter, float sample);
 
+void bf_hpf_filter_block(bf_spf_t *filter, const float *in, float *out, int n);
+
 void bf_hpf_free(bf_spf_t *filter);
 
 //
 
+typedef struct bf_bpf_section
+{
+    float A;
+    float d1;
+    float d2;
+    float d3;
+    float d4;
+    float w1;
+    float w2;
+    float w3;
+    float w4;
+} bf_bpf_section_t;
+
 typedef struct bf_bpf
 {
     int n;
-    float *A;
-    float *d1;
-    float *d2;
-    float *d3;
-    float *d4;
-    float *w0;
-    float *w1;
-    float *w2;
-    float *w3;
-    float *w4;
+    bf_bpf_section_t *sections;
 } bf_bpf_t;
 
 void bf_bpf_init(bf_bpf_t *filter, int order, float low_cutoff_freq, float high_cutoff_freq, float sample_rate);
 
 float bf_bpf_filter(bf_bpf_t *filter, float sample);
 
+void bf_bpf_filter_block(bf_bpf_t *filter, const float *in, float *out, int n);
+
 void bf_bpf_free(bf_bpf_t *filter);
 
 //
 
+// Multi-lane LPF: BF_LANES independent filters with identical coefficients advanced
+// together in one vector register, sized for the I and Q branches of a quadrature mixer
+#define BF_LANES 2
+
+typedef float bf_lanes_t __attribute__((vector_size(BF_LANES * sizeof(float))));
+
+typedef struct bf_mlpf_section
+{
+    bf_lanes_t A;
+    bf_lanes_t d1;
+    bf_lanes_t d2;
+    bf_lanes_t w1;
+    bf_lanes_t w2;
+} bf_mlpf_section_t;
+
+typedef struct bf_mlpf
+{
+    int n;
+    bf_mlpf_section_t *sections;
+} bf_mlpf_t;
+
+void bf_mlpf_init(bf_mlpf_t *filter, int order, float cutoff_freq, float sample_rate);
+
+// Advances every lane by one sample
+bf_lanes_t bf_mlpf_filter(bf_mlpf_t *filter, bf_lanes_t samples);
+
+// Advances every lane by n samples, in and out may be the same buffer
+void bf_mlpf_process_block(bf_mlpf_t *filter, const bf_lanes_t *in, bf_lanes_t *out, int n);
+
+void bf_mlpf_free(bf_mlpf_t *filter);
+
+//
+
 typedef struct bf_biquad
 {
     int n;
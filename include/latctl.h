@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+
+// Audio period controller: grows the period on repeated xruns, shrinks it back after a calm spell
+
+typedef struct latctl_params
+{
+    int min_ms;     // Configured period, never shrunk below
+    int max_ms;     // Upper bound for growth
+    int xrun_limit; // Xruns within window_ms that trigger growth
+    int window_ms;
+    int calm_ms; // Xrun-free time before shrinking
+} latctl_params_t;
+
+typedef struct latctl
+{
+    latctl_params_t params;
+    int period_ms;
+    int window_xruns;
+    uint64_t window_start_ms;
+    uint64_t last_event_ms; // Last xrun or resize
+    uint64_t total_xruns;
+} latctl_t;
+
+extern latctl_params_t latctl_params_default;
+
+void latctl_init(latctl_t *ctl, int period_ms, int max_ms, const latctl_params_t *params, uint64_t now_ms);
+
+// Returns new period in ms if it should change, 0 otherwise
+int latctl_xrun(latctl_t *ctl, uint64_t now_ms);
+
+// Returns new period in ms if it should change, 0 otherwise
+int latctl_tick(latctl_t *ctl, uint64_t now_ms);
+
+// Takes back a period change that could not be applied, clamped to the configured bounds
+void latctl_set_period(latctl_t *ctl, int period_ms, uint64_t now_ms);
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Process-wide registry of counters and gauges. Metrics are registered at startup; updates are lock-free,
+// counters are sharded per thread so concurrent increments do not contend on one cache line.
+// Every update accepts NULL, so code paths without registered metrics (tests, mw_bench) pay a branch.
+
+#define METRICS_MAX 256
+#define METRICS_SHARDS 8
+#define METRICS_LABELS_SIZE 64
+#define METRICS_HISTOGRAMS_MAX 16
+#define METRICS_RESPONSE_SIZE 65536
+
+// Log-linear buckets: exact below 2^METRICS_HIST_SUB_BITS, then that many sub-buckets per power of two,
+// so any recorded value is within 1/32 (about 3%) of its bucket's bounds. 1024 buckets reach 2^36 us (19 h),
+// the last bucket catches everything above.
+#define METRICS_HIST_SUB_BITS 5
+#define METRICS_HIST_BUCKETS 1024
+
+typedef enum metric_type
+{
+    METRIC_COUNTER = 0,
+    METRIC_GAUGE,
+} metric_type_t;
+
+typedef struct metrics_shard
+{
+    _Atomic uint64_t value;
+    char pad[64 - sizeof(uint64_t)];
+} metrics_shard_t;
+
+typedef struct metric
+{
+    const char *name; // Prometheus metric name, entries sharing it differ by labels
+    const char *help;
+    metric_type_t type;
+    char labels[METRICS_LABELS_SIZE]; // Prometheus label list without braces, e.g. channel="0"
+    atomic_bool hidden;               // Left out of reports, e.g. gauges of disconnected clients
+    metrics_shard_t shards[METRICS_SHARDS]; // Gauges use shards[0]
+} metric_t;
+
+// Latency distribution in microseconds, each histogram is expected to have a single writer thread
+typedef struct metrics_histogram
+{
+    const char *name; // Exposed in seconds, so it should end in _seconds
+    const char *help;
+    char labels[METRICS_LABELS_SIZE];
+    _Atomic uint64_t counts[METRICS_HIST_BUCKETS];
+    _Atomic uint64_t sum;
+    _Atomic uint64_t max;
+} metrics_histogram_t;
+
+extern _Thread_local int metrics_thread_shard;
+
+int metrics_shard_assign(void);
+
+// Returns NULL once the registry is full, labels is a printf format
+metric_t *metrics_counter(const char *name, const char *help, const char *labels, ...);
+
+metric_t *metrics_gauge(const char *name, const char *help, const char *labels, ...);
+
+metrics_histogram_t *metrics_histogram(const char *name, const char *help, const char *labels, ...);
+
+static inline int metrics_histogram_bucket(uint64_t us)
+{
+    if (us < (1u << METRICS_HIST_SUB_BITS))
+        return (int)us;
+
+    int e = 63 - __builtin_clzll(us);
+    int sub = (int)(us >> (e - METRICS_HIST_SUB_BITS)) & ((1 << METRICS_HIST_SUB_BITS) - 1);
+    int bucket = ((e - METRICS_HIST_SUB_BITS + 1) << METRICS_HIST_SUB_BITS) + sub;
+    return bucket < METRICS_HIST_BUCKETS ? bucket : METRICS_HIST_BUCKETS - 1;
+}
+
+// Smallest value falling into a bucket
+uint64_t metrics_histogram_bucket_low(int bucket);
+
+static inline void metrics_observe(metrics_histogram_t *h, uint64_t us)
+{
+    if (h == NULL)
+        return;
+    atomic_fetch_add_explicit(&h->counts[metrics_histogram_bucket(us)], 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&h->sum, us, memory_order_relaxed);
+    if (us > atomic_load_explicit(&h->max, memory_order_relaxed))
+        atomic_store_explicit(&h->max, us, memory_order_relaxed);
+}
+
+uint64_t metrics_histogram_count(const metrics_histogram_t *h);
+
+// Upper bound of the bucket holding the given percentile (0-100), 0 while empty
+uint64_t metrics_histogram_percentile(const metrics_histogram_t *h, double percentile);
+
+static inline void metrics_add(metric_t *m, uint64_t n)
+{
+    if (m == NULL)
+        return;
+    int shard = metrics_thread_shard >= 0 ? metrics_thread_shard : metrics_shard_assign();
+    atomic_fetch_add_explicit(&m->shards[shard].value, n, memory_order_relaxed);
+}
+
+static inline void metrics_inc(metric_t *m)
+{
+    metrics_add(m, 1);
+}
+
+static inline void metrics_set(metric_t *m, int64_t value)
+{
+    if (m != NULL)
+        atomic_store_explicit(&m->shards[0].value, (uint64_t)value, memory_order_relaxed);
+}
+
+static inline void metrics_hide(metric_t *m, bool hidden)
+{
+    if (m != NULL)
+        atomic_store_explicit(&m->hidden, hidden, memory_order_relaxed);
+}
+
+// Counter total or gauge value
+int64_t metrics_value(const metric_t *m);
+
+// Render every visible metric, return the length written or -1 if it does not fit
+int metrics_render_text(char *buf, int capacity);
+
+int metrics_render_json(char *buf, int capacity);
+
+// Response to one stats client, written out as its socket becomes writable
+typedef struct metrics_response
+{
+    char data[METRICS_RESPONSE_SIZE];
+    int len;
+    int sent;
+} metrics_response_t;
+
+// Renders the answer to one stats client request. HTTP GET requests get an HTTP response, JSON for paths
+// containing "json"; a bare "json" line gets raw JSON, anything else raw text. Returns the response length.
+int metrics_respond(metrics_response_t *resp, const char *request, int len);
+
+// Writes what is left of the response without blocking. Returns bytes left, -1 on a socket error.
+int metrics_response_flush(metrics_response_t *resp, int fd);
@@ -10,17 +10,55 @@
 #include "tcp.h"
 #include "udp.h"
 #include "uds.h"
-#include "poller.h"
+#include "evloop.h"
+#include "audio.h"
+#include "csma.h"
+#include "output.h"
+#include "tstamp.h"
 #include <time.h>
+#include <stdbool.h>
+#include <stdint.h>
 
-typedef struct miniwolf_state
+#define MW_METRICS_CLIENTS_MAX 4
+#define MW_METRICS_CLIENT_TIMEOUT_MS 5000 // A response not written by then frees its buffer for another client
+
+// Stats client whose response is being written as its socket becomes writable
+typedef struct mw_metrics_client
+{
+    int fd; // -1 when the buffer is free
+    uint64_t started_ms;
+    metrics_response_t response;
+} mw_metrics_client_t;
+
+// Per audio channel DSP state, exposed as KISS port of the same index
+typedef struct mw_channel
 {
-    // DSP components
     agc_t input_agc;
     sql_t squelch;
     modem_t modem;
     bf_biquad_t hbf_filter;
 
+    // Channel access, keyed from the CSMA grant until playback drains
+    csma_t csma;
+    bool keyed;
+    bool squelch_open;
+
+    // RX latency: capture time of the blocks fed to the modem, by modem sample position
+    tstamp_map_t rx_clock;
+    uint64_t rx_samples;
+
+    // TX latency: arrival of the first frame of the next burst, then the output position the burst starts at
+    int64_t tx_in_ns; // 0 while no frame is being timed
+    uint64_t tx_start_pos;
+    bool tx_timing; // Burst keyed, waiting for its first sample to be handed to the device
+} mw_channel_t;
+
+typedef struct miniwolf_state
+{
+    // DSP components
+    mw_channel_t channels[AUD_CHANNELS_MAX];
+    int channel_count;
+
     // Input readers
     line_reader_t stdin_line_reader;
     line_reader_t tcp_line_reader;
@@ -37,7 +75,11 @@ typedef struct miniwolf_state
     udp_server_t udp_tnc2_server;
     uds_server_t uds_kiss_server;
     uds_server_t uds_tnc2_server;
-    socket_poller_t poller;
+    tcp_server_t metrics_tcp_server;
+    uds_server_t metrics_uds_server;
+    mw_metrics_client_t metrics_clients[MW_METRICS_CLIENTS_MAX];
+    evloop_t evloop;
+    output_t output; // Encodes and writes received frames on its own thread
 
     // Configuration flags
     int kiss_mode;
@@ -49,10 +91,27 @@ typedef struct miniwolf_state
     int udp_tnc2_listen_enabled;
     int uds_kiss_enabled;
     int uds_tnc2_enabled;
+    int metrics_tcp_enabled;
+    int metrics_uds_enabled;
     int squelch_enabled;
+    int rx_threads_enabled;
+    bool csma_squelch;
 
     // Audio
     int audio_fd;
+    struct pollfd playback_fds[AUD_POLL_FDS_MAX]; // Watched only while playback_armed
+    int playback_fd_count;
+    bool playback_armed;
+
+    // Fires when the earliest waiting channel may retry channel access
+    int csma_timer_fd;
+
+    metrics_histogram_t *tx_latency; // Frame in -> first sample of its burst at the DAC
+
+    // Loop statistics, idle wakeups are timeouts with no fd ready
+    uint64_t wakeups;
+    uint64_t idle_wakeups;
+    time_t stats_since;
 
     // Timing
     time_t max_idle_time;
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "bitarr.h"
 #include "buffer.h"
-#include "synth.h"
+#include <stdint.h>
+
+#define MOD_LUT_BITS 10
+#define MOD_LUT_SIZE (1 << MOD_LUT_BITS)
 
 typedef struct modulator
 {
@@ -9,11 +13,25 @@ typedef struct modulator
     float space_freq;
     float baud_rate;
     float sample_rate;
-    synth_t fsk_synth;
+
+    uint32_t phase; // NCO phase, 2^32 = one full cycle
+    uint32_t mark_step;
+    uint32_t space_step;
+    uint64_t bit_num;   // Samples per bit as the exact ratio bit_num / bit_den
+    uint64_t bit_den;
+    uint64_t bit_clock; // Fractional sample position carried into the next bit, in 1 / bit_den units
 } modulator_t;
 
 void mod_init(modulator_t *mod, float mark_freq, float space_freq, float baud_rate, float sample_rate);
 
-int mod_process(modulator_t *mod, int bit, float_buffer_t *out_samples_buf);
+// Number of samples mod_process would generate for bit_count bits from the current bit clock
+int mod_samples_for_bits(const modulator_t *mod, int bit_count);
+
+// Largest number of whole bits whose samples fit in sample_count
+int mod_bits_for_samples(const modulator_t *mod, int sample_count);
+
+// Appends samples for bits [start, start + bit_count) of bits to out_samples_buf.
+// Returns the number of samples written, -1 without touching state if they do not fit.
+int mod_process(modulator_t *mod, const bitarr_t *bits, int start, int bit_count, float_buffer_t *out_samples_buf);
 
 void mod_free(modulator_t *mod);
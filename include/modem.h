@@ -4,63 +4,179 @@
 #include "hldc.h"
 #include "demod.h"
 #include "bitclk.h"
+#include "decim.h"
 #include "buffer.h"
+#include "metrics.h"
 #include <time.h>
+#include <stdbool.h>
+#include <stdatomic.h>
 
 #define MD_RX_MAX 6
+#define MD_RX_FRAME_MAX 512
+#define MD_RX_DECIM_MIN_RATE 20000.0f // Lowest internal rate chosen by md_multi_rx_decimation
+#define MD_RX_ECHO_MAX 32
+#define MD_RX_ECHO_S 2 // Own frames decoded back this long after their last bit was rendered are suppressed
 
 struct md_rx
 {
     demod_t demod;
     bitclk_t bit_detector;
     hldc_deframer_t deframer;
+    metric_t *hdlc_errors;
 };
 
+struct md_rx_worker;
+
 struct md_multi_rx
 {
     struct md_rx rxs[MD_RX_MAX];
     int count;
 
+    // Anti-alias decimation ahead of all md_rx chains, which then run at sample_rate / decim_factor
+    decim_t decim;
+    int decim_factor;
+
+    // Index of the md_rx whose Goertzel front-end feeds each md_rx, -1 if not Goertzel-based
+    int grz_front_src[MD_RX_MAX];
+
+    // Frames each md_rx decoded, and those suppressed as duplicates of another md_rx's frame
+    metric_t *frames[MD_RX_MAX];
+    metric_t *duplicates;
+
+    // Stream positions: decimated samples demodulated on the caller's thread, and the input sample
+    // position just past the block the last returned frame closed in
+    uint64_t processed;
+    uint64_t frame_pos;
+
     // Inter-md_rx deduplication
     int last_modem;
     uint16_t last_crc;
     time_t last_time;
+
+    // Frames we transmitted, by CRC and the time their last bit was rendered
+    uint16_t echo_crc[MD_RX_ECHO_MAX];
+    time_t echo_time[MD_RX_ECHO_MAX];
+    int echo_next;
+
+    // Threaded mode, workers is NULL when md_rx chains run on the caller's thread
+    struct md_rx_worker *workers;
+    int worker_count;
+    int event_fd;                        // Readable when workers have frames to collect
+    _Atomic int frames_outstanding;      // Frames queued by workers and not yet collected
+    metric_t *lag_samples;               // Samples dropped because a worker's ring was full
+    uint64_t lag_dropped;                // Dropped since the last lag log
+    time_t lag_logged;
 };
 
+#define MD_TX_BITS_MAX 16384
+#define MD_TX_FRAME_MAX 512
+#define MD_TX_BACKLOG_MAX 16
+#define MD_TX_BURST_FRAMES_MAX 32
+// One opening flag and a frame with its FCS, bit stuffing adds at most one bit in five
+#define MD_TX_FRAME_BITS_MAX (8 + (MD_TX_FRAME_MAX + 2) * 8 * 6 / 5)
+
 struct md_tx
 {
     modulator_t fsk_mod;
+    // libtnc's framer writes one NRZI level per byte and has no packed output, so each frame (with a single
+    // opening flag) goes through frame_bits and is packed into bits afterwards. TXDELAY and the tail flags
+    // are generated packed directly.
     hldc_framer_t framer;
+    int head_flags;
+    int tail_flags;
+    uint8_t frame_bits[MD_TX_FRAME_BITS_MAX]; // Framer output, one level per byte
+    int frame_bits_size;
+
+    // Streaming mode: the burst being sent as packed NRZI bits waiting to be rendered, bits[cursor..size).
+    // Frames share one TXDELAY; the tail flags are appended once the queued bits run out.
+    bitarr_t bits;
+    uint64_t bits_words[BITARR_WORDS(MD_TX_BITS_MAX)];
+    int bits_cursor;
+    bool burst_open;
+    int burst_bits_start; // Relative to bits, negative once rendered bits are compacted away
+    int burst_frames;
+    int burst_max_bits; // Keyup limit
+
+    // Frames in bits whose last bit is not rendered yet, by CRC and end position (relative to bits),
+    // and CRCs of frames fully rendered since md_tx_sent was last called
+    uint16_t unsent_crc[MD_TX_BURST_FRAMES_MAX];
+    int unsent_end[MD_TX_BURST_FRAMES_MAX];
+    int unsent_count;
+    uint16_t sent_crc[MD_TX_BURST_FRAMES_MAX];
+    int sent_count;
+
+    // Frames waiting for the next keyup
+    uint8_t backlog[MD_TX_BACKLOG_MAX][MD_TX_FRAME_MAX];
+    int backlog_len[MD_TX_BACKLOG_MAX];
+    int backlog_head;
+    int backlog_count;
 };
 
 typedef struct modem
 {
     struct md_multi_rx mrx;
     struct md_tx tx;
+    metric_t *tx_frames;
+    metric_t *tx_samples;
 } modem_t;
 
 typedef struct modem_params
 {
     float sample_rate;
     demod_type_t types;
+    int decimation; // RX decimation factor, 0 or 1 to demodulate at sample_rate
     float tx_delay;
     float tx_tail;
+    float tx_burst_max; // Keyup limit in ms for bursts of queued frames, 0 for no limit
 } modem_params_t;
 
 //
 
 void modem_init(modem_t *modem, modem_params_t *params);
 
+// Registers RX/TX metrics labelled with the channel, without this they are not collected
+void modem_register_metrics(modem_t *modem, int channel);
+
 int modem_demodulate(modem_t *modem, const float_buffer_t *sample_buf, buffer_t *out_frame_buf);
 
+// Returns next frame decoded by rx workers, 0 if none is ready (threaded mode only)
+int modem_collect(modem_t *modem, buffer_t *out_frame_buf);
+
+// Input sample position, counted from the first sample demodulated, of the end of the block in which
+// the last returned frame's closing flag was received
+uint64_t modem_rx_frame_pos(const modem_t *modem);
+
 int modem_modulate(modem_t *modem, const buffer_t *frame_buf, float_buffer_t *out_sample_buf);
 
+// Streaming TX: queue frames, start a burst once the channel is ours, render samples as playback needs them
+int modem_tx_queue(modem_t *modem, const buffer_t *frame_buf);
+
+int modem_tx_begin_burst(modem_t *modem);
+
+int modem_tx_render(modem_t *modem, float_buffer_t *out_sample_buf, int max_samples);
+
+// Bits of the burst on air still to be rendered
+bool modem_tx_pending(const modem_t *modem);
+
+// Frames waiting for channel access
+bool modem_tx_waiting(const modem_t *modem);
+
+// Data carrier detect: true while any demodulator's bit clock is locked onto a signal
+bool modem_dcd(const modem_t *modem);
+
 void modem_free(modem_t *modem);
 
 //
 
 void md_multi_rx_init(struct md_multi_rx *mrx, float sample_rate, demod_type_t types);
 
+// Demodulates at sample_rate / factor behind a polyphase anti-alias decimator
+void md_multi_rx_init_decimated(struct md_multi_rx *mrx, float sample_rate, demod_type_t types, int factor);
+
+// Largest integer factor keeping the internal rate at or above MD_RX_DECIM_MIN_RATE
+int md_multi_rx_decimation(float sample_rate);
+
+// In threaded mode only submits the samples and returns 0, frames come from md_multi_rx_collect
 int md_multi_rx_process(struct md_multi_rx *mrx, const float_buffer_t *sample_buf, buffer_t *out_frame_buf);
 
 // Variant of md_multi_rx_process for non-real-time processing (i.e. simulation)
@@ -68,12 +184,39 @@ int md_multi_rx_process_at(struct md_multi_rx *mrx, const float_buffer_t *sample
 
 void md_multi_rx_free(struct md_multi_rx *mrx);
 
+// Suppresses a frame with this CRC decoded within MD_RX_ECHO_S of time, i.e. our own transmission
+void md_multi_rx_expect_echo(struct md_multi_rx *mrx, uint16_t crc, time_t time);
+
+// True while any md_rx chain reports data carrier detect, safe to call while workers run
+bool md_multi_rx_dcd(const struct md_multi_rx *mrx);
+
+// Threaded mode: one worker per md_rx chain (chains sharing a Goertzel front-end share a worker).
+// Samples are handed over with md_multi_rx_submit, frames are merged and deduplicated by md_multi_rx_collect.
+int md_multi_rx_start_workers(struct md_multi_rx *mrx);
+
+void md_multi_rx_submit(struct md_multi_rx *mrx, const float_buffer_t *sample_buf);
+
+// Variant of md_multi_rx_submit stamping frames completed in these samples with time (i.e. simulation)
+void md_multi_rx_submit_at(struct md_multi_rx *mrx, const float_buffer_t *sample_buf, time_t time);
+
+// Returns next frame in stream order once every worker has processed past it, 0 if none is ready.
+// Clears event_fd, so call it until it returns 0 whenever event_fd is readable.
+int md_multi_rx_collect(struct md_multi_rx *mrx, buffer_t *out_frame_buf);
+
+// Blocks until workers have processed all submitted samples
+void md_multi_rx_flush(struct md_multi_rx *mrx);
+
+void md_multi_rx_stop_workers(struct md_multi_rx *mrx);
+
 //
 
 void md_rx_init(struct md_rx *rx, float sample_rate, uint32_t demod_flags);
 
 int md_rx_process(struct md_rx *rx, const float_buffer_t *sample_buf, buffer_t *out_frame_buf, uint16_t *out_crc);
 
+// Bit clock recovery and deframing of already demodulated symbols
+int md_rx_process_symbols(struct md_rx *rx, const float *symbols, int n, buffer_t *out_frame_buf, uint16_t *out_crc);
+
 void md_rx_free(struct md_rx *rx);
 
 //
@@ -82,4 +225,24 @@ void md_tx_init(struct md_tx *tx, float sample_rate, float tx_delay, float tx_ta
 
 int md_tx_process(struct md_tx *tx, const buffer_t *frame_buf, float_buffer_t *out_sample_buf, uint16_t *out_crc);
 
+// Returns 1 if the frame joined the burst on air, 0 if it waits for the next one, -1 if the backlog is full
+int md_tx_queue(struct md_tx *tx, const buffer_t *frame_buf);
+
+// Starts a burst from the backlog, as many frames as fit the keyup limit. Returns bits queued.
+int md_tx_begin_burst(struct md_tx *tx);
+
+// Appends samples for as many pending whole bits as fit in max_samples, returns samples written
+int md_tx_render(struct md_tx *tx, float_buffer_t *out_sample_buf, int max_samples);
+
+// Moves the CRCs of frames whose last bit was rendered since the previous call into crcs, returns their count
+int md_tx_sent(struct md_tx *tx, uint16_t *crcs, int max);
+
+// Bits of the current burst not yet rendered
+int md_tx_pending(const struct md_tx *tx);
+
+// Frames waiting for the next burst
+int md_tx_backlog(const struct md_tx *tx);
+
+void md_tx_set_burst_limit(struct md_tx *tx, float max_ms);
+
 void md_tx_free(struct md_tx *tx);
@@ -29,7 +29,23 @@
 #define OPT_GAIN_2200 "eq2200"
 #define OPT_TX_DELAY "tx-delay"
 #define OPT_TX_TAIL "tx-tail"
+#define OPT_TX_BURST_MAX_MS "tx-burst-max"
 #define OPT_EXIT_IDLE_S "exit-idle"
+#define OPT_QUAD_CROSS "quad-cross"
+#define OPT_RX_THREADS "rx-threads"
+#define OPT_DECIMATE "decimate"
+#define OPT_CHANNELS "channels"
+#define OPT_MMAP "mmap"
+#define OPT_PERIOD_MS "period"
+#define OPT_BUFFER_MS "buffer"
+#define OPT_PERIOD_MAX_MS "period-max"
+#define OPT_SAMPLE_FORMAT "format"
+#define OPT_PERSIST "persist"
+#define OPT_SLOTTIME_MS "slottime"
+#define OPT_CSMA_SQUELCH "csma-squelch"
+#define OPT_CLIENT_OVERFLOW "client-overflow"
+#define OPT_METRICS_TCP_PORT "metrics-tcp"
+#define OPT_METRICS_UDS_SOCKET "metrics-uds"
 
 #define OPT_SHORT_CONFIG 'c'
 #define OPT_SHORT_LIST 'l'
@@ -56,6 +72,22 @@
 #define OPT_SHORT_TX_DELAY 'y'
 #define OPT_SHORT_TX_TAIL 'z'
 #define OPT_SHORT_EXIT_IDLE_S 12
+#define OPT_SHORT_QUAD_CROSS 13
+#define OPT_SHORT_RX_THREADS 14
+#define OPT_SHORT_CHANNELS 15
+#define OPT_SHORT_MMAP 16
+#define OPT_SHORT_PERIOD_MS 17
+#define OPT_SHORT_BUFFER_MS 18
+#define OPT_SHORT_PERIOD_MAX_MS 19
+#define OPT_SHORT_SAMPLE_FORMAT 20
+#define OPT_SHORT_DECIMATE 21
+#define OPT_SHORT_PERSIST 22
+#define OPT_SHORT_SLOTTIME_MS 23
+#define OPT_SHORT_CSMA_SQUELCH 24
+#define OPT_SHORT_TX_BURST_MAX_MS 25
+#define OPT_SHORT_CLIENT_OVERFLOW 26
+#define OPT_SHORT_METRICS_TCP_PORT 27
+#define OPT_SHORT_METRICS_UDS_SOCKET 28
 
 #define OPT_STR_SIZE 256
 
@@ -72,6 +104,12 @@ typedef struct options
     bool dev_input;
     bool dev_output;
     int rate;
+    int channels;
+    bool mmap;
+    int period_ms;
+    int buffer_ms;
+    int period_max_ms;
+    char sample_format[OPT_STR_SIZE];
 
     int tcp_kiss_port;
     int tcp_tnc2_port;
@@ -86,12 +124,23 @@ typedef struct options
 
     char uds_kiss_socket_path[OPT_STR_SIZE];
     char uds_tnc2_socket_path[OPT_STR_SIZE];
+    char client_overflow[OPT_STR_SIZE];
+
+    int metrics_tcp_port;
+    char metrics_uds_socket_path[OPT_STR_SIZE];
 
     float squelch;
     float gain_2200;
     float tx_delay;
     float tx_tail;
+    float tx_burst_max_ms;
     long exit_idle_s;
+    bool quad_cross;
+    bool rx_threads;
+    bool decimate;
+    int persist;
+    int slottime_ms;
+    bool csma_squelch;
 } options_t;
 
 // Clears out options_t setting null/zero values.
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "buffer.h"
+#include "evloop.h"
+#include "metrics.h"
+#include "outq.h"
+#include "ring.h"
+#include "udp.h"
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+// Output thread: KISS/TNC2 encoding and all stdout, UDP and TCP/UDS client writes for received frames.
+// The RX path only pushes frames into a lock-free single-producer queue.
+
+#define OUTPUT_FRAME_MAX 512
+#define OUTPUT_QUEUE_FRAMES 64
+#define OUTPUT_CLIENTS_MAX 32
+
+typedef enum output_client_kind
+{
+    OUTPUT_CLIENT_TCP_KISS = 0,
+    OUTPUT_CLIENT_TCP_TNC2,
+    OUTPUT_CLIENT_UDS_KISS,
+    OUTPUT_CLIENT_UDS_TNC2,
+} output_client_kind_t;
+
+typedef struct output_rx_frame
+{
+    int channel;
+    time_t time;
+    int64_t audio_ns; // Capture time of the frame's closing flag, 0 if unknown
+    int size;
+    uint8_t data[OUTPUT_FRAME_MAX];
+} output_rx_frame_t;
+
+// Connected TCP/UDS client, written by the output thread through its own duplicate of the socket
+typedef struct output_client
+{
+    bool active;
+    int fd;        // Duplicate owned by the output thread
+    int server_fd; // Socket as known to the server, matched on disconnect
+    output_client_kind_t kind;
+    bool want_write; // Watched for POLLOUT from a short write until the queue drains
+    bool closing;    // Shut down for overflow or a write error, waiting for the server to notice
+    outq_t queue;
+} output_client_t;
+
+typedef struct output_params
+{
+    bool kiss_stdout;        // KISS on stdout, TNC2 otherwise
+    udp_sender_t *udp_kiss;  // NULL when disabled
+    udp_sender_t *udp_tnc2;
+    outq_policy_t client_overflow;
+} output_params_t;
+
+typedef struct output
+{
+    output_params_t params;
+
+    ring_queue_t *frames; // RX path -> output thread
+    ring_queue_t *ctl;    // Client connects and disconnects -> output thread
+    int wake_fd;          // Written by output_notify and client changes, only when the output thread sleeps
+    atomic_bool sleeping;
+    atomic_bool stop;
+    bool running;
+    pthread_t thread;
+    _Atomic uint64_t frames_dropped; // Queue full
+
+    // Output thread side
+    evloop_t evloop;
+    output_client_t clients[OUTPUT_CLIENTS_MAX];
+    time_t stats_since;
+
+    metric_t *queue_frames; // Frames waiting for the output thread
+    metric_t *dropped_frames;
+    metric_t *client_bytes[OUTPUT_CLIENTS_MAX]; // Per client slot, hidden while the slot is free
+    metric_t *client_dropped[OUTPUT_CLIENTS_MAX];
+    metrics_histogram_t *rx_latency; // Closing flag captured -> frame written to every output
+} output_t;
+
+// Returns 0 on success, -1 on error
+int output_init(output_t *out, const output_params_t *params);
+
+int output_start(output_t *out);
+
+// RX side, never blocks and makes no syscalls, output_notify hands the frames over.
+// audio_ns is the monotonic capture time of the frame's end, 0 if unknown.
+// Returns 0 on success, -1 if the queue is full and the frame was dropped.
+int output_push(output_t *out, int channel, const buffer_t *frame_buf, int64_t audio_ns);
+
+// Main loop side, outside the audio callback. Wakes the output thread if it sleeps on pushed frames.
+void output_notify(output_t *out);
+
+// Main loop side, fd is the client socket owned by its server
+void output_client_add(output_t *out, int fd, output_client_kind_t kind);
+
+void output_client_remove(output_t *out, int fd);
+
+// Stops the thread once queued frames are written
+void output_free(output_t *out);
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Bounded output queue of whole messages for one stream client, drained without blocking as the socket
+// becomes writable so a slow client never stalls the RX path
+
+#define OUTQ_BYTES 8192
+#define OUTQ_MSGS_MAX 64
+
+typedef enum outq_policy
+{
+    OUTQ_DROP_OLDEST = 0,
+    OUTQ_DROP_NEWEST,
+    OUTQ_DISCONNECT,
+} outq_policy_t;
+
+typedef struct outq
+{
+    uint8_t data[OUTQ_BYTES];
+    uint16_t msg_len[OUTQ_MSGS_MAX];
+    int head;      // First unsent byte
+    int bytes;     // Unsent bytes
+    int msg_head;  // Oldest message, possibly partially sent
+    int msg_count;
+    int head_sent; // Bytes of the oldest message already written, it can no longer be dropped
+    outq_policy_t policy;
+    uint64_t dropped; // Messages discarded on overflow
+} outq_t;
+
+void outq_init(outq_t *q, outq_policy_t policy);
+
+// Returns 0 when queued (possibly after dropping older messages), -1 when the message was dropped.
+// Under OUTQ_DISCONNECT -1 means the client cannot keep up and should be disconnected.
+int outq_push(outq_t *q, const uint8_t *data, int len);
+
+// Writes queued bytes without blocking. Returns bytes left, -1 on a socket error.
+int outq_flush(outq_t *q, int fd);
+
+static inline bool outq_empty(const outq_t *q)
+{
+    return q->bytes == 0;
+}
+
+// Returns the policy named drop-oldest, drop-newest or disconnect, -1 for anything else
+int outq_policy_parse(const char *name);
+
+const char *outq_policy_name(outq_policy_t policy);
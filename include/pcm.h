@@ -0,0 +1,41 @@
+#ifndef PCM_H
+#define PCM_H
+
+#include <stdbool.h>
+
+typedef enum pcm_format
+{
+    PCM_FORMAT_F32 = 0,
+    PCM_FORMAT_F64,
+    PCM_FORMAT_S8,
+    PCM_FORMAT_S16,
+    PCM_FORMAT_S24_3, // Packed 3 bytes per sample
+    PCM_FORMAT_S24,   // Low 3 bytes of a 32-bit container
+    PCM_FORMAT_S32,
+    PCM_FORMAT_U8,
+    PCM_FORMAT_U16,
+    PCM_FORMAT_U32,
+} pcm_format_t;
+
+typedef struct pcm_codec
+{
+    pcm_format_t format;
+    bool little_endian;
+    int sample_bytes;
+} pcm_codec_t;
+
+// Returns 0 on success, -1 for formats without a codec
+int pcm_codec_init(pcm_codec_t *codec, pcm_format_t format, bool little_endian);
+
+// Block conversion of n samples, in may be unaligned
+void pcm_to_float(const pcm_codec_t *codec, const void *in, float *out, int n);
+
+// Clips to full scale, returns -1 for formats without an encoder (F64, unsigned)
+int pcm_from_float(const pcm_codec_t *codec, const float *in, void *out, int n);
+
+// True when samples are host order F32 and can be used without conversion
+bool pcm_codec_is_native_float(const pcm_codec_t *codec);
+
+const char *pcm_format_name(pcm_format_t format);
+
+#endif
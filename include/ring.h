@@ -24,6 +24,23 @@ size_t ring_read(ring_buffer_t *ring, float *samples, size_t num_samples);
 
 //
 
+// Single-producer single-consumer queue of fixed-size items
+typedef struct ring_queue ring_queue_t;
+
+ring_error_t ring_queue_init(ring_queue_t **queue, size_t capacity, size_t item_size);
+
+void ring_queue_destroy(ring_queue_t *queue);
+
+// Returns 0 on success, -1 if the queue is full
+int ring_queue_push(ring_queue_t *queue, const void *item);
+
+// Returns 0 on success, -1 if the queue is empty
+int ring_queue_pop(ring_queue_t *queue, void *item);
+
+size_t ring_queue_count(const ring_queue_t *queue);
+
+//
+
 typedef struct ring_buffer_simple
 {
     float *buffer;
@@ -34,3 +51,5 @@ typedef struct ring_buffer_simple
 ring_error_t ring_simple_init(ring_simple_t *ring, size_t capacity);
 
 float ring_simple_shift1(ring_simple_t *ring, const float sample);
+
+void ring_simple_free(ring_simple_t *ring);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <stdint.h>
+#include <time.h>
+
+// Monotonic timestamps in ns and a map from sample stream positions to the capture time of those samples
+
+#define TSTAMP_ANCHORS 32
+
+typedef struct tstamp_map
+{
+    float sample_rate;
+    uint64_t pos[TSTAMP_ANCHORS]; // Stream position of the first sample of a block
+    int64_t ns[TSTAMP_ANCHORS];   // Its capture time
+    int head;                     // Next anchor to overwrite
+    int count;
+} tstamp_map_t;
+
+static inline int64_t tstamp_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static inline int64_t tstamp_from_timespec(const struct timespec *ts)
+{
+    return (int64_t)ts->tv_sec * 1000000000 + ts->tv_nsec;
+}
+
+void tstamp_map_init(tstamp_map_t *map, float sample_rate);
+
+// Anchors must be added in stream order, a block whose samples were partly dropped (squelch) still gets one
+void tstamp_map_add(tstamp_map_t *map, uint64_t pos, int64_t ns);
+
+// Capture time of the sample at pos, extrapolated from the nearest anchor at or before it; 0 without anchors
+int64_t tstamp_map_time(const tstamp_map_t *map, uint64_t pos);
@@ -1,31 +1,196 @@
 #include "audio.h"
 #include "ring.h"
+#include "latctl.h"
+#include "pcm.h"
+#include "metrics.h"
+#include "tstamp.h"
 #include "common.h"
 #include <alsa/asoundlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <strings.h>
 #include <poll.h>
+#include <time.h>
 
-#define ALSA_PERIOD_SIZE 4096
 #define RING_BUFFER_SIZE 131072
+#define AUD_BUFFER_PERIODS_DEFAULT 4
 
 static snd_pcm_t *g_pcm_capture = NULL;
 static snd_pcm_t *g_pcm_playback = NULL;
-static ring_buffer_t *g_output_ring = NULL;
+static ring_buffer_t *g_output_rings[AUD_CHANNELS_MAX] = {NULL};
+static int g_channels = 1;
+static bool g_capture_mmap = false;
+static bool g_playback_mmap = false;
+
+// Period sizing, buffer is kept at a fixed number of periods when the period is resized
+static int g_rate = 0;
+static int g_buffer_periods = AUD_BUFFER_PERIODS_DEFAULT;
+static snd_pcm_uframes_t g_capture_period = AUD_PERIOD_FRAMES_MAX;
+static snd_pcm_uframes_t g_playback_period = AUD_PERIOD_FRAMES_MAX;
+static latctl_t g_latctl;
+static bool g_latctl_enabled = false;
+static int g_pending_period_ms = 0;
+static int g_period_ms = 0; // Period the streams are configured with
+static bool g_streams_lost = false;
+
+// Indexed by aud_stream_index, capture first
+static metric_t *g_metric_xruns[2] = {NULL};
+static metric_t *g_metric_recoveries[2] = {NULL};
+static metric_t *g_metric_ring_fill[AUD_CHANNELS_MAX] = {NULL};
+
+// Latency tracking: capture time of the block being passed to the input callback, and per output
+// channel the samples queued and handed to the device with the play time of the last handover
+static int64_t g_capture_block_ns = 0;
+static snd_pcm_uframes_t g_playback_buffer = 0;
+static int64_t g_playback_block_ns = 0;
+static uint64_t g_output_queued[AUD_CHANNELS_MAX] = {0};
+static uint64_t g_output_played[AUD_CHANNELS_MAX] = {0};
+static uint64_t g_output_block_pos[AUD_CHANNELS_MAX] = {0};
+static int64_t g_output_block_ns[AUD_CHANNELS_MAX] = {0};
+
+// Device sample formats in order of preference, integer formats are converted here rather than by plug
+typedef struct aud_format
+{
+    snd_pcm_format_t alsa;
+    pcm_format_t pcm;
+    bool little_endian;
+    const char *name;
+} aud_format_t;
+
+static const aud_format_t g_formats[] = {
+    {SND_PCM_FORMAT_S16_LE, PCM_FORMAT_S16, true, "S16"},
+    {SND_PCM_FORMAT_S32_LE, PCM_FORMAT_S32, true, "S32"},
+    {SND_PCM_FORMAT_S24_LE, PCM_FORMAT_S24, true, "S24"},
+    {SND_PCM_FORMAT_S24_3LE, PCM_FORMAT_S24_3, true, "S24_3"},
+    {SND_PCM_FORMAT_FLOAT_LE, PCM_FORMAT_F32, true, "F32"},
+    {SND_PCM_FORMAT_S16_BE, PCM_FORMAT_S16, false, "S16_BE"},
+    {SND_PCM_FORMAT_S32_BE, PCM_FORMAT_S32, false, "S32_BE"},
+    {SND_PCM_FORMAT_S24_BE, PCM_FORMAT_S24, false, "S24_BE"},
+    {SND_PCM_FORMAT_S24_3BE, PCM_FORMAT_S24_3, false, "S24_3BE"},
+    {SND_PCM_FORMAT_FLOAT_BE, PCM_FORMAT_F32, false, "F32_BE"},
+};
+#define AUD_FORMAT_COUNT (int)(sizeof(g_formats) / sizeof(g_formats[0]))
+#define AUD_SAMPLE_BYTES_MAX 4
+
+static const char *g_sample_format = NULL;
+static pcm_codec_t g_capture_codec;
+static pcm_codec_t g_playback_codec;
+
+// Interleaved capture frames, only used with more than one channel
+static float g_capture_interleaved[AUD_PERIOD_FRAMES_MAX * AUD_CHANNELS_MAX];
+
+// Playback frames ahead of conversion to the device format
+static float g_playback_interleaved[AUD_PERIOD_FRAMES_MAX * AUD_CHANNELS_MAX];
+
+// Device format frames ahead of conversion
+static uint8_t g_capture_raw[AUD_PERIOD_FRAMES_MAX * AUD_CHANNELS_MAX * AUD_SAMPLE_BYTES_MAX];
+static uint8_t g_playback_raw[AUD_PERIOD_FRAMES_MAX * AUD_CHANNELS_MAX * AUD_SAMPLE_BYTES_MAX];
+
+static uint64_t aud_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// Picks the first supported format, or only the requested one when not "auto"
+static int aud_format_apply(snd_pcm_t *pcm, snd_pcm_hw_params_t *hw_params, pcm_codec_t *codec)
+{
+    bool any = !g_sample_format || !g_sample_format[0] || strcasecmp(g_sample_format, "auto") == 0;
+    for (int i = 0; i < AUD_FORMAT_COUNT; i++)
+    {
+        if (!any && strcasecmp(g_sample_format, g_formats[i].name) != 0)
+            continue;
+        if (snd_pcm_hw_params_test_format(pcm, hw_params, g_formats[i].alsa) < 0 ||
+            snd_pcm_hw_params_set_format(pcm, hw_params, g_formats[i].alsa) < 0)
+            continue;
+
+        pcm_codec_init(codec, g_formats[i].pcm, g_formats[i].little_endian);
+        LOGV("%s sample format %s", pcm == g_pcm_capture ? "capture" : "playback", g_formats[i].name);
+        return 0;
+    }
+
+    LOG("sample format %s not supported by device", any ? "auto" : g_sample_format);
+    return -1;
+}
+
+// Monotonic hardware timestamps for latency tracking, the clock is read instead where unsupported
+static void aud_sw_params_apply(snd_pcm_t *pcm)
+{
+    snd_pcm_sw_params_t *sw_params = NULL;
+    if (snd_pcm_sw_params_malloc(&sw_params) < 0)
+        return;
+
+    if (snd_pcm_sw_params_current(pcm, sw_params) < 0 ||
+        snd_pcm_sw_params_set_tstamp_mode(pcm, sw_params, SND_PCM_TSTAMP_ENABLE) < 0 ||
+        snd_pcm_sw_params_set_tstamp_type(pcm, sw_params, SND_PCM_TSTAMP_TYPE_MONOTONIC) < 0 ||
+        snd_pcm_sw_params(pcm, sw_params) < 0)
+        LOGV("%s: no monotonic hardware timestamps", pcm == g_pcm_capture ? "capture" : "playback");
+
+    snd_pcm_sw_params_free(sw_params);
+}
+
+// Time at which the stream had avail frames ready, from the hardware timestamp when there is one
+static int64_t aud_stream_time_ns(snd_pcm_t *pcm, snd_pcm_uframes_t *avail)
+{
+    snd_htimestamp_t ts;
+    snd_pcm_uframes_t ts_avail;
+    if (snd_pcm_htimestamp(pcm, &ts_avail, &ts) < 0 || (ts.tv_sec == 0 && ts.tv_nsec == 0))
+        return tstamp_now_ns();
+
+    *avail = ts_avail;
+    return tstamp_from_timespec(&ts);
+}
 
-static int aud_hw_params_apply(snd_pcm_t *pcm, int rate, int period_frames)
+static int aud_hw_params_apply(snd_pcm_t *pcm, int rate, int channels, int period_ms, bool *use_mmap,
+                               pcm_codec_t *codec, snd_pcm_uframes_t *out_period_frames)
 {
+    int period_frames = rate * period_ms / 1000;
+    if (period_frames > AUD_PERIOD_FRAMES_MAX)
+    {
+        LOG("period of %d ms exceeds %d frames, clamping", period_ms, AUD_PERIOD_FRAMES_MAX);
+        period_frames = AUD_PERIOD_FRAMES_MAX;
+    }
+    if (period_frames < 16)
+        period_frames = 16;
+
     snd_pcm_hw_params_t *hw_params = NULL;
     int err = snd_pcm_hw_params_malloc(&hw_params);
     if (err < 0)
         return -1;
 
-    err = snd_pcm_hw_params_any(pcm, hw_params) ||
-          snd_pcm_hw_params_set_access(pcm, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED) ||
-          snd_pcm_hw_params_set_format(pcm, hw_params, SND_PCM_FORMAT_FLOAT) ||
-          snd_pcm_hw_params_set_channels(pcm, hw_params, 1);
+    err = snd_pcm_hw_params_any(pcm, hw_params);
+    if (err < 0)
+        goto fail;
+
+    if (*use_mmap && snd_pcm_hw_params_set_access(pcm, hw_params, SND_PCM_ACCESS_MMAP_INTERLEAVED) < 0)
+    {
+        LOG("mmap access not supported, falling back to read/write");
+        *use_mmap = false;
+    }
+
+    if (!*use_mmap)
+    {
+        err = snd_pcm_hw_params_set_access(pcm, hw_params, SND_PCM_ACCESS_RW_INTERLEAVED);
+        if (err < 0)
+        {
+            LOG("read/write access not supported");
+            goto fail;
+        }
+    }
+
+    err = snd_pcm_hw_params_set_channels(pcm, hw_params, channels);
     if (err < 0)
+    {
+        LOG("device does not support %d channels", channels);
         goto fail;
+    }
+
+    if (aud_format_apply(pcm, hw_params, codec) < 0)
+    {
+        snd_pcm_hw_params_free(hw_params);
+        return -1;
+    }
 
     unsigned int actual_rate = rate;
     err = snd_pcm_hw_params_set_rate_near(pcm, hw_params, &actual_rate, 0);
@@ -37,7 +202,7 @@ static int aud_hw_params_apply(snd_pcm_t *pcm, int rate, int period_frames)
     if (err < 0)
         goto fail;
 
-    snd_pcm_uframes_t buffer_frames = period_frames * 4;
+    snd_pcm_uframes_t buffer_frames = period_frames_val * g_buffer_periods;
     err = snd_pcm_hw_params_set_buffer_size_near(pcm, hw_params, &buffer_frames);
     if (err < 0)
         goto fail;
@@ -46,7 +211,30 @@ static int aud_hw_params_apply(snd_pcm_t *pcm, int rate, int period_frames)
     if (err < 0)
         goto fail;
 
+    // The de-interleave and the per-channel modems are sized by the channel count
+    unsigned int actual_channels = 0;
+    err = snd_pcm_hw_params_get_channels(hw_params, &actual_channels);
+    if (err < 0)
+        goto fail;
+    if ((int)actual_channels != channels)
+    {
+        LOG("device negotiated %u channels instead of %d", actual_channels, channels);
+        snd_pcm_hw_params_free(hw_params);
+        return -1;
+    }
+
+    snd_pcm_hw_params_get_period_size(hw_params, &period_frames_val, 0);
+    snd_pcm_hw_params_get_buffer_size(hw_params, &buffer_frames);
+    if (period_frames_val > AUD_PERIOD_FRAMES_MAX)
+        period_frames_val = AUD_PERIOD_FRAMES_MAX;
+    *out_period_frames = period_frames_val;
+    if (pcm == g_pcm_playback)
+        g_playback_buffer = buffer_frames;
+    LOGV("%s period %lu frames, buffer %lu frames",
+         pcm == g_pcm_capture ? "capture" : "playback", period_frames_val, buffer_frames);
+
     snd_pcm_hw_params_free(hw_params);
+    aud_sw_params_apply(pcm);
     return 0;
 
 fail:
@@ -69,11 +257,41 @@ static int aud_capture_restart(void)
     return err;
 }
 
+static void aud_xrun(snd_pcm_t *pcm)
+{
+    if (!g_latctl_enabled)
+        return;
+
+    int period_ms = g_latctl.period_ms;
+    int new_period_ms = latctl_xrun(&g_latctl, aud_now_ms());
+    if (new_period_ms > 0)
+    {
+        LOG("%d xruns within %d ms (last on %s), growing period %d -> %d ms",
+            g_latctl.params.xrun_limit, g_latctl.params.window_ms,
+            pcm == g_pcm_capture ? "capture" : "playback", period_ms, new_period_ms);
+        g_pending_period_ms = new_period_ms;
+    }
+}
+
+static int aud_stream_index(snd_pcm_t *pcm)
+{
+    return pcm == g_pcm_capture ? 0 : 1;
+}
+
+static void aud_ring_metrics_update(void)
+{
+    for (int ch = 0; ch < g_channels; ch++)
+        if (g_output_rings[ch])
+            metrics_set(g_metric_ring_fill[ch], (int64_t)ring_available(g_output_rings[ch]));
+}
+
 static int aud_stream_recover(snd_pcm_t *pcm, int err)
 {
     if (err == -EPIPE)
     {
         LOGD("xrun on %s, recovering", pcm == g_pcm_capture ? "capture" : "playback");
+        metrics_inc(g_metric_xruns[aud_stream_index(pcm)]);
+        aud_xrun(pcm);
         err = snd_pcm_prepare(pcm);
     }
     else if (err == -ESTRPIPE)
@@ -99,6 +317,7 @@ static int aud_stream_recover(snd_pcm_t *pcm, int err)
     else
     {
         LOGD("stream recovery succeeded for %s", pcm == g_pcm_capture ? "capture" : "playback");
+        metrics_inc(g_metric_recoveries[aud_stream_index(pcm)]);
     }
     return restart_err;
 }
@@ -145,7 +364,7 @@ static snd_pcm_sframes_t aud_pcm_write(snd_pcm_t *pcm, const void *buf, snd_pcm_
 
 int aud_initialize(void)
 {
-    ring_error_t err = ring_init(&g_output_ring, RING_BUFFER_SIZE);
+    ring_error_t err = ring_init(&g_output_rings[0], RING_BUFFER_SIZE);
     if (err != RING_SUCCESS)
     {
         LOG("ring output initialization failed: code %d", err);
@@ -166,8 +385,12 @@ void aud_terminate(void)
         snd_pcm_close(g_pcm_playback);
         g_pcm_playback = NULL;
     }
-    ring_destroy(g_output_ring);
-    g_output_ring = NULL;
+    for (int ch = 0; ch < AUD_CHANNELS_MAX; ch++)
+    {
+        if (g_output_rings[ch])
+            ring_destroy(g_output_rings[ch]);
+        g_output_rings[ch] = NULL;
+    }
 }
 
 static int aud_pcm_open(snd_pcm_t **pcm, const char *device_name, snd_pcm_stream_t stream)
@@ -183,18 +406,44 @@ static int aud_pcm_open(snd_pcm_t **pcm, const char *device_name, snd_pcm_stream
     return 0;
 }
 
-int aud_configure(const char *device_name, int sample_rate, bool do_input, bool do_output)
+int aud_configure(const aud_params_t *params)
 {
-    if (!do_input && !do_output)
+    nonnull(params, "params");
+
+    const char *device_name = params->device_name;
+    int sample_rate = params->sample_rate;
+    int channels = params->channels;
+    if (!params->do_input && !params->do_output)
         return 0;
 
     nonnull(device_name, "device_name");
+    nonzero(params->period_ms, "params.period_ms");
+
+    if (channels < 1 || channels > AUD_CHANNELS_MAX)
+    {
+        LOG("invalid channel count %d (1-%d)", channels, AUD_CHANNELS_MAX);
+        return -1;
+    }
+    g_channels = channels;
+    g_rate = sample_rate;
+    g_sample_format = params->sample_format;
+
+    g_buffer_periods = params->buffer_ms > 0 ? params->buffer_ms / params->period_ms : AUD_BUFFER_PERIODS_DEFAULT;
+    if (g_buffer_periods < 2)
+        g_buffer_periods = 2;
+
+    g_period_ms = params->period_ms;
+    latctl_init(&g_latctl, params->period_ms, params->period_max_ms, &latctl_params_default, aud_now_ms());
+    g_latctl_enabled = params->period_max_ms > params->period_ms;
+    if (g_latctl_enabled)
+        LOGV("adaptive period %d-%d ms", params->period_ms, params->period_max_ms);
 
-    if (do_input)
+    if (params->do_input)
     {
+        g_capture_mmap = params->use_mmap;
         if (aud_pcm_open(&g_pcm_capture, device_name, SND_PCM_STREAM_CAPTURE) < 0)
             return -1;
-        if (aud_hw_params_apply(g_pcm_capture, sample_rate, ALSA_PERIOD_SIZE) < 0)
+        if (aud_hw_params_apply(g_pcm_capture, sample_rate, channels, params->period_ms, &g_capture_mmap, &g_capture_codec, &g_capture_period) < 0)
         {
             snd_pcm_close(g_pcm_capture);
             g_pcm_capture = NULL;
@@ -202,16 +451,43 @@ int aud_configure(const char *device_name, int sample_rate, bool do_input, bool
         }
     }
 
-    if (do_output)
+    if (params->do_output)
     {
+        g_playback_mmap = params->use_mmap;
         if (aud_pcm_open(&g_pcm_playback, device_name, SND_PCM_STREAM_PLAYBACK) < 0)
             goto fail;
-        if (aud_hw_params_apply(g_pcm_playback, sample_rate, ALSA_PERIOD_SIZE) < 0)
+        if (aud_hw_params_apply(g_pcm_playback, sample_rate, channels, params->period_ms, &g_playback_mmap, &g_playback_codec, &g_playback_period) < 0)
         {
             snd_pcm_close(g_pcm_playback);
             g_pcm_playback = NULL;
             goto fail;
         }
+
+        for (int ch = 1; ch < channels; ch++)
+        {
+            if (!g_output_rings[ch] && ring_init(&g_output_rings[ch], RING_BUFFER_SIZE) != RING_SUCCESS)
+            {
+                LOG("ring output initialization failed for channel %d", ch);
+                goto fail;
+            }
+        }
+    }
+
+    static const char *stream_names[2] = {"capture", "playback"};
+    for (int i = 0; i < 2; i++)
+    {
+        if (g_metric_xruns[i])
+            continue;
+        g_metric_xruns[i] = metrics_counter("miniwolf_audio_xruns_total", "ALSA overruns and underruns",
+                                            "stream=\"%s\"", stream_names[i]);
+        g_metric_recoveries[i] = metrics_counter("miniwolf_audio_recoveries_total", "Successful ALSA stream recoveries",
+                                                 "stream=\"%s\"", stream_names[i]);
+    }
+    for (int ch = 0; ch < g_channels; ch++)
+    {
+        if (g_output_rings[ch] && !g_metric_ring_fill[ch])
+            g_metric_ring_fill[ch] = metrics_gauge("miniwolf_playback_ring_samples", "Samples queued for playback",
+                                                   "channel=\"%d\"", ch);
     }
 
     return 0;
@@ -222,9 +498,19 @@ fail:
         snd_pcm_close(g_pcm_capture);
         g_pcm_capture = NULL;
     }
+    if (g_pcm_playback)
+    {
+        snd_pcm_close(g_pcm_playback);
+        g_pcm_playback = NULL;
+    }
     return -1;
 }
 
+int aud_channels(void)
+{
+    return g_channels;
+}
+
 int aud_start(void)
 {
     if (g_pcm_capture)
@@ -247,10 +533,188 @@ int aud_start(void)
     return 0;
 }
 
-void aud_output(const float_buffer_t *buf)
+void aud_output(int channel, const float_buffer_t *buf)
 {
     assert_buffer_valid(buf);
-    ring_write(g_output_ring, buf->data, buf->size);
+
+    if (channel < 0 || channel >= g_channels || !g_output_rings[channel])
+    {
+        LOG("no output ring for channel %d", channel);
+        return;
+    }
+    size_t written = ring_write(g_output_rings[channel], buf->data, buf->size);
+    g_output_queued[channel] += written;
+    if (written < (size_t)buf->size)
+        LOG("output ring full, dropped %zu samples on channel %d", buf->size - written, channel);
+    metrics_set(g_metric_ring_fill[channel], (int64_t)ring_available(g_output_rings[channel]));
+}
+
+uint64_t aud_output_position(int channel)
+{
+    if (channel < 0 || channel >= AUD_CHANNELS_MAX)
+        return 0;
+    return g_output_queued[channel];
+}
+
+bool aud_output_play_time(int channel, uint64_t pos, int64_t *ns)
+{
+    nonnull(ns, "ns");
+
+    if (channel < 0 || channel >= AUD_CHANNELS_MAX || pos >= g_output_played[channel])
+        return false;
+
+    int64_t offset = (int64_t)pos - (int64_t)g_output_block_pos[channel];
+    *ns = g_output_block_ns[channel] + offset * 1000000000 / g_rate;
+    return true;
+}
+
+int64_t aud_capture_block_time(void)
+{
+    return g_capture_block_ns;
+}
+
+int aud_output_space(int channel)
+{
+    if (channel < 0 || channel >= g_channels || !g_output_rings[channel])
+        return 0;
+
+    long target = (long)g_playback_period * g_buffer_periods;
+    long space = target - (long)ring_available(g_output_rings[channel]);
+    return space > 0 ? (int)space : 0;
+}
+
+// Address of the first frame at offset within an interleaved mmap area
+static void *aud_mmap_frames(const snd_pcm_channel_area_t *areas, snd_pcm_uframes_t offset)
+{
+    return (char *)areas[0].addr + (areas[0].first + offset * areas[0].step) / 8;
+}
+
+static void aud_capture_dispatch(input_callback_t *callback, float_buffer_t *buf, const float *frames, int n)
+{
+    for (int ch = 0; ch < g_channels; ch++)
+    {
+        for (int i = 0; i < n; i++)
+            buf->data[i] = frames[i * g_channels + ch];
+        buf->size = n;
+        callback(ch, buf);
+    }
+}
+
+static bool aud_capture_mmap(input_callback_t *callback, float_buffer_t *buf, snd_pcm_uframes_t frames)
+{
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    int err = snd_pcm_mmap_begin(g_pcm_capture, &areas, &offset, &frames);
+    if (err < 0)
+    {
+        LOGD("mmap begin error: %s", snd_strerror(err));
+        aud_stream_recover(g_pcm_capture, err);
+        return false;
+    }
+    if (frames == 0)
+        return false;
+
+    void *dma = aud_mmap_frames(areas, offset);
+    bool native = pcm_codec_is_native_float(&g_capture_codec);
+    if (g_channels == 1)
+    {
+        // The callback processes its buffer in place, the DMA area (maybe shared with dsnoop) must stay untouched
+        if (native)
+            memcpy(buf->data, dma, frames * sizeof(float));
+        else
+            pcm_to_float(&g_capture_codec, dma, buf->data, frames);
+        buf->size = frames;
+        callback(0, buf);
+    }
+    else
+    {
+        if (!native)
+            pcm_to_float(&g_capture_codec, dma, g_capture_interleaved, frames * g_channels);
+        aud_capture_dispatch(callback, buf, native ? dma : g_capture_interleaved, frames);
+    }
+
+    snd_pcm_sframes_t committed = snd_pcm_mmap_commit(g_pcm_capture, offset, frames);
+    if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+    {
+        LOGD("mmap commit error: %s", snd_strerror(committed < 0 ? committed : -EPIPE));
+        aud_stream_recover(g_pcm_capture, committed < 0 ? committed : -EPIPE);
+        return false;
+    }
+    return true;
+}
+
+bool aud_output_pending(void)
+{
+    for (int ch = 0; ch < g_channels; ch++)
+        if (g_output_rings[ch] && ring_available(g_output_rings[ch]) > 0)
+            return true;
+    return false;
+}
+
+static int aud_resize_stream(snd_pcm_t *pcm, bool *use_mmap, pcm_codec_t *codec, snd_pcm_uframes_t *period_frames,
+                             int period_ms)
+{
+    snd_pcm_drop(pcm);
+    if (aud_hw_params_apply(pcm, g_rate, g_channels, period_ms, use_mmap, codec, period_frames) < 0 ||
+        snd_pcm_prepare(pcm) < 0)
+        return -1;
+    if (pcm == g_pcm_capture && snd_pcm_start(pcm) < 0)
+        return -1;
+    return 0;
+}
+
+static int aud_resize_streams(int period_ms)
+{
+    if (g_pcm_capture && aud_resize_stream(g_pcm_capture, &g_capture_mmap, &g_capture_codec, &g_capture_period, period_ms) < 0)
+    {
+        LOG("failed to resize capture period to %d ms", period_ms);
+        return -1;
+    }
+    if (g_pcm_playback && aud_resize_stream(g_pcm_playback, &g_playback_mmap, &g_playback_codec, &g_playback_period, period_ms) < 0)
+    {
+        LOG("failed to resize playback period to %d ms", period_ms);
+        return -1;
+    }
+    return 0;
+}
+
+// Applies controller decisions between periods, never while transmitting. A period the device
+// refuses is rolled back; returns -1 when the streams cannot be restarted with either period.
+static int aud_adapt_period(void)
+{
+    if (!g_latctl_enabled)
+        return 0;
+
+    if (g_pending_period_ms == 0)
+    {
+        int period_ms = g_latctl.period_ms;
+        g_pending_period_ms = latctl_tick(&g_latctl, aud_now_ms());
+        if (g_pending_period_ms > 0)
+            LOG("no xruns for %d s, shrinking period %d -> %d ms",
+                g_latctl.params.calm_ms / 1000, period_ms, g_pending_period_ms);
+    }
+
+    if (g_pending_period_ms == 0 || aud_output_pending())
+        return 0;
+    if (g_pcm_playback && snd_pcm_state(g_pcm_playback) == SND_PCM_STATE_RUNNING)
+        return 0;
+
+    int period_ms = g_pending_period_ms;
+    g_pending_period_ms = 0;
+
+    if (aud_resize_streams(period_ms) == 0)
+    {
+        g_period_ms = period_ms;
+        return 0;
+    }
+
+    LOG("restoring %d ms period", g_period_ms);
+    latctl_set_period(&g_latctl, g_period_ms, aud_now_ms());
+    if (aud_resize_streams(g_period_ms) == 0)
+        return 0;
+
+    LOG("audio streams could not be restarted");
+    return -1;
 }
 
 bool aud_process_capture_period(input_callback_t *callback, float_buffer_t *buf)
@@ -260,6 +724,12 @@ bool aud_process_capture_period(input_callback_t *callback, float_buffer_t *buf)
 
     assert_buffer_valid(buf);
 
+    if (g_streams_lost || aud_adapt_period() < 0)
+    {
+        g_streams_lost = true;
+        return false;
+    }
+
     snd_pcm_sframes_t avail = snd_pcm_avail_update(g_pcm_capture);
     if (avail < 0)
     {
@@ -281,8 +751,24 @@ bool aud_process_capture_period(input_callback_t *callback, float_buffer_t *buf)
     if (avail == 0)
         return false;
 
+    // Read period by period
     snd_pcm_sframes_t to_read = avail < buf->capacity ? avail : buf->capacity;
-    snd_pcm_sframes_t frames_read = aud_pcm_read(g_pcm_capture, buf->data, to_read);
+    if (to_read > g_capture_period)
+        to_read = g_capture_period;
+
+    // The oldest frame available was captured avail frames before the timestamp
+    snd_pcm_uframes_t ts_avail = avail;
+    int64_t ts_ns = aud_stream_time_ns(g_pcm_capture, &ts_avail);
+    g_capture_block_ns = ts_ns - (int64_t)ts_avail * 1000000000 / g_rate;
+
+    if (g_capture_mmap)
+        return aud_capture_mmap(callback, buf, to_read);
+
+
+    // Mono float is read straight into the callback buffer, anything else is converted into it
+    float *dest = g_channels > 1 ? g_capture_interleaved : buf->data;
+    bool native = pcm_codec_is_native_float(&g_capture_codec);
+    snd_pcm_sframes_t frames_read = aud_pcm_read(g_pcm_capture, native ? (void *)dest : g_capture_raw, to_read);
     if (frames_read < 0)
     {
         LOGD("read error in capture");
@@ -291,8 +777,17 @@ bool aud_process_capture_period(input_callback_t *callback, float_buffer_t *buf)
     if (frames_read == 0)
         return false;
 
-    buf->size = frames_read;
-    callback(buf);
+    if (!native)
+        pcm_to_float(&g_capture_codec, g_capture_raw, dest, frames_read * g_channels);
+
+    if (g_channels == 1)
+    {
+        buf->size = frames_read;
+        callback(0, buf);
+        return true;
+    }
+
+    aud_capture_dispatch(callback, buf, g_capture_interleaved, frames_read);
     return true;
 }
 
@@ -301,23 +796,122 @@ int aud_process_capture(input_callback_t *callback, float_buffer_t *buf)
     int periods_processed = 0;
     while (aud_process_capture_period(callback, buf))
         periods_processed++;
+    if (g_streams_lost)
+        return AUD_ERR_LOST;
     return periods_processed > 0 ? 0 : -1;
 }
 
-static int aud_playback_write_period_internal(void)
+static void aud_output_played(int channel, unsigned long n)
 {
-    static float output_buffer[ALSA_PERIOD_SIZE];
+    if (n == 0)
+        return;
+    g_output_block_pos[channel] = g_output_played[channel];
+    g_output_block_ns[channel] = g_playback_block_ns;
+    g_output_played[channel] += n;
+}
 
-    unsigned long available = ring_available(g_output_ring);
-    if (available == 0)
+// Drains output rings into interleaved frames, channels with less data are padded with silence
+static void aud_playback_fill(float *frames, unsigned long n)
+{
+    static float channel_buffer[AUD_PERIOD_FRAMES_MAX];
+
+    if (g_channels == 1)
+    {
+        unsigned long actually_read = ring_read(g_output_rings[0], frames, n);
+        memset(frames + actually_read, 0, (n - actually_read) * sizeof(float));
+        aud_output_played(0, actually_read);
+        return;
+    }
+
+    for (int ch = 0; ch < g_channels; ch++)
+    {
+        unsigned long actually_read = ring_read(g_output_rings[ch], channel_buffer, n);
+        for (unsigned long i = 0; i < n; i++)
+            frames[i * g_channels + ch] = i < actually_read ? channel_buffer[i] : 0.0f;
+        aud_output_played(ch, actually_read);
+    }
+}
+
+static int aud_playback_mmap(snd_pcm_uframes_t frames)
+{
+    const snd_pcm_channel_area_t *areas;
+    snd_pcm_uframes_t offset;
+    int err = snd_pcm_mmap_begin(g_pcm_playback, &areas, &offset, &frames);
+    if (err < 0)
+    {
+        aud_stream_recover(g_pcm_playback, err);
+        return -1;
+    }
+
+    void *dma = aud_mmap_frames(areas, offset);
+    if (pcm_codec_is_native_float(&g_playback_codec))
+        aud_playback_fill(dma, frames);
+    else
+    {
+        aud_playback_fill(g_playback_interleaved, frames);
+        pcm_from_float(&g_playback_codec, g_playback_interleaved, dma, frames * g_channels);
+    }
+
+    snd_pcm_sframes_t committed = snd_pcm_mmap_commit(g_pcm_playback, offset, frames);
+    if (committed < 0 || (snd_pcm_uframes_t)committed != frames)
+    {
+        aud_stream_recover(g_pcm_playback, committed < 0 ? committed : -EPIPE);
+        return -1;
+    }
+
+    if (snd_pcm_state(g_pcm_playback) == SND_PCM_STATE_PREPARED && (err = snd_pcm_start(g_pcm_playback)) < 0)
+    {
+        LOG("failed to start playback: %s", snd_strerror(err));
+        return -1;
+    }
+
+    return 0;
+}
+
+static int aud_playback_write_period_internal(void)
+{
+    // Period length follows the busiest channel
+    unsigned long to_write = 0;
+    for (int ch = 0; ch < g_channels; ch++)
+    {
+        unsigned long available = ring_available(g_output_rings[ch]);
+        if (available > to_write)
+            to_write = available;
+    }
+    if (to_write == 0)
         return 1;
+    if (to_write > g_playback_period)
+        to_write = g_playback_period;
 
-    unsigned long to_write = available < ALSA_PERIOD_SIZE ? available : ALSA_PERIOD_SIZE;
-    unsigned long actually_read = ring_read(g_output_ring, output_buffer, to_write);
-    if (actually_read == 0)
+    // Never more than fits, so writes do not block the loop
+    snd_pcm_sframes_t space = snd_pcm_avail_update(g_pcm_playback);
+    if (space < 0)
+    {
+        aud_stream_recover(g_pcm_playback, space);
+        return -1;
+    }
+    if (space == 0)
         return 1;
+    if (to_write > (unsigned long)space)
+        to_write = space;
+
+    // Frames written now play once everything already queued in the device buffer has
+    snd_pcm_uframes_t ts_avail = space;
+    int64_t ts_ns = aud_stream_time_ns(g_pcm_playback, &ts_avail);
+    long queued = (long)g_playback_buffer - (long)ts_avail;
+    g_playback_block_ns = ts_ns + (queued > 0 ? (int64_t)queued * 1000000000 / g_rate : 0);
+
+    if (g_playback_mmap)
+        return aud_playback_mmap(to_write);
 
-    if (aud_pcm_write(g_pcm_playback, output_buffer, actually_read) < 0)
+    aud_playback_fill(g_playback_interleaved, to_write);
+    const void *frames = g_playback_interleaved;
+    if (!pcm_codec_is_native_float(&g_playback_codec))
+    {
+        pcm_from_float(&g_playback_codec, g_playback_interleaved, g_playback_raw, to_write * g_channels);
+        frames = g_playback_raw;
+    }
+    if (aud_pcm_write(g_pcm_playback, frames, to_write) < 0)
         return -1;
 
     return 0;
@@ -328,10 +922,11 @@ bool aud_process_playback_period(void)
     if (!g_pcm_playback)
         return false;
 
-    if (ring_available(g_output_ring) == 0)
+    if (!aud_output_pending())
         return false;
 
     int result = aud_playback_write_period_internal();
+    aud_ring_metrics_update();
     return result == 0;
 }
 
@@ -340,8 +935,7 @@ void aud_process_playback(void)
     if (!g_pcm_playback)
         return;
 
-    unsigned long ring_avail = ring_available(g_output_ring);
-    if (ring_avail == 0)
+    if (!aud_output_pending())
         return;
 
     int periods_written = 0;
@@ -350,7 +944,7 @@ void aud_process_playback(void)
 
     if (periods_written == 0)
     {
-        LOGD("playback: no periods written (ring_avail=%lu)", ring_avail);
+        LOGD("playback: no periods written");
     }
     else if (periods_written > 1)
     {
@@ -358,6 +952,54 @@ void aud_process_playback(void)
     }
 }
 
+int aud_get_playback_poll_fds(struct pollfd *pfds, int max)
+{
+    nonnull(pfds, "pfds");
+
+    if (!g_pcm_playback)
+        return 0;
+
+    int count = snd_pcm_poll_descriptors_count(g_pcm_playback);
+    if (count > max)
+    {
+        LOG("playback has %d poll descriptors, watching %d", count, max);
+        count = max;
+    }
+    count = snd_pcm_poll_descriptors(g_pcm_playback, pfds, count);
+    return count < 0 ? 0 : count;
+}
+
+bool aud_process_playback_event(int fd, unsigned short revents)
+{
+    if (!g_pcm_playback)
+        return false;
+
+    // ALSA plugins may multiplex several descriptors, they are demangled as a set
+    struct pollfd pfds[AUD_POLL_FDS_MAX];
+    int count = aud_get_playback_poll_fds(pfds, AUD_POLL_FDS_MAX);
+    for (int i = 0; i < count; i++)
+        pfds[i].revents = pfds[i].fd == fd ? revents : 0;
+
+    unsigned short pcm_revents = 0;
+    if (snd_pcm_poll_descriptors_revents(g_pcm_playback, pfds, count, &pcm_revents) < 0)
+        return aud_output_pending();
+
+    bool pending = aud_output_pending();
+    if (pcm_revents & POLLERR)
+    {
+        // Running dry after the last queued period ends every transmission and is not an xrun
+        if (!pending && snd_pcm_state(g_pcm_playback) == SND_PCM_STATE_XRUN)
+            snd_pcm_prepare(g_pcm_playback);
+        else
+            aud_stream_recover(g_pcm_playback, -EPIPE);
+    }
+
+    if ((pcm_revents & POLLOUT) && pending)
+        aud_process_playback();
+
+    return aud_output_pending();
+}
+
 int aud_get_poll_fd(void)
 {
     if (!g_pcm_capture)
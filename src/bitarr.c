@@ -0,0 +1,103 @@
+#include "bitarr.h"
+#include "common.h"
+#include "nrzi.h"
+#include <string.h>
+
+void bitarr_init(bitarr_t *ba, uint64_t *words, int capacity)
+{
+    nonnull(ba, "ba");
+    nonnull(words, "words");
+
+    ba->words = words;
+    ba->capacity = capacity;
+    ba->size = 0;
+}
+
+void bitarr_clear(bitarr_t *ba)
+{
+    ba->size = 0;
+}
+
+static inline void bitarr_put(bitarr_t *ba, int bit)
+{
+    int w = ba->size / BITARR_WORD_BITS;
+    int b = ba->size % BITARR_WORD_BITS;
+    // Words are written whole on their first bit so stale contents never leak in
+    if (b == 0)
+        ba->words[w] = (uint64_t)(bit & 1);
+    else
+        ba->words[w] |= (uint64_t)(bit & 1) << b;
+    ba->size++;
+}
+
+int bitarr_append(bitarr_t *ba, int bit)
+{
+    if (ba->size >= ba->capacity)
+        return -1;
+
+    bitarr_put(ba, bit);
+    return 0;
+}
+
+int bitarr_append_bytes(bitarr_t *ba, const uint8_t *bits, int n)
+{
+    if (n > ba->capacity - ba->size)
+        return -1;
+
+    for (int i = 0; i < n; i++)
+        bitarr_put(ba, bits[i]);
+    return 0;
+}
+
+int bitarr_append_nrzi_byte(bitarr_t *ba, uint8_t byte, int count)
+{
+    if (count * 8 > ba->capacity - ba->size)
+        return -1;
+
+    int level = bitarr_last(ba);
+    for (int c = 0; c < count; c++)
+        for (int i = 0; i < 8; i++)
+            bitarr_put(ba, nrzi_encode((byte >> i) & 1, &level));
+    return 0;
+}
+
+int bitarr_append_nrzi_levels(bitarr_t *ba, const uint8_t *levels, int n)
+{
+    if (n > ba->capacity - ba->size)
+        return -1;
+    if (n == 0)
+        return 0;
+
+    int invert = ba->size > 0 && (levels[0] & 1) == bitarr_last(ba);
+    for (int i = 0; i < n; i++)
+        bitarr_put(ba, levels[i] ^ invert);
+    return 0;
+}
+
+void bitarr_drop_front(bitarr_t *ba, int n)
+{
+    if (n <= 0)
+        return;
+    if (n >= ba->size)
+    {
+        ba->size = 0;
+        return;
+    }
+
+    int size = ba->size - n;
+    int skip = n / BITARR_WORD_BITS;
+    int shift = n % BITARR_WORD_BITS;
+    int words = BITARR_WORDS(size);
+    int src_words = BITARR_WORDS(ba->size);
+
+    if (shift == 0)
+        memmove(ba->words, ba->words + skip, words * sizeof(uint64_t));
+    else
+        for (int i = 0; i < words; i++)
+        {
+            uint64_t lo = ba->words[skip + i] >> shift;
+            uint64_t hi = skip + i + 1 < src_words ? ba->words[skip + i + 1] << (BITARR_WORD_BITS - shift) : 0;
+            ba->words[i] = lo | hi;
+        }
+    ba->size = size;
+}
@@ -11,6 +11,11 @@
 
 #define GOOD_TRANSITION_THR 0.05f
 
+// DCD uses a looser window than the PLL inertia, demodulator jitter rarely stays within 0.05 bit.
+// Noise crossings fall inside it with probability 0.4, far from the on threshold.
+#define DCD_TRANSITION_THR 0.2f
+#define DCD_MAX_RUN_BITS 8 // HDLC stuffing guarantees a transition within 7 bits
+
 #define DCD_ON_THR 26
 #define DCD_OFF_THR 12
 
@@ -34,6 +39,19 @@ void bitclk_init(bitclk_t *bitclk, float sample_rate, float bit_rate)
     bitclk->transition_history = 0;
     bitclk->signal_quality = 0;
     bitclk->data_detect = 0;
+    bitclk->dcd_history = 0;
+    bitclk->bits_since_transition = 0;
+}
+
+static void update_dcd(bitclk_t *bitclk, int good_transition)
+{
+    bitclk->dcd_history = (bitclk->dcd_history << 1) | (good_transition ? 1 : 0);
+    int dcd_quality = __builtin_popcount(bitclk->dcd_history);
+
+    if (dcd_quality >= DCD_ON_THR && !bitclk->data_detect)
+        bitclk->data_detect = 1;
+    else if (dcd_quality <= DCD_OFF_THR && bitclk->data_detect)
+        bitclk->data_detect = 0;
 }
 
 static void update_pll_lock_detection(bitclk_t *bitclk, float timing_error_in_bit_periods)
@@ -43,16 +61,12 @@ static void update_pll_lock_detection(bitclk_t *bitclk, float timing_error_in_bi
     bitclk->transition_history = (bitclk->transition_history << 1) | (good_transition ? 1 : 0);
     bitclk->signal_quality = __builtin_popcount(bitclk->transition_history);
 
-    if (bitclk->signal_quality >= DCD_ON_THR && !bitclk->data_detect)
-        bitclk->data_detect = 1;
-    else if (bitclk->signal_quality <= DCD_OFF_THR && bitclk->data_detect)
-        bitclk->data_detect = 0;
+    update_dcd(bitclk, fabsf(timing_error_in_bit_periods) < DCD_TRANSITION_THR);
+    bitclk->bits_since_transition = 0;
 }
 
-int bitclk_detect(bitclk_t *bitclk, float soft_bit)
+static inline int bitclk_step(bitclk_t *bitclk, float soft_bit)
 {
-    nonnull(bitclk, "bitclk");
-
     // Advance PLL
     float prev_pll_value = bitclk->pll_clock;
     bitclk->pll_clock = wrap_phase(bitclk->pll_clock + bitclk->pll_clock_tick);
@@ -60,8 +74,14 @@ int bitclk_detect(bitclk_t *bitclk, float soft_bit)
     // Bit sampling when PLL wraps around +-1.0
     int sampled_bit = BITCLK_NONE;
     if (prev_pll_value > 0.0f && bitclk->pll_clock <= 0.0f)
+    {
         sampled_bit = (bitclk->last_soft_bit > 0.0f) ? 1 : 0;
 
+        // A carrier without transitions (steady tone or silence) is not data
+        if (++bitclk->bits_since_transition >= DCD_MAX_RUN_BITS)
+            update_dcd(bitclk, 0);
+    }
+
     // Phase correction when softbit crosses 0.0
     if (bitclk->last_soft_bit * soft_bit < 0.0f)
     {
@@ -90,3 +110,26 @@ int bitclk_detect(bitclk_t *bitclk, float soft_bit)
 
     return sampled_bit;
 }
+
+int bitclk_detect(bitclk_t *bitclk, float soft_bit)
+{
+    nonnull(bitclk, "bitclk");
+
+    return bitclk_step(bitclk, soft_bit);
+}
+
+int bitclk_detect_block(bitclk_t *bitclk, const float *soft_bits, int n, int *out_bits)
+{
+    nonnull(bitclk, "bitclk");
+    nonnull(soft_bits, "soft_bits");
+    nonnull(out_bits, "out_bits");
+
+    int count = 0;
+    for (int i = 0; i < n; i++)
+    {
+        int bit = bitclk_step(bitclk, soft_bits[i]);
+        if (bit != BITCLK_NONE)
+            out_bits[count++] = bit;
+    }
+    return count;
+}
@@ -0,0 +1,62 @@
+#include "csma.h"
+#include "common.h"
+
+csma_params_t csma_params_default = {
+    .persist = CSMA_PERSIST_DEFAULT,
+    .slottime_ms = CSMA_SLOTTIME_MS_DEFAULT,
+    .full_duplex = false};
+
+static uint32_t csma_random(csma_t *csma)
+{
+    // xorshift32, the draw only has to be uncorrelated between stations
+    uint32_t x = csma->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    csma->rng = x;
+    return x;
+}
+
+void csma_init(csma_t *csma, const csma_params_t *params, uint32_t seed)
+{
+    nonnull(csma, "csma");
+    nonnull(params, "params");
+
+    csma->params = *params;
+    csma->rng = seed ? seed : 0x9E3779B9u;
+    csma->next_slot_ms = 0;
+}
+
+csma_decision_t csma_poll(csma_t *csma, bool busy, uint64_t now_ms, int *wait_ms)
+{
+    nonnull(csma, "csma");
+    nonnull(wait_ms, "wait_ms");
+
+    *wait_ms = 0;
+    if (csma->params.full_duplex)
+        return CSMA_TRANSMIT;
+
+    if (now_ms < csma->next_slot_ms)
+    {
+        *wait_ms = (int)(csma->next_slot_ms - now_ms);
+        return CSMA_WAIT;
+    }
+
+    if (!busy && (int)(csma_random(csma) >> 24) <= csma->params.persist)
+    {
+        csma->next_slot_ms = 0;
+        return CSMA_TRANSMIT;
+    }
+
+    int slot_ms = csma->params.slottime_ms > 0 ? csma->params.slottime_ms : 1;
+    csma->next_slot_ms = now_ms + slot_ms;
+    *wait_ms = slot_ms;
+    return CSMA_WAIT;
+}
+
+void csma_reset(csma_t *csma)
+{
+    nonnull(csma, "csma");
+
+    csma->next_slot_ms = 0;
+}
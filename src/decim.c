@@ -0,0 +1,94 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "decim.h"
+#include "common.h"
+
+#define DECIM_TAPS_MAX 512
+#define DECIM_LANES 8
+
+void decim_init(decim_t *decim, int factor, float sample_rate, float passband_freq)
+{
+    nonnull(decim, "decim");
+    nonzero(factor, "factor");
+    nonzero(sample_rate, "sample_rate");
+
+    float out_rate = sample_rate / factor;
+    float transition = out_rate - 2.0f * passband_freq;
+    if (transition <= 0.0f)
+        EXIT("Decimation by %d leaves no room above %.0f Hz", factor, passband_freq);
+
+    // Blackman window, ~5.5 / normalized transition width taps. Storage is padded with
+    // leading zeros to whole vectors of DECIM_LANES partial sums.
+    int design_taps = (int)ceilf(5.5f * sample_rate / transition) | 1;
+    if (design_taps > DECIM_TAPS_MAX - 1)
+        design_taps = DECIM_TAPS_MAX - 1;
+    int taps = (design_taps + DECIM_LANES - 1) / DECIM_LANES * DECIM_LANES;
+
+    decim->factor = factor;
+    decim->taps = taps;
+    decim->phase = 0;
+    decim->pos = 0;
+    decim->coeffs = calloc(taps, sizeof(float));
+    decim->history = calloc(2 * taps, sizeof(float));
+    if (!decim->coeffs || !decim->history)
+        EXIT("Failed to allocate decimator");
+
+    float cutoff = 0.5f / factor; // Normalized, halfway through the transition band
+    float mid = (design_taps - 1) / 2.0f;
+    float sum = 0.0f;
+    for (int i = 0; i < design_taps; i++)
+    {
+        float t = i - mid;
+        float sinc = t == 0.0f ? 2.0f * cutoff : sinf(2.0f * M_PI * cutoff * t) / (M_PI * t);
+        float window = 0.42f - 0.5f * cosf(2.0f * M_PI * i / (design_taps - 1)) +
+                       0.08f * cosf(4.0f * M_PI * i / (design_taps - 1));
+        decim->coeffs[taps - 1 - i] = sinc * window;
+        sum += sinc * window;
+    }
+    for (int i = 0; i < taps; i++)
+        decim->coeffs[i] /= sum;
+}
+
+int decim_process_block(decim_t *decim, const float *in, float *out, int n)
+{
+    nonnull(decim, "decim");
+
+    int taps = decim->taps;
+    int out_count = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        decim->history[decim->pos] = in[i];
+        decim->history[decim->pos + taps] = in[i];
+        decim->pos = decim->pos + 1 == taps ? 0 : decim->pos + 1;
+
+        if (++decim->phase < decim->factor)
+            continue;
+        decim->phase = 0;
+
+        // Oldest sample first, matching the reversed coefficients
+        const float *window = &decim->history[decim->pos];
+        float acc[DECIM_LANES] = {0};
+        for (int k = 0; k < taps; k += DECIM_LANES)
+            for (int j = 0; j < DECIM_LANES; j++)
+                acc[j] += decim->coeffs[k + j] * window[k + j];
+
+        float sum = 0.0f;
+        for (int j = 0; j < DECIM_LANES; j++)
+            sum += acc[j];
+        out[out_count++] = sum;
+    }
+
+    return out_count;
+}
+
+void decim_free(decim_t *decim)
+{
+    nonnull(decim, "decim");
+
+    free(decim->coeffs);
+    free(decim->history);
+    decim->coeffs = NULL;
+    decim->history = NULL;
+}
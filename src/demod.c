@@ -18,6 +18,9 @@ void demod_init(demod_t *demod, demod_type_t type, demod_params_t *params)
     case DEMOD_QUADRATURE:
         demod_quad_init(&demod->impl.quad, params, &quad_params_default);
         break;
+    case DEMOD_QUADRATURE_FAST:
+        demod_quad_init(&demod->impl.quad, params, &quad_params_fast);
+        break;
     default:
         EXIT("Unsupported demod type %d", type);
     }
@@ -34,12 +37,32 @@ float demod_process(demod_t *demod, float sample)
     case DEMOD_GOERTZEL_PESIM:
         return demod_grz_process(&demod->impl.grz, sample);
     case DEMOD_QUADRATURE:
+    case DEMOD_QUADRATURE_FAST:
         return demod_quad_process(&demod->impl.quad, sample);
     default:
         EXIT("Unsupported demod type %d", demod->type);
     }
 }
 
+void demod_process_block(demod_t *demod, const float *in, float *out, int n)
+{
+    nonnull(demod, "demod");
+
+    switch (demod->type)
+    {
+    case DEMOD_GOERTZEL_OPTIM:
+    case DEMOD_GOERTZEL_PESIM:
+        demod_grz_process_block(&demod->impl.grz, in, out, n);
+        break;
+    case DEMOD_QUADRATURE:
+    case DEMOD_QUADRATURE_FAST:
+        demod_quad_process_block(&demod->impl.quad, in, out, n);
+        break;
+    default:
+        EXIT("Unsupported demod type %d", demod->type);
+    }
+}
+
 void demod_free(demod_t *demod)
 {
     nonnull(demod, "demod");
@@ -51,6 +74,7 @@ void demod_free(demod_t *demod)
         demod_grz_free(&demod->impl.grz);
         break;
     case DEMOD_QUADRATURE:
+    case DEMOD_QUADRATURE_FAST:
         demod_quad_free(&demod->impl.quad);
         break;
     default:
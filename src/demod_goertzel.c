@@ -25,25 +25,26 @@ void demod_grz_init(demod_grz_t *demod, demod_params_t *params, demod_grz_params
     nonnull(adv, "adv");
 
     int sample_window_size = (int)(0.5f + adv->window_size_mul * params->sample_rate / params->baud_rate);
-    ring_simple_init(&demod->ring, sample_window_size);
-    grz_init(&demod->mark_grz, sample_window_size, params->mark_freq, params->sample_rate);
-    grz_init(&demod->space_grz, sample_window_size, params->space_freq, params->sample_rate);
+    ring_simple_init(&demod->front.ring, sample_window_size);
+    grz_init(&demod->front.mark_grz, sample_window_size, params->mark_freq, params->sample_rate);
+    grz_init(&demod->front.space_grz, sample_window_size, params->space_freq, params->sample_rate);
     agc_init(&demod->mark_agc, adv->agc_attack_ms, adv->agc_release_ms, params->sample_rate);
     agc_init(&demod->space_agc, adv->agc_attack_ms, adv->agc_release_ms, params->sample_rate);
     bf_lpf_init(&demod->post_filter, adv->post_lpf_order, adv->post_lpf_cutoff_mul * params->baud_rate, params->sample_rate);
     demod->sym_clip = adv->sym_clip;
 }
 
-float demod_grz_process(demod_grz_t *demod, float sample)
+static inline void grz_front_step(demod_grz_front_t *front, float sample, float *mark_power, float *space_power)
 {
-    nonnull(demod, "demod");
+    float window_front = ring_simple_shift1(&front->ring, sample);
 
-    float window_front = ring_simple_shift1(&demod->ring, sample);
+    *mark_power = grz_process(&front->mark_grz, sample, window_front);
+    *space_power = grz_process(&front->space_grz, sample, window_front);
+}
 
-    float mark_power = grz_process(&demod->mark_grz, sample, window_front);
+static inline float grz_clip_step(demod_grz_t *demod, float mark_power, float space_power)
+{
     mark_power = agc_filter(&demod->mark_agc, mark_power);
-
-    float space_power = grz_process(&demod->space_grz, sample, window_front);
     space_power = agc_filter(&demod->space_agc, space_power);
 
     float symbol = mark_power - space_power;
@@ -53,14 +54,71 @@ float demod_grz_process(demod_grz_t *demod, float sample)
     else if (symbol < -demod->sym_clip)
         symbol = -demod->sym_clip;
     symbol /= demod->sym_clip;
-
-    symbol = bf_lpf_filter(&demod->post_filter, symbol);
     return symbol;
 }
 
+float demod_grz_process(demod_grz_t *demod, float sample)
+{
+    nonnull(demod, "demod");
+
+    float mark_power, space_power;
+    grz_front_step(&demod->front, sample, &mark_power, &space_power);
+    float symbol = grz_clip_step(demod, mark_power, space_power);
+    return bf_lpf_filter(&demod->post_filter, symbol);
+}
+
+void demod_grz_process_block(demod_grz_t *demod, const float *in, float *out, int n)
+{
+    nonnull(demod, "demod");
+    nonnull(in, "in");
+    nonnull(out, "out");
+
+    for (int i = 0; i < n; i++)
+    {
+        float mark_power, space_power;
+        grz_front_step(&demod->front, in[i], &mark_power, &space_power);
+        out[i] = grz_clip_step(demod, mark_power, space_power);
+    }
+    bf_lpf_filter_block(&demod->post_filter, out, out, n);
+}
+
+void demod_grz_front_process_block(demod_grz_front_t *front, const float *in, float *mark_out, float *space_out, int n)
+{
+    nonnull(front, "front");
+    nonnull(in, "in");
+    nonnull(mark_out, "mark_out");
+    nonnull(space_out, "space_out");
+
+    for (int i = 0; i < n; i++)
+        grz_front_step(front, in[i], &mark_out[i], &space_out[i]);
+}
+
+void demod_grz_back_process_block(demod_grz_t *demod, const float *mark, const float *space, float *out, int n)
+{
+    nonnull(demod, "demod");
+    nonnull(mark, "mark");
+    nonnull(space, "space");
+    nonnull(out, "out");
+
+    for (int i = 0; i < n; i++)
+        out[i] = grz_clip_step(demod, mark[i], space[i]);
+    bf_lpf_filter_block(&demod->post_filter, out, out, n);
+}
+
+int demod_grz_front_equal(const demod_grz_front_t *a, const demod_grz_front_t *b)
+{
+    nonnull(a, "a");
+    nonnull(b, "b");
+
+    return a->ring.size == b->ring.size &&
+           a->mark_grz.coeff == b->mark_grz.coeff &&
+           a->space_grz.coeff == b->space_grz.coeff;
+}
+
 void demod_grz_free(demod_grz_t *demod)
 {
     nonnull(demod, "demod");
 
+    ring_simple_free(&demod->front.ring);
     bf_lpf_free(&demod->post_filter);
 }
@@ -3,11 +3,22 @@
 #include <math.h>
 #include <stdio.h>
 
+#define QUAD_CHUNK 64
+#define QUAD_MIN_POWER 1e-12f
+
 demod_quad_params_t quad_params_default = {
     .iq_lpf_order = 2,
     .iq_lpf_cutoff_mul = 0.5444f,
     .post_lpf_order = 4,
-    .post_lpf_cutoff_mul = 0.5750f};
+    .post_lpf_cutoff_mul = 0.5750f,
+    .disc = QUAD_DISC_ATAN2};
+
+demod_quad_params_t quad_params_fast = {
+    .iq_lpf_order = 2,
+    .iq_lpf_cutoff_mul = 0.5444f,
+    .post_lpf_order = 4,
+    .post_lpf_cutoff_mul = 0.5750f,
+    .disc = QUAD_DISC_CROSS};
 
 void demod_quad_init(demod_quad_t *demod, demod_params_t *params, demod_quad_params_t *adv_params)
 {
@@ -22,32 +33,45 @@ void demod_quad_init(demod_quad_t *demod, demod_params_t *params, demod_quad_par
     demod->cos_inc = cosf(phase_inc);
     demod->sin_inc = sinf(phase_inc);
     demod->prev_phase = 0.0f;
+    demod->i_prev = 0.0f;
+    demod->q_prev = 0.0f;
     demod->scale = params->sample_rate / (2.0f * (float)M_PI * deviation);
+    demod->disc = adv_params->disc;
     float iq_cutoff = adv_params->iq_lpf_cutoff_mul * fabsf(params->mark_freq - params->space_freq);
-    bf_lpf_init(&demod->i_lpf, adv_params->iq_lpf_order, iq_cutoff, params->sample_rate);
-    bf_lpf_init(&demod->q_lpf, adv_params->iq_lpf_order, iq_cutoff, params->sample_rate);
+    bf_mlpf_init(&demod->iq_lpf, adv_params->iq_lpf_order, iq_cutoff, params->sample_rate);
     float post_lpf_cutoff = adv_params->post_lpf_cutoff_mul * params->baud_rate;
     bf_lpf_init(&demod->post_filter, adv_params->post_lpf_order, post_lpf_cutoff, params->sample_rate);
 }
 
-float demod_quad_process(demod_quad_t *demod, float sample)
+static inline bf_lanes_t quad_osc(demod_quad_t *demod, float sample)
 {
-    nonnull(demod, "demod");
-
     // Mix input with I/Q references
-    float i_in = sample * demod->lo_i_prev;
-    float q_in = sample * demod->lo_q_prev;
+    bf_lanes_t iq = {sample * demod->lo_i_prev, sample * demod->lo_q_prev};
 
     // Update oscillator recursively
     float next_i = demod->lo_i_prev * demod->cos_inc - demod->lo_q_prev * demod->sin_inc;
     float next_q = demod->lo_i_prev * demod->sin_inc + demod->lo_q_prev * demod->cos_inc;
     demod->lo_i_prev = next_i;
     demod->lo_q_prev = next_q;
+    return iq;
+}
 
+static inline bf_lanes_t quad_mix(demod_quad_t *demod, float sample)
+{
     // Low-pass filter I/Q
-    float i_filt = bf_lpf_filter(&demod->i_lpf, i_in);
-    float q_filt = bf_lpf_filter(&demod->q_lpf, q_in);
+    return bf_mlpf_filter(&demod->iq_lpf, quad_osc(demod, sample));
+}
 
+// Mixes and low-pass filters up to QUAD_CHUNK samples
+static void quad_mix_block(demod_quad_t *demod, const float *in, bf_lanes_t *iq, int n)
+{
+    for (int j = 0; j < n; j++)
+        iq[j] = quad_osc(demod, in[j]);
+    bf_mlpf_process_block(&demod->iq_lpf, iq, iq, n);
+}
+
+static inline float quad_atan2_delta(demod_quad_t *demod, float i_filt, float q_filt)
+{
     // Calculate phase
     float curr_phase = atan2f(q_filt, i_filt);
     float delta = curr_phase - demod->prev_phase;
@@ -59,18 +83,96 @@ float demod_quad_process(demod_quad_t *demod, float sample)
         delta += 2.0f * (float)M_PI;
 
     demod->prev_phase = curr_phase;
+    return delta;
+}
+
+// sin() of the phase step, close enough to the step itself at Bell 202 deviations
+static inline float quad_cross_delta(float i_prev, float q_prev, float i_filt, float q_filt)
+{
+    return (i_prev * q_filt - q_prev * i_filt) / (i_filt * i_filt + q_filt * q_filt + QUAD_MIN_POWER);
+}
 
-    float symbol = delta * demod->scale;
+static inline float quad_discriminate(demod_quad_t *demod, float sample)
+{
+    bf_lanes_t iq = quad_mix(demod, sample);
+
+    float delta;
+    if (demod->disc == QUAD_DISC_CROSS)
+    {
+        delta = quad_cross_delta(demod->i_prev, demod->q_prev, iq[0], iq[1]);
+        demod->i_prev = iq[0];
+        demod->q_prev = iq[1];
+    }
+    else
+        delta = quad_atan2_delta(demod, iq[0], iq[1]);
+
+    return delta * demod->scale;
+}
+
+static void quad_cross_block(demod_quad_t *demod, const float *in, float *out, int n)
+{
+    bf_lanes_t iq[QUAD_CHUNK];
+    float i_filt[QUAD_CHUNK + 1];
+    float q_filt[QUAD_CHUNK + 1];
+
+    for (int offset = 0; offset < n; offset += QUAD_CHUNK)
+    {
+        int m = n - offset;
+        if (m > QUAD_CHUNK)
+            m = QUAD_CHUNK;
+
+        // Serial part: oscillator and IIR filters
+        quad_mix_block(demod, in + offset, iq, m);
+        i_filt[0] = demod->i_prev;
+        q_filt[0] = demod->q_prev;
+        for (int j = 0; j < m; j++)
+        {
+            i_filt[j + 1] = iq[j][0];
+            q_filt[j + 1] = iq[j][1];
+        }
+        demod->i_prev = i_filt[m];
+        demod->q_prev = q_filt[m];
+
+        // Independent per sample, left for the compiler to vectorize
+        for (int j = 0; j < m; j++)
+            out[offset + j] = quad_cross_delta(i_filt[j], q_filt[j], i_filt[j + 1], q_filt[j + 1]) * demod->scale;
+    }
+}
+
+float demod_quad_process(demod_quad_t *demod, float sample)
+{
+    nonnull(demod, "demod");
+
+    float symbol = quad_discriminate(demod, sample);
+    return bf_lpf_filter(&demod->post_filter, symbol);
+}
+
+void demod_quad_process_block(demod_quad_t *demod, const float *in, float *out, int n)
+{
+    nonnull(demod, "demod");
+    nonnull(in, "in");
+    nonnull(out, "out");
 
-    symbol = bf_lpf_filter(&demod->post_filter, symbol);
-    return symbol;
+    if (demod->disc == QUAD_DISC_CROSS)
+        quad_cross_block(demod, in, out, n);
+    else
+    {
+        bf_lanes_t iq[QUAD_CHUNK];
+        for (int offset = 0; offset < n; offset += QUAD_CHUNK)
+        {
+            int m = n - offset < QUAD_CHUNK ? n - offset : QUAD_CHUNK;
+            quad_mix_block(demod, in + offset, iq, m);
+            for (int j = 0; j < m; j++)
+                out[offset + j] = quad_atan2_delta(demod, iq[j][0], iq[j][1]) * demod->scale;
+        }
+    }
+    bf_lpf_filter_block(&demod->post_filter, out, out, n);
 }
 
 void demod_quad_free(demod_quad_t *demod)
 {
     nonnull(demod, "demod");
 
-    bf_lpf_free(&demod->i_lpf);
-    bf_lpf_free(&demod->q_lpf);
+    bf_mlpf_free(&demod->iq_lpf);
     bf_lpf_free(&demod->post_filter);
 }
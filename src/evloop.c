@@ -0,0 +1,142 @@
+#include "evloop.h"
+#include "common.h"
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/epoll.h>
+
+int evloop_init(evloop_t *loop)
+{
+    nonnull(loop, "loop");
+
+    memset(loop->entries, 0, sizeof(loop->entries));
+    loop->always_ready_count = 0;
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (loop->epoll_fd < 0)
+    {
+        LOG("epoll_create1 failed: %s", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int evloop_add(evloop_t *loop, int fd, uint32_t events, evloop_handler_t *handler, void *ctx)
+{
+    nonnull(loop, "loop");
+    nonnull(handler, "handler");
+
+    if (fd < 0 || fd >= EVLOOP_MAX_FDS)
+    {
+        LOG("fd %d outside of dispatch table (0-%d)", fd, EVLOOP_MAX_FDS - 1);
+        return -1;
+    }
+
+    evloop_entry_t *entry = &loop->entries[fd];
+    if (entry->handler)
+    {
+        LOG("fd %d already registered", fd);
+        return -1;
+    }
+
+    struct epoll_event ev = {.events = events, .data.fd = fd};
+    bool always_ready = false;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        if (errno != EPERM)
+        {
+            LOG("failed to watch fd %d: %s", fd, strerror(errno));
+            return -1;
+        }
+        LOGV("fd %d is not pollable, treating as always ready", fd);
+        always_ready = true;
+        loop->always_ready_count++;
+    }
+
+    entry->handler = handler;
+    entry->ctx = ctx;
+    entry->events = events;
+    entry->always_ready = always_ready;
+    return 0;
+}
+
+int evloop_modify(evloop_t *loop, int fd, uint32_t events)
+{
+    nonnull(loop, "loop");
+
+    if (fd < 0 || fd >= EVLOOP_MAX_FDS || !loop->entries[fd].handler)
+        return -1;
+
+    evloop_entry_t *entry = &loop->entries[fd];
+    if (entry->events == events)
+        return 0;
+
+    struct epoll_event ev = {.events = events, .data.fd = fd};
+    if (!entry->always_ready && epoll_ctl(loop->epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)
+    {
+        LOG("failed to modify fd %d: %s", fd, strerror(errno));
+        return -1;
+    }
+    entry->events = events;
+    return 0;
+}
+
+int evloop_remove(evloop_t *loop, int fd)
+{
+    nonnull(loop, "loop");
+
+    if (fd < 0 || fd >= EVLOOP_MAX_FDS || !loop->entries[fd].handler)
+        return -1;
+
+    evloop_entry_t *entry = &loop->entries[fd];
+    if (entry->always_ready)
+        loop->always_ready_count--;
+    else
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, fd, NULL); // Already gone if fd was closed first
+
+    memset(entry, 0, sizeof(*entry));
+    return 0;
+}
+
+int evloop_run_once(evloop_t *loop, int timeout_ms)
+{
+    nonnull(loop, "loop");
+
+    struct epoll_event events[EVLOOP_MAX_EVENTS];
+    int n = epoll_wait(loop->epoll_fd, events, EVLOOP_MAX_EVENTS, loop->always_ready_count > 0 ? 0 : timeout_ms);
+    if (n < 0)
+        return -1;
+
+    for (int i = 0; i < n; i++)
+    {
+        // Entries removed by an earlier handler in this batch are skipped
+        int fd = events[i].data.fd;
+        evloop_entry_t *entry = &loop->entries[fd];
+        if (entry->handler)
+            entry->handler(fd, events[i].events, entry->ctx);
+    }
+
+    int dispatched = n;
+    for (int fd = 0; loop->always_ready_count > 0 && fd < EVLOOP_MAX_FDS; fd++)
+    {
+        evloop_entry_t *entry = &loop->entries[fd];
+        if (entry->handler && entry->always_ready && (entry->events & POLLIN))
+        {
+            entry->handler(fd, POLLIN, entry->ctx);
+            dispatched++;
+        }
+    }
+
+    return dispatched;
+}
+
+void evloop_free(evloop_t *loop)
+{
+    nonnull(loop, "loop");
+
+    if (loop->epoll_fd >= 0)
+        close(loop->epoll_fd);
+    loop->epoll_fd = -1;
+    memset(loop->entries, 0, sizeof(loop->entries));
+    loop->always_ready_count = 0;
+}
@@ -3,18 +3,90 @@
 #include <math.h>
 #include "common.h"
 
+#define LPF_B1 2.0f
+#define HPF_B1 -2.0f
+
+static bf_spf_section_t *spf_alloc(bf_spf_t *filter, int order)
+{
+    filter->n = order / 2;
+    filter->sections = calloc(filter->n, sizeof(bf_spf_section_t));
+    if (!filter->sections)
+        EXIT("Failed to allocate filter sections");
+    return filter->sections;
+}
+
+static inline float spf_step(bf_spf_section_t *sec, int sections, float b1, float sample)
+{
+    for (int i = 0; i < sections; i++)
+    {
+        float w0 = sec[i].d1 * sec[i].w1 + sec[i].d2 * sec[i].w2 + sample;
+        sample = sec[i].A * (w0 + b1 * sec[i].w1 + sec[i].w2);
+        sec[i].w2 = sec[i].w1;
+        sec[i].w1 = w0;
+    }
+    return sample;
+}
+
+static inline void spf_block(bf_spf_section_t *sec, int sections, float b1, const float *in, float *out, int n)
+{
+    bf_spf_section_t local[3];
+    for (int i = 0; i < sections; i++)
+        local[i] = sec[i];
+
+    for (int j = 0; j < n; j++)
+        out[j] = spf_step(local, sections, b1, in[j]);
+
+    for (int i = 0; i < sections; i++)
+        sec[i] = local[i];
+}
+
+static inline float spf_filter(bf_spf_t *filter, float b1, float sample)
+{
+    switch (filter->n)
+    {
+    case 1:
+        return spf_step(filter->sections, 1, b1, sample);
+    case 2:
+        return spf_step(filter->sections, 2, b1, sample);
+    case 3:
+        return spf_step(filter->sections, 3, b1, sample);
+    default:
+        return spf_step(filter->sections, filter->n, b1, sample);
+    }
+}
+
+static inline void spf_filter_block(bf_spf_t *filter, float b1, const float *in, float *out, int n)
+{
+    switch (filter->n)
+    {
+    case 1:
+        spf_block(filter->sections, 1, b1, in, out, n);
+        break;
+    case 2:
+        spf_block(filter->sections, 2, b1, in, out, n);
+        break;
+    case 3:
+        spf_block(filter->sections, 3, b1, in, out, n);
+        break;
+    default:
+        for (int j = 0; j < n; j++)
+            out[j] = spf_step(filter->sections, filter->n, b1, in[j]);
+    }
+}
+
+static void spf_free(bf_spf_t *filter)
+{
+    free(filter->sections);
+    filter->sections = NULL;
+    filter->n = 0;
+}
+
 void bf_lpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_rate)
 {
     nonnull(filter, "filter");
     nonzero(order, "order");
 
-    filter->n = order / 2;
-    filter->A = malloc(sizeof(float) * filter->n);
-    filter->d1 = malloc(sizeof(float) * filter->n);
-    filter->d2 = malloc(sizeof(float) * filter->n);
-    filter->w0 = malloc(sizeof(float) * filter->n);
-    filter->w1 = malloc(sizeof(float) * filter->n);
-    filter->w2 = malloc(sizeof(float) * filter->n);
+    bf_spf_section_t *sec = spf_alloc(filter, order);
 
     float s = sample_rate;
     float f = cutoff_freq;
@@ -25,12 +97,9 @@ void bf_lpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_ra
     {
         float r = sinf(M_PI * (2.0f * i + 1.0f) / (4.0f * filter->n));
         s = a2 + 2.0f * r * a + 1.0f;
-        filter->A[i] = a2 / s;
-        filter->d1[i] = 2.0f * (1.0f - a2) / s;
-        filter->d2[i] = -(a2 - 2.0f * r * a + 1.0f) / s;
-        filter->w0[i] = 0.0f;
-        filter->w1[i] = 0.0f;
-        filter->w2[i] = 0.0f;
+        sec[i].A = a2 / s;
+        sec[i].d1 = 2.0f * (1.0f - a2) / s;
+        sec[i].d2 = -(a2 - 2.0f * r * a + 1.0f) / s;
     }
 }
 
@@ -38,27 +107,23 @@ float bf_lpf_filter(bf_spf_t *filter, float sample)
 {
     nonnull(filter, "filter");
 
-    for (int i = 0; i < filter->n; i++)
-    {
-        float temp_w0 = filter->d1[i] * filter->w1[i] + filter->d2[i] * filter->w2[i] + sample;
-        filter->w0[i] = temp_w0;
-        sample = filter->A[i] * (temp_w0 + 2.0f * filter->w1[i] + filter->w2[i]);
-        filter->w2[i] = filter->w1[i];
-        filter->w1[i] = temp_w0;
-    }
-    return sample;
+    return spf_filter(filter, LPF_B1, sample);
+}
+
+void bf_lpf_filter_block(bf_spf_t *filter, const float *in, float *out, int n)
+{
+    nonnull(filter, "filter");
+    nonnull(in, "in");
+    nonnull(out, "out");
+
+    spf_filter_block(filter, LPF_B1, in, out, n);
 }
 
 void bf_lpf_free(bf_spf_t *filter)
 {
     nonnull(filter, "filter");
 
-    free(filter->A);
-    free(filter->d1);
-    free(filter->d2);
-    free(filter->w0);
-    free(filter->w1);
-    free(filter->w2);
+    spf_free(filter);
 }
 
 void bf_hpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_rate)
@@ -66,13 +131,7 @@ void bf_hpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_ra
     nonnull(filter, "filter");
     nonzero(order, "order");
 
-    filter->n = order / 2;
-    filter->A = malloc(sizeof(float) * filter->n);
-    filter->d1 = malloc(sizeof(float) * filter->n);
-    filter->d2 = malloc(sizeof(float) * filter->n);
-    filter->w0 = malloc(sizeof(float) * filter->n);
-    filter->w1 = malloc(sizeof(float) * filter->n);
-    filter->w2 = malloc(sizeof(float) * filter->n);
+    bf_spf_section_t *sec = spf_alloc(filter, order);
 
     float s = sample_rate;
     float f = cutoff_freq;
@@ -83,12 +142,9 @@ void bf_hpf_init(bf_spf_t *filter, int order, float cutoff_freq, float sample_ra
     {
         float r = sinf(M_PI * (2.0f * i + 1.0f) / (4.0f * filter->n));
         s = a2 + 2.0f * r * a + 1.0f;
-        filter->A[i] = 1.0f / s;
-        filter->d1[i] = 2.0f * (1.0f - a2) / s;
-        filter->d2[i] = -(a2 - 2.0f * r * a + 1.0f) / s;
-        filter->w0[i] = 0.0f;
-        filter->w1[i] = 0.0f;
-        filter->w2[i] = 0.0f;
+        sec[i].A = 1.0f / s;
+        sec[i].d1 = 2.0f * (1.0f - a2) / s;
+        sec[i].d2 = -(a2 - 2.0f * r * a + 1.0f) / s;
     }
 }
 
@@ -96,27 +152,50 @@ float bf_hpf_filter(bf_spf_t *filter, float sample)
 {
     nonnull(filter, "filter");
 
-    for (int i = 0; i < filter->n; i++)
+    return spf_filter(filter, HPF_B1, sample);
+}
+
+void bf_hpf_filter_block(bf_spf_t *filter, const float *in, float *out, int n)
+{
+    nonnull(filter, "filter");
+    nonnull(in, "in");
+    nonnull(out, "out");
+
+    spf_filter_block(filter, HPF_B1, in, out, n);
+}
+
+void bf_hpf_free(bf_spf_t *filter)
+{
+    nonnull(filter, "filter");
+
+    spf_free(filter);
+}
+
+static inline float bpf_step(bf_bpf_section_t *sec, int sections, float sample)
+{
+    for (int i = 0; i < sections; i++)
     {
-        float temp_w0 = filter->d1[i] * filter->w1[i] + filter->d2[i] * filter->w2[i] + sample;
-        filter->w0[i] = temp_w0;
-        sample = filter->A[i] * (temp_w0 - 2.0f * filter->w1[i] + filter->w2[i]);
-        filter->w2[i] = filter->w1[i];
-        filter->w1[i] = temp_w0;
+        float w0 = sec[i].d1 * sec[i].w1 + sec[i].d2 * sec[i].w2 + sec[i].d3 * sec[i].w3 + sec[i].d4 * sec[i].w4 + sample;
+        sample = sec[i].A * (w0 - 2.0f * sec[i].w2 + sec[i].w4);
+        sec[i].w4 = sec[i].w3;
+        sec[i].w3 = sec[i].w2;
+        sec[i].w2 = sec[i].w1;
+        sec[i].w1 = w0;
     }
     return sample;
 }
 
-void bf_hpf_free(bf_spf_t *filter)
+static inline void bpf_block(bf_bpf_section_t *sec, int sections, const float *in, float *out, int n)
 {
-    nonnull(filter, "filter");
+    bf_bpf_section_t local[2];
+    for (int i = 0; i < sections; i++)
+        local[i] = sec[i];
 
-    free(filter->A);
-    free(filter->d1);
-    free(filter->d2);
-    free(filter->w0);
-    free(filter->w1);
-    free(filter->w2);
+    for (int j = 0; j < n; j++)
+        out[j] = bpf_step(local, sections, in[j]);
+
+    for (int i = 0; i < sections; i++)
+        sec[i] = local[i];
 }
 
 void bf_bpf_init(bf_bpf_t *filter, int order, float low_cutoff_freq, float high_cutoff_freq, float sample_rate)
@@ -125,16 +204,10 @@ void bf_bpf_init(bf_bpf_t *filter, int order, float low_cutoff_freq, float high_
     nonzero(order, "order");
 
     filter->n = order / 4;
-    filter->A = malloc(sizeof(float) * filter->n);
-    filter->d1 = malloc(sizeof(float) * filter->n);
-    filter->d2 = malloc(sizeof(float) * filter->n);
-    filter->d3 = malloc(sizeof(float) * filter->n);
-    filter->d4 = malloc(sizeof(float) * filter->n);
-    filter->w0 = malloc(sizeof(float) * filter->n);
-    filter->w1 = malloc(sizeof(float) * filter->n);
-    filter->w2 = malloc(sizeof(float) * filter->n);
-    filter->w3 = malloc(sizeof(float) * filter->n);
-    filter->w4 = malloc(sizeof(float) * filter->n);
+    filter->sections = calloc(filter->n, sizeof(bf_bpf_section_t));
+    if (!filter->sections)
+        EXIT("Failed to allocate filter sections");
+    bf_bpf_section_t *sec = filter->sections;
 
     float s = sample_rate;
     float fl = low_cutoff_freq;
@@ -148,16 +221,11 @@ void bf_bpf_init(bf_bpf_t *filter, int order, float low_cutoff_freq, float high_
     {
         float r = sinf(M_PI * (2.0f * i + 1.0f) / (4.0f * filter->n));
         s = b2 + 2.0f * r * b + 1.0f;
-        filter->A[i] = b2 / s;
-        filter->d1[i] = 4.0f * a * (1.0f + b * r) / s;
-        filter->d2[i] = 2.0f * (b2 - 2.0f * a2 - 1.0f) / s;
-        filter->d3[i] = 4.0f * a * (1.0f - b * r) / s;
-        filter->d4[i] = -(b2 - 2.0f * r * b + 1.0f) / s;
-        filter->w0[i] = 0.0f;
-        filter->w1[i] = 0.0f;
-        filter->w2[i] = 0.0f;
-        filter->w3[i] = 0.0f;
-        filter->w4[i] = 0.0f;
+        sec[i].A = b2 / s;
+        sec[i].d1 = 4.0f * a * (1.0f + b * r) / s;
+        sec[i].d2 = 2.0f * (b2 - 2.0f * a2 - 1.0f) / s;
+        sec[i].d3 = 4.0f * a * (1.0f - b * r) / s;
+        sec[i].d4 = -(b2 - 2.0f * r * b + 1.0f) / s;
     }
 }
 
@@ -165,33 +233,147 @@ float bf_bpf_filter(bf_bpf_t *filter, float sample)
 {
     nonnull(filter, "filter");
 
-    for (int i = 0; i < filter->n; i++)
+    switch (filter->n)
     {
-        float temp_w0 = filter->d1[i] * filter->w1[i] + filter->d2[i] * filter->w2[i] + filter->d3[i] * filter->w3[i] + filter->d4[i] * filter->w4[i] + sample;
-        filter->w0[i] = temp_w0;
-        sample = filter->A[i] * (temp_w0 - 2.0f * filter->w2[i] + filter->w4[i]);
-        filter->w4[i] = filter->w3[i];
-        filter->w3[i] = filter->w2[i];
-        filter->w2[i] = filter->w1[i];
-        filter->w1[i] = temp_w0;
+    case 1:
+        return bpf_step(filter->sections, 1, sample);
+    case 2:
+        return bpf_step(filter->sections, 2, sample);
+    default:
+        return bpf_step(filter->sections, filter->n, sample);
+    }
+}
+
+void bf_bpf_filter_block(bf_bpf_t *filter, const float *in, float *out, int n)
+{
+    nonnull(filter, "filter");
+    nonnull(in, "in");
+    nonnull(out, "out");
+
+    switch (filter->n)
+    {
+    case 1:
+        bpf_block(filter->sections, 1, in, out, n);
+        break;
+    case 2:
+        bpf_block(filter->sections, 2, in, out, n);
+        break;
+    default:
+        for (int j = 0; j < n; j++)
+            out[j] = bpf_step(filter->sections, filter->n, in[j]);
     }
-    return sample;
 }
 
 void bf_bpf_free(bf_bpf_t *filter)
 {
     nonnull(filter, "filter");
 
-    free(filter->A);
-    free(filter->d1);
-    free(filter->d2);
-    free(filter->d3);
-    free(filter->d4);
-    free(filter->w0);
-    free(filter->w1);
-    free(filter->w2);
-    free(filter->w3);
-    free(filter->w4);
+    free(filter->sections);
+    filter->sections = NULL;
+    filter->n = 0;
+}
+
+static inline bf_lanes_t mlpf_step(bf_mlpf_section_t *sec, int sections, bf_lanes_t x)
+{
+    for (int i = 0; i < sections; i++)
+    {
+        bf_lanes_t w0 = sec[i].d1 * sec[i].w1 + sec[i].d2 * sec[i].w2 + x;
+        x = sec[i].A * (w0 + LPF_B1 * sec[i].w1 + sec[i].w2);
+        sec[i].w2 = sec[i].w1;
+        sec[i].w1 = w0;
+    }
+    return x;
+}
+
+static inline void mlpf_block(bf_mlpf_section_t *sec, int sections, const bf_lanes_t *in, bf_lanes_t *out, int n)
+{
+    bf_mlpf_section_t local[3];
+    for (int i = 0; i < sections; i++)
+        local[i] = sec[i];
+
+    for (int j = 0; j < n; j++)
+        out[j] = mlpf_step(local, sections, in[j]);
+
+    for (int i = 0; i < sections; i++)
+        sec[i] = local[i];
+}
+
+void bf_mlpf_init(bf_mlpf_t *filter, int order, float cutoff_freq, float sample_rate)
+{
+    nonnull(filter, "filter");
+    nonzero(order, "order");
+
+    bf_spf_t proto;
+    bf_lpf_init(&proto, order, cutoff_freq, sample_rate);
+
+    filter->n = proto.n;
+    filter->sections = aligned_alloc(sizeof(bf_lanes_t), filter->n * sizeof(bf_mlpf_section_t));
+    if (!filter->sections)
+        EXIT("Failed to allocate filter sections");
+
+    for (int i = 0; i < filter->n; i++)
+    {
+        bf_mlpf_section_t *sec = &filter->sections[i];
+        for (int l = 0; l < BF_LANES; l++)
+        {
+            sec->A[l] = proto.sections[i].A;
+            sec->d1[l] = proto.sections[i].d1;
+            sec->d2[l] = proto.sections[i].d2;
+            sec->w1[l] = 0.0f;
+            sec->w2[l] = 0.0f;
+        }
+    }
+
+    bf_lpf_free(&proto);
+}
+
+bf_lanes_t bf_mlpf_filter(bf_mlpf_t *filter, bf_lanes_t samples)
+{
+    nonnull(filter, "filter");
+
+    switch (filter->n)
+    {
+    case 1:
+        return mlpf_step(filter->sections, 1, samples);
+    case 2:
+        return mlpf_step(filter->sections, 2, samples);
+    case 3:
+        return mlpf_step(filter->sections, 3, samples);
+    default:
+        return mlpf_step(filter->sections, filter->n, samples);
+    }
+}
+
+void bf_mlpf_process_block(bf_mlpf_t *filter, const bf_lanes_t *in, bf_lanes_t *out, int n)
+{
+    nonnull(filter, "filter");
+    nonnull(in, "in");
+    nonnull(out, "out");
+
+    switch (filter->n)
+    {
+    case 1:
+        mlpf_block(filter->sections, 1, in, out, n);
+        break;
+    case 2:
+        mlpf_block(filter->sections, 2, in, out, n);
+        break;
+    case 3:
+        mlpf_block(filter->sections, 3, in, out, n);
+        break;
+    default:
+        for (int j = 0; j < n; j++)
+            out[j] = mlpf_step(filter->sections, filter->n, in[j]);
+    }
+}
+
+void bf_mlpf_free(bf_mlpf_t *filter)
+{
+    nonnull(filter, "filter");
+
+    free(filter->sections);
+    filter->sections = NULL;
+    filter->n = 0;
 }
 
 void bf_hbf_init(bf_biquad_t *filter, int order, float cutoff_freq, float sample_rate, float gain_db_max)
@@ -0,0 +1,77 @@
+#include "latctl.h"
+#include "common.h"
+
+latctl_params_t latctl_params_default = {
+    .min_ms = 0,
+    .max_ms = 0,
+    .xrun_limit = 2,
+    .window_ms = 10000,
+    .calm_ms = 60000};
+
+void latctl_init(latctl_t *ctl, int period_ms, int max_ms, const latctl_params_t *params, uint64_t now_ms)
+{
+    nonnull(ctl, "ctl");
+    nonzero(period_ms, "period_ms");
+    nonnull(params, "params");
+
+    ctl->params = *params;
+    ctl->params.min_ms = period_ms;
+    ctl->params.max_ms = max_ms > period_ms ? max_ms : period_ms;
+    ctl->period_ms = period_ms;
+    ctl->window_xruns = 0;
+    ctl->window_start_ms = now_ms;
+    ctl->last_event_ms = now_ms;
+    ctl->total_xruns = 0;
+}
+
+int latctl_xrun(latctl_t *ctl, uint64_t now_ms)
+{
+    nonnull(ctl, "ctl");
+
+    ctl->total_xruns++;
+    ctl->last_event_ms = now_ms;
+
+    if (now_ms - ctl->window_start_ms > (uint64_t)ctl->params.window_ms)
+    {
+        ctl->window_start_ms = now_ms;
+        ctl->window_xruns = 0;
+    }
+
+    if (++ctl->window_xruns < ctl->params.xrun_limit || ctl->period_ms >= ctl->params.max_ms)
+        return 0;
+
+    ctl->period_ms *= 2;
+    if (ctl->period_ms > ctl->params.max_ms)
+        ctl->period_ms = ctl->params.max_ms;
+    ctl->window_start_ms = now_ms;
+    ctl->window_xruns = 0;
+    return ctl->period_ms;
+}
+
+int latctl_tick(latctl_t *ctl, uint64_t now_ms)
+{
+    nonnull(ctl, "ctl");
+
+    if (ctl->period_ms <= ctl->params.min_ms || now_ms - ctl->last_event_ms < (uint64_t)ctl->params.calm_ms)
+        return 0;
+
+    ctl->period_ms /= 2;
+    if (ctl->period_ms < ctl->params.min_ms)
+        ctl->period_ms = ctl->params.min_ms;
+    ctl->last_event_ms = now_ms;
+    return ctl->period_ms;
+}
+
+void latctl_set_period(latctl_t *ctl, int period_ms, uint64_t now_ms)
+{
+    nonnull(ctl, "ctl");
+
+    if (period_ms < ctl->params.min_ms)
+        period_ms = ctl->params.min_ms;
+    if (period_ms > ctl->params.max_ms)
+        period_ms = ctl->params.max_ms;
+    ctl->period_ms = period_ms;
+    ctl->window_start_ms = now_ms;
+    ctl->window_xruns = 0;
+    ctl->last_event_ms = now_ms;
+}
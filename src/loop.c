@@ -6,162 +6,359 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
 #include "audio.h"
 #include "ax25.h"
 #include "tnc2.h"
 #include "common.h"
+#include "metrics.h"
 
-#define INPUT_CALLBACK_SIZE 4800
 #define STDIN_BUFFER_SIZE 2048
-#define POLL_TIMEOUT_LONG 250
-#define POLL_TIMEOUT_SHORT 10
+#define POLL_TIMEOUT 250
+#define LOOP_STATS_INTERVAL_S 60
 
-int audio_input_callback(float_buffer_t *buf);
-void modulate_and_transmit(const buffer_t *frame_buf);
+int audio_input_callback(int channel, float_buffer_t *buf);
+void output_frame(int channel, const buffer_t *frame_buf);
+void modulate_and_transmit(int channel, const buffer_t *frame_buf);
 
 void tnc2_input_callback(const buffer_t *line_buf);
 void kiss_input_callback(kiss_message_t *kiss_msg);
 
-void process_stdin_input(miniwolf_t *mw);
-void process_tcp_input(miniwolf_t *mw);
-void process_udp_input(miniwolf_t *mw);
-void process_uds_input(miniwolf_t *mw);
+static void kiss_input_bytes(miniwolf_t *mw, const unsigned char *data, int n);
+static void tnc2_input_bytes(line_reader_t *reader, const unsigned char *data, int n);
+
+// Event handlers, registered with the event loop in miniwolf.c
+void on_audio_ready(int fd, uint32_t revents, void *ctx);
+void on_playback_ready(int fd, uint32_t revents, void *ctx);
+void on_csma_timer(int fd, uint32_t revents, void *ctx);
+void on_rx_frames_ready(int fd, uint32_t revents, void *ctx);
+void on_stdin_ready(int fd, uint32_t revents, void *ctx);
+void on_tcp_kiss_ready(int fd, uint32_t revents, void *ctx);
+void on_tcp_tnc2_ready(int fd, uint32_t revents, void *ctx);
+void on_udp_kiss_ready(int fd, uint32_t revents, void *ctx);
+void on_udp_tnc2_ready(int fd, uint32_t revents, void *ctx);
+void on_uds_kiss_ready(int fd, uint32_t revents, void *ctx);
+void on_uds_tnc2_ready(int fd, uint32_t revents, void *ctx);
+void on_metrics_tcp_ready(int fd, uint32_t revents, void *ctx);
+void on_metrics_uds_ready(int fd, uint32_t revents, void *ctx);
+
+// Callbacks for TCP/UDS client socket registration, clients share the handler of their server.
+// Reads stay on this loop, the output thread writes received frames to the client.
+static void client_add(miniwolf_t *mw, int fd, output_client_kind_t kind, evloop_handler_t *handler)
+{
+    evloop_add(&mw->evloop, fd, POLLIN, handler, mw);
+    output_client_add(&mw->output, fd, kind);
+}
 
-// Callbacks for TCP/UDS client socket registration with poller
-void tcp_client_connect_cb(int fd, void *user_data)
+static void client_remove(miniwolf_t *mw, int fd)
 {
-    miniwolf_t *mw = user_data;
-    socket_poller_add(&mw->poller, fd, POLLER_EV_IN);
+    evloop_remove(&mw->evloop, fd);
+    output_client_remove(&mw->output, fd);
+}
+
+void tcp_kiss_client_connect_cb(int fd, void *user_data)
+{
+    client_add(user_data, fd, OUTPUT_CLIENT_TCP_KISS, on_tcp_kiss_ready);
+}
+
+void tcp_tnc2_client_connect_cb(int fd, void *user_data)
+{
+    client_add(user_data, fd, OUTPUT_CLIENT_TCP_TNC2, on_tcp_tnc2_ready);
 }
 
 void tcp_client_disconnect_cb(int fd, void *user_data)
 {
-    miniwolf_t *mw = user_data;
-    socket_poller_remove(&mw->poller, fd);
+    client_remove(user_data, fd);
 }
 
-void uds_client_connect_cb(int fd, void *user_data)
+void uds_kiss_client_connect_cb(int fd, void *user_data)
 {
-    miniwolf_t *mw = user_data;
-    socket_poller_add(&mw->poller, fd, POLLER_EV_IN);
+    client_add(user_data, fd, OUTPUT_CLIENT_UDS_KISS, on_uds_kiss_ready);
+}
+
+void uds_tnc2_client_connect_cb(int fd, void *user_data)
+{
+    client_add(user_data, fd, OUTPUT_CLIENT_UDS_TNC2, on_uds_tnc2_ready);
 }
 
 void uds_client_disconnect_cb(int fd, void *user_data)
+{
+    client_remove(user_data, fd);
+}
+
+// Metrics clients only get a response to their request, they are not output clients
+void metrics_tcp_client_connect_cb(int fd, void *user_data)
 {
     miniwolf_t *mw = user_data;
-    socket_poller_remove(&mw->poller, fd);
+    evloop_add(&mw->evloop, fd, POLLIN, on_metrics_tcp_ready, mw);
 }
 
-void modulate_and_transmit(const buffer_t *frame_buf)
+void metrics_uds_client_connect_cb(int fd, void *user_data)
 {
-    static float sample_data[96000];
-    float_buffer_t sample_buf = {
-        .data = sample_data,
-        .capacity = sizeof(sample_data) / sizeof(float),
-        .size = 0};
-    modem_modulate(&g_miniwolf.modem, frame_buf, &sample_buf);
-    aud_output(&sample_buf);
+    miniwolf_t *mw = user_data;
+    evloop_add(&mw->evloop, fd, POLLIN, on_metrics_uds_ready, mw);
 }
 
-void loop_run(miniwolf_t *mw)
+static mw_metrics_client_t *metrics_client_find(miniwolf_t *mw, int fd)
 {
-    static float audio_input_buffer[INPUT_CALLBACK_SIZE];
-    static float_buffer_t audio_buf = {
-        .data = audio_input_buffer,
-        .capacity = INPUT_CALLBACK_SIZE,
-        .size = 0};
+    for (int i = 0; i < MW_METRICS_CLIENTS_MAX; i++)
+        if (mw->metrics_clients[i].fd == fd)
+            return &mw->metrics_clients[i];
+    return NULL;
+}
 
-    int timeout_ms = POLL_TIMEOUT_LONG;
+void metrics_client_disconnect_cb(int fd, void *user_data)
+{
+    miniwolf_t *mw = user_data;
+    mw_metrics_client_t *client = metrics_client_find(mw, fd);
+    if (client)
+        client->fd = -1;
+    evloop_remove(&mw->evloop, fd);
+}
 
-    for (;;)
+// Playback descriptors would report room forever when idle, so they are only watched while samples are queued
+static void playback_arm(miniwolf_t *mw, bool armed)
+{
+    if (mw->playback_armed == armed)
+        return;
+
+    for (int i = 0; i < mw->playback_fd_count; i++)
+        evloop_modify(&mw->evloop, mw->playback_fds[i].fd, armed ? mw->playback_fds[i].events : 0);
+    mw->playback_armed = armed;
+    LOGD("playback %s", armed ? "armed" : "disarmed");
+}
+
+// Renders queued TX bits into the output rings, only as far ahead as playback needs
+static bool render_tx(miniwolf_t *mw)
+{
+    static float sample_data[AUD_PERIOD_FRAMES_MAX];
+    bool pending = false;
+
+    for (int ch = 0; ch < mw->channel_count; ch++)
     {
-        // When transmitting, sleep for less to prevent RX starvation
-        timeout_ms = aud_process_playback_period() ? POLL_TIMEOUT_SHORT : POLL_TIMEOUT_LONG;
+        if (!mw->channels[ch].keyed)
+            continue;
 
-        int poll_ret = socket_poller_wait(&mw->poller, timeout_ms);
-        if (poll_ret < 0)
+        modem_t *modem = &mw->channels[ch].modem;
+        int space = aud_output_space(ch);
+        while (space > 0 && modem_tx_pending(modem))
         {
-            if (errno == EINTR)
-            {
-                LOGD("poller wait interrupted");
-                continue;
-            }
-            EXIT("socket poller wait error: %s", strerror(errno));
+            float_buffer_t sample_buf = {
+                .data = sample_data,
+                .capacity = sizeof(sample_data) / sizeof(float),
+                .size = 0};
+            int n = modem_tx_render(modem, &sample_buf, space);
+            if (n <= 0)
+                break;
+            aud_output(ch, &sample_buf);
+            space -= n;
         }
+        pending |= modem_tx_pending(modem);
+    }
+    return pending;
+}
 
-        // Process audio if ready
-        if (socket_poller_is_ready(&mw->poller, mw->audio_fd))
-        {
-            LOGD("audio is ready");
-            aud_process_capture(audio_input_callback, &audio_buf);
-        }
+static uint64_t loop_now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
 
-        int stdin_input = socket_poller_is_ready(&mw->poller, 0);
-        if (stdin_input)
-        {
-            LOGV("stdin input ready");
-            process_stdin_input(mw);
-        }
+static bool channel_busy(const miniwolf_t *mw, const mw_channel_t *chan)
+{
+    // A closed squelch starves the demodulators, their DCD is stale until it opens again
+    if (mw->squelch_enabled)
+        return chan->squelch_open && (mw->csma_squelch || modem_dcd(&chan->modem));
+    return modem_dcd(&chan->modem);
+}
 
-        int tcp_input = 0;
-        if (mw->tcp_kiss_enabled || mw->tcp_tnc2_enabled)
-        {
-            tcp_input |= socket_poller_is_ready(&mw->poller, mw->tcp_kiss_server.listen_fd);
-            tcp_input |= socket_poller_is_ready(&mw->poller, mw->tcp_tnc2_server.listen_fd);
-            for (int i = 0; i < mw->tcp_kiss_server.num_clients; i++)
-                tcp_input |= socket_poller_is_ready(&mw->poller, mw->tcp_kiss_server.clients[i].fd);
-            for (int i = 0; i < mw->tcp_tnc2_server.num_clients; i++)
-                tcp_input |= socket_poller_is_ready(&mw->poller, mw->tcp_tnc2_server.clients[i].fd);
-        }
-        if (tcp_input)
-        {
-            LOGV("tcp input ready");
-            process_tcp_input(mw);
-        }
+// Runs channel access for channels with queued frames, keys up the ones granted and
+// arms the timer for the earliest retry among those still waiting
+static void schedule_tx(miniwolf_t *mw)
+{
+    uint64_t now_ms = loop_now_ms();
+    int next_wait_ms = 0;
+    bool keyed = false;
 
-        int udp_input = 0;
-        if (mw->udp_kiss_listen_enabled || mw->udp_tnc2_listen_enabled)
-        {
-            udp_input |= socket_poller_is_ready(&mw->poller, mw->udp_kiss_server.fd);
-            udp_input |= socket_poller_is_ready(&mw->poller, mw->udp_tnc2_server.fd);
-        }
-        if (udp_input)
+    for (int ch = 0; ch < mw->channel_count; ch++)
+    {
+        mw_channel_t *chan = &mw->channels[ch];
+        if (chan->keyed)
         {
-            LOGV("udp input ready");
-            process_udp_input(mw);
+            keyed = true;
+            continue;
         }
+        if (!modem_tx_waiting(&chan->modem))
+            continue;
 
-        int uds_input = 0;
-        if (mw->uds_kiss_enabled || mw->uds_tnc2_enabled)
+        int wait_ms;
+        if (csma_poll(&chan->csma, channel_busy(mw, chan), now_ms, &wait_ms) == CSMA_TRANSMIT)
         {
-            uds_input |= socket_poller_is_ready(&mw->poller, mw->uds_kiss_server.listen_fd);
-            uds_input |= socket_poller_is_ready(&mw->poller, mw->uds_tnc2_server.listen_fd);
-            for (int i = 0; i < mw->uds_kiss_server.num_clients; i++)
-                uds_input |= socket_poller_is_ready(&mw->poller, mw->uds_kiss_server.clients[i].fd);
-            for (int i = 0; i < mw->uds_tnc2_server.num_clients; i++)
-                uds_input |= socket_poller_is_ready(&mw->poller, mw->uds_tnc2_server.clients[i].fd);
+            LOGV("channel %d clear, keying up", ch);
+            modem_tx_begin_burst(&chan->modem);
+            chan->keyed = true;
+            chan->tx_start_pos = aud_output_position(ch);
+            chan->tx_timing = chan->tx_in_ns > 0;
+            keyed = true;
         }
-        if (uds_input)
+        else if (next_wait_ms == 0 || wait_ms < next_wait_ms)
+            next_wait_ms = wait_ms;
+    }
+
+    struct itimerspec its = {0};
+    its.it_value.tv_sec = next_wait_ms / 1000;
+    its.it_value.tv_nsec = (long)(next_wait_ms % 1000) * 1000000;
+    timerfd_settime(mw->csma_timer_fd, 0, &its, NULL);
+
+    if (keyed)
+    {
+        render_tx(mw);
+        playback_arm(mw, true);
+    }
+}
+
+void modulate_and_transmit(int channel, const buffer_t *frame_buf)
+{
+    mw_channel_t *chan = &g_miniwolf.channels[channel];
+    int64_t in_ns = tstamp_now_ns();
+    int queued = modem_tx_queue(&chan->modem, frame_buf);
+    if (queued < 0)
+    {
+        LOG("tx queue full on channel %d, dropping %d byte frame", channel, frame_buf->size);
+        return;
+    }
+
+    // Frames joining a burst on air are not timed, turnaround is measured to keyup
+    if (queued == 0 && chan->tx_in_ns == 0)
+        chan->tx_in_ns = in_ns;
+    schedule_tx(&g_miniwolf);
+}
+
+// Records TX latency once the first sample of a timed burst has been handed to the device
+static void tx_latency_check(miniwolf_t *mw)
+{
+    for (int ch = 0; ch < mw->channel_count; ch++)
+    {
+        mw_channel_t *chan = &mw->channels[ch];
+        int64_t play_ns;
+        if (!chan->tx_timing || !aud_output_play_time(ch, chan->tx_start_pos, &play_ns))
+            continue;
+
+        metrics_observe(mw->tx_latency, play_ns > chan->tx_in_ns ? (uint64_t)(play_ns - chan->tx_in_ns) / 1000 : 0);
+        LOGD("channel %d tx latency %.1f ms", ch, (play_ns - chan->tx_in_ns) / 1e6);
+        chan->tx_timing = false;
+        chan->tx_in_ns = 0;
+    }
+}
+
+static void loop_stats(miniwolf_t *mw, time_t now)
+{
+    time_t elapsed = now - mw->stats_since;
+    if (elapsed < LOOP_STATS_INTERVAL_S)
+        return;
+
+    LOGV("loop: %.1f wakeups/s, %.1f idle wakeups/s",
+         (double)mw->wakeups / elapsed, (double)mw->idle_wakeups / elapsed);
+    if (mw->tx_latency && metrics_histogram_count(mw->tx_latency) > 0)
+        LOGV("loop: tx latency p50 %.1f ms, p99 %.1f ms, max %.1f ms",
+             metrics_histogram_percentile(mw->tx_latency, 50.0) / 1000.0,
+             metrics_histogram_percentile(mw->tx_latency, 99.0) / 1000.0,
+             atomic_load(&mw->tx_latency->max) / 1000.0);
+    mw->wakeups = 0;
+    mw->idle_wakeups = 0;
+    mw->stats_since = now;
+}
+
+void loop_run(miniwolf_t *mw)
+{
+    for (;;)
+    {
+        int dispatched = evloop_run_once(&mw->evloop, POLL_TIMEOUT);
+        if (dispatched < 0)
         {
-            LOGV("uds input ready");
-            process_uds_input(mw);
+            if (errno == EINTR)
+            {
+                LOGD("event loop wait interrupted");
+                continue;
+            }
+            EXIT("event loop wait error: %s", strerror(errno));
         }
 
+        // Frames pushed by this iteration's handlers, the audio callback itself makes no syscalls
+        output_notify(&mw->output);
+
+        mw->wakeups++;
+        if (dispatched == 0)
+            mw->idle_wakeups++;
+
         // Check exit-idle condition
         time_t current_time = time(NULL);
+        loop_stats(mw, current_time);
         EXITIF(current_time - mw->last_packet_time > mw->max_idle_time, EXIT_FAILURE, "Lack of activity");
     }
 }
 
-int audio_input_callback(float_buffer_t *buf)
+void on_audio_ready(int fd, uint32_t revents, void *ctx)
+{
+    static float audio_input_buffer[AUD_PERIOD_FRAMES_MAX];
+    static float_buffer_t audio_buf = {
+        .data = audio_input_buffer,
+        .capacity = AUD_PERIOD_FRAMES_MAX,
+        .size = 0};
+
+    LOGD("audio is ready");
+    if (aud_process_capture(audio_input_callback, &audio_buf) == AUD_ERR_LOST)
+        EXIT("Audio capture lost");
+}
+
+void on_playback_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    render_tx(mw);
+    bool pending = aud_process_playback_event(fd, revents);
+    tx_latency_check(mw);
+    if (render_tx(mw))
+        pending = true;
+    if (pending)
+        return;
+
+    playback_arm(mw, false);
+    for (int ch = 0; ch < mw->channel_count; ch++)
+    {
+        if (mw->channels[ch].keyed)
+            LOGV("channel %d transmission done", ch);
+        mw->channels[ch].keyed = false;
+        csma_reset(&mw->channels[ch].csma);
+    }
+    schedule_tx(mw);
+}
+
+void on_csma_timer(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    uint64_t expirations;
+    if (read(fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        LOG("failed to read channel access timer: %s", strerror(errno));
+    schedule_tx(mw);
+}
+
+int audio_input_callback(int channel, float_buffer_t *buf)
 {
     assert_buffer_valid(buf);
 
+    if (channel >= g_miniwolf.channel_count)
+        return 0;
+    mw_channel_t *chan = &g_miniwolf.channels[channel];
+
     // If configured, apply high boost channel equalization
-    if (g_miniwolf.hbf_filter.n > 0)
+    if (chan->hbf_filter.n > 0)
     {
         for (int i = 0; i < buf->size; i++)
-            buf->data[i] = bf_biquad_filter(&g_miniwolf.hbf_filter, buf->data[i]);
+            buf->data[i] = bf_biquad_filter(&chan->hbf_filter, buf->data[i]);
     }
 
     // If configured, apply squelch
@@ -171,11 +368,12 @@ int audio_input_callback(float_buffer_t *buf)
         int samples_passed = 0;
         for (int i = 0; i < samples_in; i++)
         {
-            buf->data[i] = agc_filter(&g_miniwolf.input_agc, buf->data[i]);
-            if (sql_process(&g_miniwolf.squelch, buf->data[i]))
+            buf->data[i] = agc_filter(&chan->input_agc, buf->data[i]);
+            if (sql_process(&chan->squelch, buf->data[i]))
                 buf->data[samples_passed++] = buf->data[i];
         }
         buf->size = samples_passed;
+        chan->squelch_open = samples_passed > 0;
     }
 
     if (buf->size == 0)
@@ -190,86 +388,45 @@ int audio_input_callback(float_buffer_t *buf)
         .capacity = sizeof(frame_buffer),
         .size = 0};
 
-    int frame_len = modem_demodulate(&g_miniwolf.modem, buf, &frame_buf);
-    if (frame_len <= 0)
-        return 0;
-
-    g_miniwolf.last_packet_time = time(NULL);
-    LOGV("demodulated packet: %d bytes", frame_len);
-    LOGD("frame decoded: %d bytes", frame_len);
-
-    if (g_miniwolf.kiss_mode || g_miniwolf.tcp_kiss_enabled)
-    {
-        kiss_message_t kiss_msg;
-        kiss_msg.port = 0;
-        kiss_msg.command = 0;
-        memcpy(&kiss_msg.data, frame_buffer, frame_len);
-        kiss_msg.data_length = frame_len;
-
-        char kiss_buffer[512];
-        int kiss_len = kiss_encode(&kiss_msg, kiss_buffer, sizeof(kiss_buffer));
-        if (kiss_len <= 0)
-            return 0;
-
-        if (g_miniwolf.kiss_mode)
-        {
-            fwrite(kiss_buffer, 1, kiss_len, stdout);
-            fflush(stdout);
-        }
-
-        buffer_t kiss_send_buf = {.data = (unsigned char *)kiss_buffer, .capacity = sizeof(kiss_buffer), .size = kiss_len};
+    // Squelched samples are gone from the stream, the block's first passed sample is taken as captured first
+    tstamp_map_add(&chan->rx_clock, chan->rx_samples, aud_capture_block_time());
+    chan->rx_samples += buf->size;
 
-        if (g_miniwolf.tcp_kiss_enabled)
-            tcp_server_broadcast(&g_miniwolf.tcp_kiss_server, &kiss_send_buf);
+    int frame_len = modem_demodulate(&chan->modem, buf, &frame_buf);
+    if (frame_len > 0)
+        output_frame(channel, &frame_buf);
 
-        if (g_miniwolf.udp_kiss_enabled)
-            udp_sender_send(&g_miniwolf.udp_kiss_sender, &kiss_send_buf);
-
-        if (g_miniwolf.uds_kiss_enabled)
-            uds_server_broadcast(&g_miniwolf.uds_kiss_server, &kiss_send_buf);
-    }
-
-    if (!g_miniwolf.kiss_mode || g_miniwolf.tcp_tnc2_enabled)
-    {
-        ax25_packet_t packet;
-        if (ax25_packet_unpack(&packet, &frame_buf))
-            return 0;
-
-        char tnc2_data[512];
-        buffer_t tnc2_buf = {
-            .data = (unsigned char *)tnc2_data,
-            .capacity = sizeof(tnc2_data),
-            .size = 0};
-        int tnc2_len = tnc2_packet_to_string(&packet, &tnc2_buf);
-        if (tnc2_len <= 0)
-            return 0;
-
-        // Add newline before the end of the tnc2 string
-        if (tnc2_len + 1 < sizeof(tnc2_data))
-        {
-            tnc2_data[tnc2_len++] = '\n';
-            tnc2_data[tnc2_len] = '\0';
-        }
+    return 0;
+}
 
-        if (!g_miniwolf.kiss_mode)
-        {
-            fwrite(tnc2_data, 1, tnc2_len, stdout);
-            fflush(stdout);
-        }
+void on_rx_frames_ready(int fd, uint32_t revents, void *ctx)
+{
+    mw_channel_t *chan = ctx;
+    int ch = chan - g_miniwolf.channels;
 
-        buffer_t tnc2_send_buf = {.data = (unsigned char *)tnc2_data, .capacity = sizeof(tnc2_data), .size = tnc2_len};
+    char frame_buffer[MD_RX_FRAME_MAX];
+    buffer_t frame_buf = {
+        .data = frame_buffer,
+        .capacity = sizeof(frame_buffer),
+        .size = 0};
 
-        if (g_miniwolf.tcp_tnc2_enabled)
-            tcp_server_broadcast(&g_miniwolf.tcp_tnc2_server, &tnc2_send_buf);
+    LOGD("rx frames ready on channel %d", ch);
+    while (modem_collect(&chan->modem, &frame_buf) > 0)
+        output_frame(ch, &frame_buf);
+}
 
-        if (g_miniwolf.udp_tnc2_enabled)
-            udp_sender_send(&g_miniwolf.udp_tnc2_sender, &tnc2_send_buf);
+// Encoding and every write happen on the output thread, the RX path only queues the frame
+void output_frame(int channel, const buffer_t *frame_buf)
+{
+    assert_buffer_valid(frame_buf);
 
-        if (g_miniwolf.uds_tnc2_enabled)
-            uds_server_broadcast(&g_miniwolf.uds_tnc2_server, &tnc2_send_buf);
-    }
+    g_miniwolf.last_packet_time = time(NULL);
+    LOGV("demodulated packet: %d bytes", frame_buf->size);
 
-    return 0;
+    mw_channel_t *chan = &g_miniwolf.channels[channel];
+    int64_t audio_ns = tstamp_map_time(&chan->rx_clock, modem_rx_frame_pos(&chan->modem));
+    if (output_push(&g_miniwolf.output, channel, frame_buf, audio_ns) < 0)
+        LOGV("output queue full, dropping %d byte frame", frame_buf->size);
 }
 
 void tnc2_input_callback(const buffer_t *line_buf)
@@ -294,16 +451,50 @@ void tnc2_input_callback(const buffer_t *line_buf)
         return;
     }
 
-    modulate_and_transmit(&frame_buf);
+    modulate_and_transmit(0, &frame_buf);
+}
+
+#define KISS_CMD_DATA 0
+#define KISS_CMD_PERSIST 2
+#define KISS_CMD_SLOTTIME 3
+#define KISS_CMD_FULL_DUPLEX 5
+
+static void kiss_command(mw_channel_t *chan, int command, int value)
+{
+    switch (command)
+    {
+    case KISS_CMD_PERSIST:
+        chan->csma.params.persist = value;
+        LOGV("kiss: persist %d", value);
+        break;
+    case KISS_CMD_SLOTTIME:
+        chan->csma.params.slottime_ms = value * 10;
+        LOGV("kiss: slot time %d ms", value * 10);
+        break;
+    case KISS_CMD_FULL_DUPLEX:
+        chan->csma.params.full_duplex = value != 0;
+        LOGV("kiss: full duplex %s", value ? "on" : "off");
+        break;
+    default:
+        LOGD("kiss: ignoring command %d", command);
+        break;
+    }
 }
 
 void kiss_input_callback(kiss_message_t *kiss_msg)
 {
     nonnull(kiss_msg, "kiss_msg");
 
-    if (kiss_msg->command != 0 || kiss_msg->port != 0)
+    if (kiss_msg->port >= g_miniwolf.channel_count)
         return;
 
+    if (kiss_msg->command != KISS_CMD_DATA)
+    {
+        if (kiss_msg->data_length >= 1)
+            kiss_command(&g_miniwolf.channels[kiss_msg->port], kiss_msg->command, kiss_msg->data[0]);
+        return;
+    }
+
     if (kiss_msg->data_length > sizeof(kiss_msg->data))
     {
         LOG("invalid KISS data length: %d > %zu", kiss_msg->data_length, sizeof(kiss_msg->data));
@@ -315,99 +506,194 @@ void kiss_input_callback(kiss_message_t *kiss_msg)
         .capacity = sizeof(kiss_msg->data),
         .size = kiss_msg->data_length};
 
-    modulate_and_transmit(&frame_buf);
+    modulate_and_transmit(kiss_msg->port, &frame_buf);
+}
+
+static void kiss_input_bytes(miniwolf_t *mw, const unsigned char *data, int n)
+{
+    kiss_message_t kiss_msg;
+    for (int i = 0; i < n; ++i)
+        if (kiss_decoder_process(&mw->kiss_decoder, data[i], &kiss_msg))
+            kiss_input_callback(&kiss_msg);
 }
 
-void process_stdin_input(miniwolf_t *mw)
+static void tnc2_input_bytes(line_reader_t *reader, const unsigned char *data, int n)
 {
+    for (int i = 0; i < n; ++i)
+        line_reader_process(reader, data[i]);
+}
+
+void on_stdin_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
     static unsigned char read_buffer[STDIN_BUFFER_SIZE];
-    int n = read(0, read_buffer, sizeof(read_buffer));
+    int n = read(fd, read_buffer, sizeof(read_buffer));
 
+    LOGV("stdin input ready");
     if (mw->kiss_mode)
-    {
-        kiss_message_t kiss_msg;
-        for (int i = 0; i < n; ++i)
-            if (kiss_decoder_process(&mw->kiss_decoder, read_buffer[i], &kiss_msg))
-                kiss_input_callback(&kiss_msg);
-    }
+        kiss_input_bytes(mw, read_buffer, n);
     else
-    {
-        for (int i = 0; i < n; ++i)
-            line_reader_process(&mw->stdin_line_reader, read_buffer[i]);
-    }
+        tnc2_input_bytes(&mw->stdin_line_reader, read_buffer, n);
 }
 
-void process_tcp_input(miniwolf_t *mw)
+void on_tcp_kiss_ready(int fd, uint32_t revents, void *ctx)
 {
+    miniwolf_t *mw = ctx;
     static unsigned char read_buffer[TCP_READ_BUF_SIZE];
-    buffer_t buf = {
-        .data = read_buffer,
-        .capacity = TCP_READ_BUF_SIZE,
-        .size = 0};
+    buffer_t buf = {.data = read_buffer, .capacity = TCP_READ_BUF_SIZE, .size = 0};
 
-    if (mw->tcp_kiss_enabled)
-    {
-        kiss_message_t kiss_msg;
-        int n = tcp_server_listen(&mw->tcp_kiss_server, &buf);
-        for (int i = 0; i < n; ++i)
-            if (kiss_decoder_process(&mw->kiss_decoder, read_buffer[i], &kiss_msg))
-                kiss_input_callback(&kiss_msg);
-    }
+    LOGV("tcp kiss input ready");
+    kiss_input_bytes(mw, read_buffer, tcp_server_listen(&mw->tcp_kiss_server, &buf));
+}
 
-    if (mw->tcp_tnc2_enabled)
-    {
-        int n = tcp_server_listen(&mw->tcp_tnc2_server, &buf);
-        for (int i = 0; i < n; ++i)
-            line_reader_process(&mw->tcp_line_reader, read_buffer[i]);
-    }
+void on_tcp_tnc2_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    static unsigned char read_buffer[TCP_READ_BUF_SIZE];
+    buffer_t buf = {.data = read_buffer, .capacity = TCP_READ_BUF_SIZE, .size = 0};
+
+    LOGV("tcp tnc2 input ready");
+    tnc2_input_bytes(&mw->tcp_line_reader, read_buffer, tcp_server_listen(&mw->tcp_tnc2_server, &buf));
 }
 
-void process_udp_input(miniwolf_t *mw)
+void on_udp_kiss_ready(int fd, uint32_t revents, void *ctx)
 {
+    miniwolf_t *mw = ctx;
     static unsigned char read_buffer[TCP_READ_BUF_SIZE];
-    buffer_t buf = {
-        .data = read_buffer,
-        .capacity = TCP_READ_BUF_SIZE,
-        .size = 0};
+    buffer_t buf = {.data = read_buffer, .capacity = TCP_READ_BUF_SIZE, .size = 0};
+
+    LOGV("udp kiss input ready");
+    kiss_input_bytes(mw, read_buffer, udp_server_listen(&mw->udp_kiss_server, &buf));
+}
+
+void on_udp_tnc2_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    static unsigned char read_buffer[TCP_READ_BUF_SIZE];
+    buffer_t buf = {.data = read_buffer, .capacity = TCP_READ_BUF_SIZE, .size = 0};
+
+    LOGV("udp tnc2 input ready");
+    tnc2_input_bytes(&mw->udp_line_reader, read_buffer, udp_server_listen(&mw->udp_tnc2_server, &buf));
+}
+
+void on_uds_kiss_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    static unsigned char read_buffer[UDS_READ_BUF_SIZE];
+    buffer_t buf = {.data = read_buffer, .capacity = UDS_READ_BUF_SIZE, .size = 0};
+
+    LOGV("uds kiss input ready");
+    kiss_input_bytes(mw, read_buffer, uds_server_listen(&mw->uds_kiss_server, &buf));
+}
+
+void on_uds_tnc2_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    static unsigned char read_buffer[UDS_READ_BUF_SIZE];
+    buffer_t buf = {.data = read_buffer, .capacity = UDS_READ_BUF_SIZE, .size = 0};
 
-    if (mw->udp_kiss_listen_enabled)
+    LOGV("uds tnc2 input ready");
+    tnc2_input_bytes(&mw->uds_line_reader, read_buffer, uds_server_listen(&mw->uds_tnc2_server, &buf));
+}
+
+// The server notices the shutdown as end of stream on its next read and reports the disconnect
+static void metrics_client_drop(miniwolf_t *mw, int fd, const char *reason)
+{
+    LOG("metrics client %d %s, disconnecting", fd, reason);
+    shutdown(fd, SHUT_RDWR);
+    evloop_modify(&mw->evloop, fd, POLLIN);
+}
+
+// Writes what the socket takes, the rest waits for POLLOUT so a slow client never stalls the loop
+static void metrics_client_flush(miniwolf_t *mw, mw_metrics_client_t *client)
+{
+    int fd = client->fd;
+    int left = metrics_response_flush(&client->response, fd);
+    if (left > 0)
     {
-        kiss_message_t kiss_msg;
-        int n = udp_server_listen(&mw->udp_kiss_server, &buf);
-        for (int i = 0; i < n; ++i)
-            if (kiss_decoder_process(&mw->kiss_decoder, read_buffer[i], &kiss_msg))
-                kiss_input_callback(&kiss_msg);
+        evloop_modify(&mw->evloop, fd, POLLIN | POLLOUT);
+        return;
     }
 
-    if (mw->udp_tnc2_listen_enabled)
+    client->fd = -1;
+    if (left < 0)
+        metrics_client_drop(mw, fd, "write failed");
+    else
     {
-        int n = udp_server_listen(&mw->udp_tnc2_server, &buf);
-        for (int i = 0; i < n; ++i)
-            line_reader_process(&mw->udp_line_reader, read_buffer[i]);
+        shutdown(fd, SHUT_WR);
+        evloop_modify(&mw->evloop, fd, POLLIN);
     }
 }
 
-void process_uds_input(miniwolf_t *mw)
+// A free response buffer, or one held past its timeout by a client that does not read
+static mw_metrics_client_t *metrics_client_alloc(miniwolf_t *mw)
 {
-    static unsigned char read_buffer[UDS_READ_BUF_SIZE];
-    buffer_t buf = {
-        .data = read_buffer,
-        .capacity = UDS_READ_BUF_SIZE,
-        .size = 0};
+    uint64_t now_ms = loop_now_ms();
+    for (int i = 0; i < MW_METRICS_CLIENTS_MAX; i++)
+        if (mw->metrics_clients[i].fd < 0)
+            return &mw->metrics_clients[i];
 
-    if (mw->uds_kiss_enabled)
+    for (int i = 0; i < MW_METRICS_CLIENTS_MAX; i++)
     {
-        kiss_message_t kiss_msg;
-        int n = uds_server_listen(&mw->uds_kiss_server, &buf);
-        for (int i = 0; i < n; ++i)
-            if (kiss_decoder_process(&mw->kiss_decoder, read_buffer[i], &kiss_msg))
-                kiss_input_callback(&kiss_msg);
+        mw_metrics_client_t *client = &mw->metrics_clients[i];
+        if (now_ms - client->started_ms > MW_METRICS_CLIENT_TIMEOUT_MS)
+        {
+            metrics_client_drop(mw, client->fd, "too slow");
+            client->fd = -1;
+            return client;
+        }
     }
+    return NULL;
+}
 
-    if (mw->uds_tnc2_enabled)
+// The request is read here so the response goes to the client that sent it; end of stream
+// and errors are left for the server to read so it reports the disconnect
+static bool metrics_request(miniwolf_t *mw, int fd, uint32_t revents)
+{
+    mw_metrics_client_t *client = metrics_client_find(mw, fd);
+    if (client && (revents & POLLOUT))
+        metrics_client_flush(mw, client);
+    if (!(revents & (POLLIN | POLLHUP | POLLERR)))
+        return true;
+
+    char request[512];
+    ssize_t n = recv(fd, request, sizeof(request), MSG_DONTWAIT);
+    if (n <= 0)
+        return false;
+    if (client && client->fd == fd)
+        return true; // Still answering an earlier request
+
+    client = metrics_client_alloc(mw);
+    if (!client)
     {
-        int n = uds_server_listen(&mw->uds_tnc2_server, &buf);
-        for (int i = 0; i < n; ++i)
-            line_reader_process(&mw->uds_line_reader, read_buffer[i]);
+        metrics_client_drop(mw, fd, "has no response buffer left");
+        return true;
     }
+    client->fd = fd;
+    client->started_ms = loop_now_ms();
+    metrics_respond(&client->response, request, (int)n);
+    metrics_client_flush(mw, client);
+    return true;
+}
+
+void on_metrics_tcp_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    static unsigned char read_buffer[TCP_READ_BUF_SIZE];
+    buffer_t buf = {.data = read_buffer, .capacity = TCP_READ_BUF_SIZE, .size = 0};
+
+    if (fd != mw->metrics_tcp_server.listen_fd && metrics_request(mw, fd, revents))
+        return;
+    tcp_server_listen(&mw->metrics_tcp_server, &buf);
+}
+
+void on_metrics_uds_ready(int fd, uint32_t revents, void *ctx)
+{
+    miniwolf_t *mw = ctx;
+    static unsigned char read_buffer[UDS_READ_BUF_SIZE];
+    buffer_t buf = {.data = read_buffer, .capacity = UDS_READ_BUF_SIZE, .size = 0};
+
+    if (fd != mw->metrics_uds_server.listen_fd && metrics_request(mw, fd, revents))
+        return;
+    uds_server_listen(&mw->metrics_uds_server, &buf);
 }
@@ -73,10 +73,25 @@ int main(int argc, char *argv[])
     if (opts.rate <= 0)
         EXIT("Invalid sample rate specified");
 
+    if (opts.channels < 1 || opts.channels > AUD_CHANNELS_MAX)
+        EXIT("Invalid channel count specified");
+
     LOG("Using device '%s'", opts.dev_name);
 
-    if (aud_configure(opts.dev_name, opts.rate, opts.dev_input, opts.dev_output))
+    aud_params_t aud_params = {
+        .device_name = opts.dev_name,
+        .sample_rate = opts.rate,
+        .channels = opts.channels,
+        .do_input = opts.dev_input,
+        .do_output = opts.dev_output,
+        .use_mmap = opts.mmap,
+        .period_ms = opts.period_ms,
+        .buffer_ms = opts.buffer_ms,
+        .period_max_ms = opts.period_max_ms,
+        .sample_format = opts.sample_format};
+    if (aud_configure(&aud_params))
         EXIT("Failed to configure sound device");
+    opts.channels = aud_channels();
 
     miniwolf_init(&g_miniwolf, &opts);
 
@@ -1,19 +1,40 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <stdint.h>
 #include <inttypes.h>
 #include <math.h>
 #include <time.h>
 #include <argp.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "modem.h"
 #include "ax25.h"
 #include "tnc2.h"
 #include "squelch.h"
 #include "filter.h"
+#include "pcm.h"
+#include "csma.h"
 #include "common.h"
 
 #define CHUNK_SIZE 2048
+#define BENCH_MANIFEST_MAX 256
+#define BENCH_JOBS_MAX 64
+#define BENCH_ATTR_BLOCK 256   // Chains are stepped in blocks this size, short enough to hold at most one frame end
+#define BENCH_ATTR_WINDOW_S 1  // Same CRC within this many seconds is the same frame from another chain
+#define BENCH_PROGRESS_S 10    // Default --progress interval for pipes and FIFOs
+
+enum
+{
+    BENCH_OPT_PACE = 0x100,
+    BENCH_OPT_PROGRESS,
+};
 
 typedef struct bench_args
 {
@@ -27,113 +48,189 @@ typedef struct bench_args
     int use_squelch;
     float squelch_strength;
     int save_squelched;
+    int quad_cross;
+    int decimate;
+    float csma_load; // Offered frames per minute, 0 disables the channel access simulation
+    int persist;
+    int slottime_ms;
+    int airtime_ms;
+    char *manifest_file;
+    int jobs;
+    bool attribute;
+    bool pace;
+    int progress_s;
 } bench_args_t;
 
-static void byteswap16(uint16_t *v)
+// A distinct frame and the chains that decoded it
+typedef struct bench_attr_frame
 {
-    *v = (((*v & 0xFF) << 8) | ((*v >> 8) & 0xFF));
-}
+    uint16_t crc;
+    double time_s;
+    uint32_t chains;
+} bench_attr_frame_t;
 
-static void byteswap32(uint32_t *v)
+// One manifest entry: a recording, how to read it and what it is expected to decode
+typedef struct bench_job
 {
-    *v = (((*v & 0xFF) << 24) | (((*v >> 8) & 0xFF) << 16) |
-          (((*v >> 16) & 0xFF) << 8) | ((*v >> 24) & 0xFF));
-}
+    char path[512];
+    char format[16];
+    pcm_codec_t codec;
+    int rate;
+    float gain_2200;
+    int expected;
+    float min_speed; // x realtime, 0 for no check
+
+    int decoded;
+    double audio_s;
+    double cpu_s;
+    bool failed;
+} bench_job_t;
+
+// Raw samples of a recording, mapped when possible and otherwise streamed through a fixed buffer
+typedef struct bench_input
+{
+    int fd;
+    const uint8_t *map;
+    size_t map_size;
+    size_t pos;
+    int sample_bytes;
+    uint8_t buffer[CHUNK_SIZE * 8];
+    size_t fill;     // Bytes in buffer, a partial sample is carried over to the next read
+    size_t consumed; // Bytes of buffer handed out by the last bench_input_next
+} bench_input_t;
 
-static void byteswap64(uint64_t *v)
+typedef struct bench_pool
 {
-    *v = (((*v & 0xFF) << 56) | (((*v >> 8) & 0xFF) << 48) |
-          (((*v >> 16) & 0xFF) << 40) | (((*v >> 24) & 0xFF) << 32) |
-          (((*v >> 32) & 0xFF) << 24) | (((*v >> 40) & 0xFF) << 16) |
-          (((*v >> 48) & 0xFF) << 8) | ((*v >> 56) & 0xFF));
+    const bench_args_t *args;
+    bench_job_t *jobs;
+    int count;
+    atomic_int next;
+} bench_pool_t;
+
+#define BENCH_TX_QUEUE 64
+
+// One simulated station transmitting into the recording, blind or with CSMA on the demodulator's DCD.
+// A transmission counts as collided if the recorded channel was busy at any point during it.
+typedef struct bench_tx_sim
+{
+    const char *name;
+    bool use_csma;
+    csma_t csma;
+    uint64_t queue[BENCH_TX_QUEUE]; // Arrival times of waiting frames
+    int queue_head;
+    int queue_count;
+    bool transmitting;
+    bool collided;
+    uint64_t tx_end_ms;
+    int sent;
+    int collisions;
+    int dropped;
+    uint64_t total_wait_ms;
+} bench_tx_sim_t;
+
+static void bench_tx_sim_init(bench_tx_sim_t *sim, const char *name, const csma_params_t *params)
+{
+    memset(sim, 0, sizeof(*sim));
+    sim->name = name;
+    sim->use_csma = params != NULL;
+    if (params)
+        csma_init(&sim->csma, params, 12345);
 }
 
-static float convert_sample(const uint8_t *raw, char type, int bits, int little_endian)
+static void bench_tx_sim_offer(bench_tx_sim_t *sim, uint64_t now_ms)
 {
-    union
-    {
-        float f32;
-        double f64;
-        int8_t s8;
-        int16_t s16;
-        int32_t s32;
-        uint8_t u8;
-        uint16_t u16;
-        uint32_t u32;
-    } val;
-
-    if (type == 'F')
+    if (sim->queue_count == BENCH_TX_QUEUE)
     {
-        if (bits == 32)
-        {
-            memcpy(&val.f32, raw, 4);
-            if (!little_endian)
-                byteswap32((uint32_t *)&val.f32);
-            return val.f32;
-        }
-        else if (bits == 64)
-        {
-            memcpy(&val.f64, raw, 8);
-            if (!little_endian)
-                byteswap64((uint64_t *)&val.f64);
-            return (float)val.f64;
-        }
-    }
-    else if (type == 'S')
-    {
-        if (bits == 8)
-        {
-            memcpy(&val.s8, raw, 1);
-            return val.s8 / 128.0f;
-        }
-        else if (bits == 16)
-        {
-            memcpy(&val.s16, raw, 2);
-            if (!little_endian)
-                byteswap16((uint16_t *)&val.s16);
-            return val.s16 / 32768.0f;
-        }
-        else if (bits == 32)
-        {
-            memcpy(&val.s32, raw, 4);
-            if (!little_endian)
-                byteswap32((uint32_t *)&val.s32);
-            return val.s32 / 2147483648.0f;
-        }
+        sim->dropped++;
+        return;
     }
-    else if (type == 'U')
+    sim->queue[(sim->queue_head + sim->queue_count++) % BENCH_TX_QUEUE] = now_ms;
+}
+
+static void bench_tx_sim_step(bench_tx_sim_t *sim, bool busy, uint64_t now_ms, int airtime_ms)
+{
+    if (sim->transmitting)
     {
-        if (bits == 8)
-        {
-            memcpy(&val.u8, raw, 1);
-            return (val.u8 / 128.0f) - 1.0f;
-        }
-        else if (bits == 16)
-        {
-            memcpy(&val.u16, raw, 2);
-            if (!little_endian)
-                byteswap16(&val.u16);
-            return (val.u16 / 65536.0f) * 2.0f - 1.0f;
-        }
-        else if (bits == 32)
-        {
-            memcpy(&val.u32, raw, 4);
-            if (!little_endian)
-                byteswap32(&val.u32);
-            return (val.u32 / 4294967296.0f) * 2.0f - 1.0f;
-        }
+        sim->collided |= busy;
+        if (now_ms < sim->tx_end_ms)
+            return;
+        sim->transmitting = false;
+        sim->sent++;
+        sim->collisions += sim->collided;
+        if (sim->use_csma)
+            csma_reset(&sim->csma);
     }
 
-    return 0.0f;
+    if (sim->queue_count == 0)
+        return;
+
+    int wait_ms;
+    if (sim->use_csma && csma_poll(&sim->csma, busy, now_ms, &wait_ms) != CSMA_TRANSMIT)
+        return;
+
+    sim->total_wait_ms += now_ms - sim->queue[sim->queue_head];
+    sim->queue_head = (sim->queue_head + 1) % BENCH_TX_QUEUE;
+    sim->queue_count--;
+    sim->transmitting = true;
+    sim->collided = busy;
+    sim->tx_end_ms = now_ms + airtime_ms;
+}
+
+static void bench_tx_sim_report(const bench_tx_sim_t *sim, double minutes)
+{
+    int delivered = sim->sent - sim->collisions;
+    LOG("%s: %d sent, %d collided (%.1f%%), %d dropped, %.2f delivered/min, mean access delay %.0f ms",
+        sim->name, sim->sent, sim->collisions, sim->sent ? 100.0 * sim->collisions / sim->sent : 0.0,
+        sim->dropped, minutes > 0 ? delivered / minutes : 0.0,
+        sim->sent ? (double)sim->total_wait_ms / sim->sent : 0.0);
+}
+
+// Maps a --format type/bit count pair onto a conversion codec, S24 is packed 3 byte samples
+static int bench_codec_init(pcm_codec_t *codec, char type, int bits, int little_endian)
+{
+    pcm_format_t format;
+    if (type == 'F' && bits == 32)
+        format = PCM_FORMAT_F32;
+    else if (type == 'F' && bits == 64)
+        format = PCM_FORMAT_F64;
+    else if (type == 'S' && bits == 8)
+        format = PCM_FORMAT_S8;
+    else if (type == 'S' && bits == 16)
+        format = PCM_FORMAT_S16;
+    else if (type == 'S' && bits == 24)
+        format = PCM_FORMAT_S24_3;
+    else if (type == 'S' && bits == 32)
+        format = PCM_FORMAT_S32;
+    else if (type == 'U' && bits == 8)
+        format = PCM_FORMAT_U8;
+    else if (type == 'U' && bits == 16)
+        format = PCM_FORMAT_U16;
+    else if (type == 'U' && bits == 32)
+        format = PCM_FORMAT_U32;
+    else
+        return -1;
+
+    return pcm_codec_init(codec, format, little_endian);
 }
 
 static struct argp_option bench_options[] = {
-    {"file", 'f', "FILE", 0, "Input raw audio file (required)", 1},
+    {"file", 'f', "FILE", 0, "Input raw audio file, - or a FIFO to stream (required unless --manifest)", 1},
+    {"manifest", 'm', "FILE", 0, "Decode every recording listed, one per line: FILE FORMAT[BE] RATE EQ2200 EXPECTED [MIN_SPEED]", 1},
+    {"jobs", 'j', "N", 0, "Recordings decoded in parallel with --manifest (default: online CPUs)", 1},
+    {"attribute", 'A', 0, 0, "Run every demodulator chain without deduplication and report which chains decoded each frame", 1},
     {"rate", 'r', "RATE", 0, "Sample rate in Hz (default: 48000)", 1},
-    {"format", 'F', "FORMAT", 0, "Audio format: F32, F64, S8, S16, S32, U8, U16, U32 (default: F32)", 2},
+    {"format", 'F', "FORMAT", 0, "Audio format: F32, F64, S8, S16, S24, S32, U8, U16, U32 (default: F32)", 2},
     {"endian", 'e', "ENDIAN", 0, "Byte order: LE (little-endian, default) or BE (big-endian)", 2},
     {"eq2200", '2', "GAIN", 0, "Extra gain to apply at 2200Hz in dB (default: 0.0)", 2},
     {"squelch", 's', "STRENGTH", 0, "Enable squelch with given strength (0.0-1.0)", 2},
+    {"quad-cross", 'q', 0, 0, "Use the cross-product quadrature discriminator instead of atan2", 2},
+    {"decimate", 'D', "FACTOR", OPTION_ARG_OPTIONAL, "Demodulate at rate / FACTOR behind a polyphase decimator (default: chosen from rate)", 2},
+    {"csma", 'c', "FRAMES_PER_MIN", 0, "Simulate transmitting at this offered load, blind and with CSMA on DCD", 3},
+    {"persist", 'p', "P", 0, "CSMA persistence 0-255 (default: 63)", 3},
+    {"slottime", 't', "MS", 0, "CSMA slot time (default: 100)", 3},
+    {"airtime", 'a', "MS", 0, "Simulated frame duration including TXDELAY (default: 800)", 3},
+    {"pace", BENCH_OPT_PACE, 0, 0, "Throttle processing to real time, in 10 ms blocks", 3},
+    {"progress", BENCH_OPT_PROGRESS, "SEC", 0, "Report running decode rate every SEC seconds (default: 10 for streams, 0 for files)", 3},
     {"save-squelched", 'S', 0, 0, "Save squelched audio to squelched_<input>.raw (requires --squelch)", 3},
     {"verbose", 'v', 0, 0, "Enable verbose logs", 3},
     {"debug", 'V', 0, 0, "Enable verbose and debugging logs", 3},
@@ -147,6 +244,21 @@ static error_t bench_parse_opt(int key, char *arg, struct argp_state *state)
     case 'f':
         args->input_file = arg;
         break;
+    case 'm':
+        args->manifest_file = arg;
+        break;
+    case 'j':
+        args->jobs = atoi(arg);
+        break;
+    case 'A':
+        args->attribute = true;
+        break;
+    case BENCH_OPT_PACE:
+        args->pace = true;
+        break;
+    case BENCH_OPT_PROGRESS:
+        args->progress_s = atoi(arg);
+        break;
     case 'r':
         args->rate = atoi(arg);
         break;
@@ -173,6 +285,24 @@ static error_t bench_parse_opt(int key, char *arg, struct argp_state *state)
     case 'S':
         args->save_squelched = 1;
         break;
+    case 'q':
+        args->quad_cross = 1;
+        break;
+    case 'D':
+        args->decimate = arg ? atoi(arg) : -1;
+        break;
+    case 'c':
+        args->csma_load = atof(arg);
+        break;
+    case 'p':
+        args->persist = atoi(arg);
+        break;
+    case 't':
+        args->slottime_ms = atoi(arg);
+        break;
+    case 'a':
+        args->airtime_ms = atoi(arg);
+        break;
     case 'v':
         args->log_level = LOG_LEVEL_VERBOSE;
         break;
@@ -205,10 +335,539 @@ static void bench_args_parse(int argc, char *argv[], bench_args_t *args)
     args->use_squelch = 0;
     args->squelch_strength = 0.50f;
     args->save_squelched = 0;
+    args->quad_cross = 0;
+    args->decimate = 0;
+    args->csma_load = 0.0f;
+    args->persist = CSMA_PERSIST_DEFAULT;
+    args->slottime_ms = CSMA_SLOTTIME_MS_DEFAULT;
+    args->airtime_ms = 800;
+    args->manifest_file = NULL;
+    args->jobs = 0;
+    args->attribute = false;
+    args->pace = false;
+    args->progress_s = -1;
 
     argp_parse(&bench_argp, argc, argv, 0, 0, args);
 }
 
+static int bench_input_open(bench_input_t *in, const char *path, int sample_bytes)
+{
+    in->fd = -1;
+    in->map = NULL;
+    in->map_size = 0;
+    in->pos = 0;
+    in->sample_bytes = sample_bytes;
+    in->fill = 0;
+    in->consumed = 0;
+
+    int fd = strcmp(path, "-") == 0 ? dup(STDIN_FILENO) : open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        void *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            in->map = map;
+            in->map_size = st.st_size;
+            close(fd);
+            return 0;
+        }
+    }
+
+    in->fd = fd;
+    return 0;
+}
+
+// Points raw at up to max samples, returns the number of samples, 0 at end of input.
+// Streams hand out whatever whole samples have arrived rather than waiting for max.
+static size_t bench_input_next(bench_input_t *in, size_t max, const uint8_t **raw)
+{
+    if (in->map)
+    {
+        size_t count = (in->map_size - in->pos) / in->sample_bytes;
+        if (count > max)
+            count = max;
+        *raw = in->map + in->pos;
+        in->pos += count * in->sample_bytes;
+        return count;
+    }
+
+    in->fill -= in->consumed;
+    memmove(in->buffer, in->buffer + in->consumed, in->fill);
+    in->consumed = 0;
+
+    size_t want = max * in->sample_bytes;
+    if (want > sizeof(in->buffer))
+        want = sizeof(in->buffer);
+    while (in->fill < (size_t)in->sample_bytes)
+    {
+        ssize_t n = read(in->fd, in->buffer + in->fill, want - in->fill);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+        {
+            if (n < 0)
+                LOG("Error: read failed: %s", strerror(errno));
+            return 0;
+        }
+        in->fill += n;
+    }
+
+    size_t count = in->fill / in->sample_bytes;
+    if (count > max)
+        count = max;
+    in->consumed = count * in->sample_bytes;
+    *raw = in->buffer;
+    return count;
+}
+
+static void bench_input_close(bench_input_t *in)
+{
+    if (in->map)
+        munmap((void *)in->map, in->map_size);
+    if (in->fd >= 0)
+        close(in->fd);
+    in->map = NULL;
+    in->fd = -1;
+}
+
+static double bench_thread_cpu_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static double bench_wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// FORMAT as for --format with an optional BE/LE suffix, e.g. S16 or S24BE
+static int bench_format_parse(const char *format, pcm_codec_t *codec)
+{
+    char *end;
+    int bits = (int)strtol(format + 1, &end, 10);
+    int little_endian = strcasecmp(end, "BE") != 0;
+    if (*end && strcasecmp(end, "BE") != 0 && strcasecmp(end, "LE") != 0)
+        return -1;
+    return bench_codec_init(codec, format[0], bits, little_endian);
+}
+
+// Blank lines and lines starting with # are skipped, relative paths are taken from the manifest's directory
+static int bench_manifest_load(const char *manifest_file, bench_job_t *jobs, int max)
+{
+    FILE *fp = fopen(manifest_file, "r");
+    if (!fp)
+    {
+        LOG("Error: Cannot open manifest '%s'.", manifest_file);
+        return -1;
+    }
+
+    const char *slash = strrchr(manifest_file, '/');
+    int dir_len = slash ? (int)(slash - manifest_file) + 1 : 0;
+
+    char line[1024];
+    int count = 0;
+    int line_no = 0;
+    while (fgets(line, sizeof(line), fp))
+    {
+        line_no++;
+        char *p = line + strspn(line, " \t");
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0')
+            continue;
+        if (count == max)
+        {
+            LOG("Error: More than %d recordings in manifest.", max);
+            goto ERROR;
+        }
+
+        bench_job_t *job = &jobs[count];
+        memset(job, 0, sizeof(*job));
+        char file[512];
+        int fields = sscanf(p, "%511s %15s %d %f %d %f", file, job->format, &job->rate, &job->gain_2200,
+                            &job->expected, &job->min_speed);
+        if (fields < 5 || job->rate <= 0 || bench_format_parse(job->format, &job->codec) < 0)
+        {
+            LOG("Error: %s:%d: expected FILE FORMAT RATE EQ2200 EXPECTED [MIN_SPEED].", manifest_file, line_no);
+            goto ERROR;
+        }
+        int dir = file[0] == '/' ? 0 : dir_len;
+        if (snprintf(job->path, sizeof(job->path), "%.*s%s", dir, manifest_file, file) >= (int)sizeof(job->path))
+        {
+            LOG("Error: %s:%d: path too long.", manifest_file, line_no);
+            goto ERROR;
+        }
+        count++;
+    }
+
+    fclose(fp);
+    return count;
+
+ERROR:
+    fclose(fp);
+    return -1;
+}
+
+// Decoder state of one recording, too large for a worker thread's stack
+typedef struct bench_decoder
+{
+    struct md_multi_rx demod;
+    bf_biquad_t hbf_filter;
+    sql_t squelch;
+    bench_input_t input;
+    float samples[CHUNK_SIZE];
+    uint8_t frame_buffer[512];
+} bench_decoder_t;
+
+static void bench_job_run(bench_job_t *job, const bench_args_t *args)
+{
+    bench_decoder_t *dec = malloc(sizeof(bench_decoder_t));
+    if (!dec || bench_input_open(&dec->input, job->path, job->codec.sample_bytes) < 0)
+    {
+        LOG("Error: Cannot open file '%s'.", job->path);
+        job->failed = true;
+        free(dec);
+        return;
+    }
+
+    float sample_rate = (float)job->rate;
+    double cpu_start = bench_thread_cpu_s();
+
+    bf_hbf_init(&dec->hbf_filter, 4, 2200.0f, sample_rate, job->gain_2200);
+    demod_type_t types = (args->quad_cross ? DEMOD_QUADRATURE_FAST : DEMOD_QUADRATURE) | DEMOD_ALL_GOERTZEL;
+    int decimation = args->decimate < 0 ? md_multi_rx_decimation(sample_rate) : (args->decimate > 1 ? args->decimate : 1);
+    md_multi_rx_init_decimated(&dec->demod, sample_rate, types, decimation);
+    sql_params_t sql_params = {
+        .sample_rate = sample_rate,
+        .init_threshold = 0.045f,
+        .strength = args->squelch_strength};
+    if (args->use_squelch)
+        sql_init(&dec->squelch, &sql_params, &sql_params_default);
+
+    uint64_t total_samples = 0;
+    time_t time_zero = time(NULL);
+    const uint8_t *raw;
+    size_t read_count;
+    while ((read_count = bench_input_next(&dec->input, CHUNK_SIZE, &raw)) > 0)
+    {
+        pcm_to_float(&job->codec, raw, dec->samples, read_count);
+        for (size_t i = 0; i < read_count; i++)
+        {
+            dec->samples[i] = bf_biquad_filter(&dec->hbf_filter, dec->samples[i]);
+            if (args->use_squelch && !sql_process(&dec->squelch, dec->samples[i]))
+                dec->samples[i] = 0.0f;
+        }
+        total_samples += read_count;
+
+        float_buffer_t sample_buf = {.data = dec->samples, .capacity = CHUNK_SIZE, .size = read_count};
+        buffer_t frame_buf = {.data = dec->frame_buffer, .capacity = sizeof(dec->frame_buffer), .size = 0};
+        time_t time_sim = time_zero + (time_t)(total_samples / job->rate);
+        if (md_multi_rx_process_at(&dec->demod, &sample_buf, &frame_buf, time_sim) <= 0)
+            continue;
+
+        ax25_packet_t packet;
+        if (ax25_packet_unpack(&packet, &frame_buf) == 0)
+            job->decoded++;
+    }
+
+    job->cpu_s = bench_thread_cpu_s() - cpu_start;
+    job->audio_s = total_samples / sample_rate;
+    LOGV("%s: %d packets in %.1f s of audio", job->path, job->decoded, job->audio_s);
+
+    md_multi_rx_free(&dec->demod);
+    bf_biquad_free(&dec->hbf_filter);
+    bench_input_close(&dec->input);
+    free(dec);
+}
+
+static void *bench_pool_worker(void *arg)
+{
+    bench_pool_t *pool = arg;
+    int i;
+    while ((i = atomic_fetch_add(&pool->next, 1)) < pool->count)
+        bench_job_run(&pool->jobs[i], pool->args);
+    return NULL;
+}
+
+// Returns the number of regressed or failed recordings
+static int bench_manifest_report(const bench_job_t *jobs, int count, double wall_s)
+{
+    int regressions = 0;
+    int decoded = 0;
+    int expected = 0;
+    double audio_s = 0.0;
+    double cpu_s = 0.0;
+
+    LOG("%-40s %8s %8s %6s %9s %8s", "File", "Expected", "Decoded", "Delta", "Audio s", "x RT");
+    for (int i = 0; i < count; i++)
+    {
+        const bench_job_t *job = &jobs[i];
+        const char *name = strrchr(job->path, '/') ? strrchr(job->path, '/') + 1 : job->path;
+        if (job->failed)
+        {
+            LOG("%-40s %8d %8s %6s %9s %8s  FAILED", name, job->expected, "-", "-", "-", "-");
+            regressions++;
+            continue;
+        }
+
+        double speed = job->cpu_s > 0 ? job->audio_s / job->cpu_s : 0.0;
+        bool fewer = job->decoded < job->expected;
+        bool slow = job->min_speed > 0 && speed < job->min_speed;
+        LOG("%-40s %8d %8d %+6d %9.1f %8.1f%s%s", name, job->expected, job->decoded, job->decoded - job->expected,
+            job->audio_s, speed, fewer ? "  REGRESSED" : "", slow ? "  SLOW" : "");
+        regressions += fewer || slow;
+        decoded += job->decoded;
+        expected += job->expected;
+        audio_s += job->audio_s;
+        cpu_s += job->cpu_s;
+    }
+
+    LOG("Total: %d/%d packets (%+d), %.1f s of audio, %.1fx realtime per core, %.1fx realtime in %.2f s wall",
+        decoded, expected, decoded - expected, audio_s, cpu_s > 0 ? audio_s / cpu_s : 0.0,
+        wall_s > 0 ? audio_s / wall_s : 0.0, wall_s);
+    if (regressions > 0)
+        LOG("%d of %d recordings regressed", regressions, count);
+    return regressions;
+}
+
+static int bench_manifest_run(const bench_args_t *args)
+{
+    static bench_job_t jobs[BENCH_MANIFEST_MAX];
+    int count = bench_manifest_load(args->manifest_file, jobs, BENCH_MANIFEST_MAX);
+    if (count < 0)
+        return EXIT_FAILURE;
+    if (count == 0)
+    {
+        LOG("Error: No recordings in manifest '%s'.", args->manifest_file);
+        return EXIT_FAILURE;
+    }
+    if (args->csma_load > 0.0f || args->save_squelched)
+        LOG("--csma and --save-squelched are ignored with --manifest");
+
+    int threads = args->jobs > 0 ? args->jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (threads < 1)
+        threads = 1;
+    if (threads > BENCH_JOBS_MAX)
+        threads = BENCH_JOBS_MAX;
+    if (threads > count)
+        threads = count;
+    LOGV("Decoding %d recordings on %d threads", count, threads);
+
+    bench_pool_t pool = {.args = args, .jobs = jobs, .count = count};
+    atomic_init(&pool.next, 0);
+    pthread_t workers[BENCH_JOBS_MAX];
+    int started = 0;
+
+    double wall_start = bench_wall_s();
+    for (; started < threads; started++)
+        if (pthread_create(&workers[started], NULL, bench_pool_worker, &pool) != 0)
+            break;
+    if (started == 0)
+        bench_pool_worker(&pool);
+    for (int t = 0; t < started; t++)
+        pthread_join(workers[t], NULL);
+    double wall_s = bench_wall_s() - wall_start;
+
+    return bench_manifest_report(jobs, count, wall_s) > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+static const char *bench_demod_name(demod_type_t type)
+{
+    switch (type)
+    {
+    case DEMOD_GOERTZEL_OPTIM:
+        return "goertzel-optim";
+    case DEMOD_GOERTZEL_PESIM:
+        return "goertzel-pesim";
+    case DEMOD_QUADRATURE:
+        return "quadrature";
+    case DEMOD_QUADRATURE_FAST:
+        return "quadrature-fast";
+    default:
+        return "?";
+    }
+}
+
+// Merges the frame into the one with the same CRC decoded by another chain moments ago, or adds it
+static int bench_attr_add(bench_attr_frame_t **frames, int *count, int *capacity, uint16_t crc, double time_s, int chain)
+{
+    for (int i = *count - 1; i >= 0 && time_s - (*frames)[i].time_s <= BENCH_ATTR_WINDOW_S; i--)
+    {
+        if ((*frames)[i].crc == crc && !((*frames)[i].chains & (1u << chain)))
+        {
+            (*frames)[i].chains |= 1u << chain;
+            return 0;
+        }
+    }
+
+    if (*count == *capacity)
+    {
+        int new_capacity = *capacity ? *capacity * 2 : 256;
+        bench_attr_frame_t *grown = realloc(*frames, new_capacity * sizeof(bench_attr_frame_t));
+        if (!grown)
+            return -1;
+        *frames = grown;
+        *capacity = new_capacity;
+    }
+    (*frames)[(*count)++] = (bench_attr_frame_t){.crc = crc, .time_s = time_s, .chains = 1u << chain};
+    return 0;
+}
+
+static void bench_attr_report(const struct md_multi_rx *mrx, const bench_attr_frame_t *frames, int count,
+                              const double *chain_cpu_s, double decim_cpu_s, double audio_s)
+{
+    int decoded[MD_RX_MAX] = {0};
+    int unique[MD_RX_MAX] = {0};
+    int both[MD_RX_MAX][MD_RX_MAX] = {{0}};
+    int either[MD_RX_MAX][MD_RX_MAX] = {{0}};
+
+    for (int f = 0; f < count; f++)
+    {
+        uint32_t chains = frames[f].chains;
+        for (int i = 0; i < mrx->count; i++)
+        {
+            bool in_i = chains & (1u << i);
+            decoded[i] += in_i;
+            unique[i] += chains == (1u << i);
+            for (int j = 0; j < mrx->count; j++)
+            {
+                bool in_j = chains & (1u << j);
+                both[i][j] += in_i && in_j;
+                either[i][j] += in_i || in_j;
+            }
+        }
+    }
+
+    LOG("Distinct frames: %d in %.1f s of audio, decimation %.3f s CPU", count, audio_s, decim_cpu_s);
+    LOG("%-2s %-16s %8s %8s %9s %12s", "#", "Chain", "Decoded", "Unique", "CPU s", "Unique/CPU ms");
+    for (int i = 0; i < mrx->count; i++)
+    {
+        double cpu_ms = chain_cpu_s[i] * 1000.0;
+        LOG("%-2d %-16s %8d %8d %9.3f %12.4f", i, bench_demod_name(mrx->rxs[i].demod.type), decoded[i], unique[i],
+            chain_cpu_s[i], cpu_ms > 0 ? unique[i] / cpu_ms : 0.0);
+    }
+
+    // Upper triangle: frames decoded by both chains, lower triangle: by either, diagonal: by the chain
+    char line[128];
+    int len = snprintf(line, sizeof(line), "%-2s", "");
+    for (int j = 0; j < mrx->count; j++)
+        len += snprintf(line + len, sizeof(line) - len, " %7d", j);
+    LOG("Both (above diagonal) / either (below diagonal):");
+    LOG("%s", line);
+    for (int i = 0; i < mrx->count; i++)
+    {
+        len = snprintf(line, sizeof(line), "%-2d", i);
+        for (int j = 0; j < mrx->count; j++)
+            len += snprintf(line + len, sizeof(line) - len, " %7d", j > i ? both[i][j] : (j < i ? either[i][j] : decoded[i]));
+        LOG("%s", line);
+    }
+}
+
+// Every chain runs standalone on the shared decimated input, so a Goertzel front-end is charged to each chain using it
+static int bench_attribute_run(const bench_args_t *args, const pcm_codec_t *codec)
+{
+    static bench_input_t input;
+    if (bench_input_open(&input, args->input_file, codec->sample_bytes) < 0)
+    {
+        LOG("Error: Cannot open file '%s'.", args->input_file);
+        return EXIT_FAILURE;
+    }
+
+    float sample_rate = (float)args->rate;
+    bf_biquad_t hbf_filter;
+    bf_hbf_init(&hbf_filter, 4, 2200.0f, sample_rate, args->gain_2200);
+    int decimation = args->decimate < 0 ? md_multi_rx_decimation(sample_rate) : (args->decimate > 1 ? args->decimate : 1);
+    static struct md_multi_rx mrx;
+    demod_type_t types = (args->quad_cross ? DEMOD_QUADRATURE_FAST : DEMOD_QUADRATURE) | DEMOD_ALL_GOERTZEL;
+    md_multi_rx_init_decimated(&mrx, sample_rate, types, decimation);
+    sql_t squelch;
+    sql_params_t sql_params = {
+        .sample_rate = sample_rate,
+        .init_threshold = 0.045f,
+        .strength = args->squelch_strength};
+    if (args->use_squelch)
+        sql_init(&squelch, &sql_params, &sql_params_default);
+
+    bench_attr_frame_t *frames = NULL;
+    int frame_count = 0;
+    int frame_capacity = 0;
+    double chain_cpu_s[MD_RX_MAX] = {0};
+    double decim_cpu_s = 0.0;
+    int exit_code = EXIT_SUCCESS;
+    uint64_t processed = 0;
+    uint64_t total_samples = 0;
+
+    static float samples[CHUNK_SIZE];
+    static float decimated[CHUNK_SIZE];
+    uint8_t frame_data[MD_RX_FRAME_MAX];
+    const uint8_t *raw;
+    size_t read_count;
+    while ((read_count = bench_input_next(&input, CHUNK_SIZE, &raw)) > 0)
+    {
+        pcm_to_float(codec, raw, samples, read_count);
+        for (size_t i = 0; i < read_count; i++)
+        {
+            samples[i] = bf_biquad_filter(&hbf_filter, samples[i]);
+            if (args->use_squelch && !sql_process(&squelch, samples[i]))
+                samples[i] = 0.0f;
+        }
+        total_samples += read_count;
+
+        int n = (int)read_count;
+        const float *in = samples;
+        if (mrx.decim_factor > 1)
+        {
+            double start = bench_thread_cpu_s();
+            n = decim_process_block(&mrx.decim, samples, decimated, n);
+            decim_cpu_s += bench_thread_cpu_s() - start;
+            in = decimated;
+        }
+
+        for (int c = 0; c < mrx.count; c++)
+        {
+            double start = bench_thread_cpu_s();
+            for (int offset = 0; offset < n; offset += BENCH_ATTR_BLOCK)
+            {
+                int block = n - offset < BENCH_ATTR_BLOCK ? n - offset : BENCH_ATTR_BLOCK;
+                float_buffer_t block_buf = {.data = (float *)in + offset, .capacity = block, .size = block};
+                buffer_t frame_buf = {.data = frame_data, .capacity = sizeof(frame_data), .size = 0};
+                uint16_t crc = 0;
+                if (md_rx_process(&mrx.rxs[c], &block_buf, &frame_buf, &crc) <= 0)
+                    continue;
+
+                ax25_packet_t packet;
+                if (ax25_packet_unpack(&packet, &frame_buf) != 0)
+                    continue;
+                double time_s = (double)(processed + offset + block) * mrx.decim_factor / sample_rate;
+                if (bench_attr_add(&frames, &frame_count, &frame_capacity, crc, time_s, c) < 0)
+                {
+                    LOG("Error: Out of memory after %d frames.", frame_count);
+                    exit_code = EXIT_FAILURE;
+                    goto END;
+                }
+            }
+            chain_cpu_s[c] += bench_thread_cpu_s() - start;
+        }
+        processed += n;
+    }
+
+    bench_attr_report(&mrx, frames, frame_count, chain_cpu_s, decim_cpu_s, total_samples / sample_rate);
+
+END:
+    free(frames);
+    md_multi_rx_free(&mrx);
+    bf_biquad_free(&hbf_filter);
+    bench_input_close(&input);
+    return exit_code;
+}
+
 int main(int argc, char *argv[])
 {
     int exit_code = EXIT_SUCCESS;
@@ -217,9 +876,12 @@ int main(int argc, char *argv[])
     _log_level = args.log_level;
     _func_pad = -1;
 
+    if (args.manifest_file)
+        return bench_manifest_run(&args);
+
     if (!args.input_file)
     {
-        LOG("Error: --file <input_file> required.");
+        LOG("Error: --file <input_file> or --manifest <manifest_file> required.");
         goto ERROR;
     }
 
@@ -229,13 +891,16 @@ int main(int argc, char *argv[])
         goto ERROR;
     }
 
-    if ((args.type == 'F' && (args.bits != 32 && args.bits != 64)) ||
-        (args.type != 'F' && (args.bits != 8 && args.bits != 16 && args.bits != 32)))
+    pcm_codec_t codec;
+    if (bench_codec_init(&codec, args.type, args.bits, args.little_endian) < 0)
     {
-        LOG("Error: Invalid format. F: 32/64, S/U: 8/16/32.");
+        LOG("Error: Invalid format. F: 32/64, S: 8/16/24/32, U: 8/16/32.");
         goto ERROR;
     }
 
+    if (args.attribute)
+        return bench_attribute_run(&args, &codec);
+
     if (args.save_squelched && !args.use_squelch)
     {
         LOG("Error: --save-squelched requires --squelch.");
@@ -243,13 +908,13 @@ int main(int argc, char *argv[])
     }
 
     float sample_rate = (float)args.rate;
-    int bytes_per_sample = args.bits / 8;
+    int bytes_per_sample = codec.sample_bytes;
 
     LOGV("Sample rate: %.0f Hz", sample_rate);
     LOGV("Format: %c%d %s", args.type, args.bits, args.little_endian ? "LE" : "BE");
 
-    FILE *fp = fopen(args.input_file, "rb");
-    if (!fp)
+    static bench_input_t input;
+    if (bench_input_open(&input, args.input_file, bytes_per_sample) < 0)
     {
         fprintf(stderr, "Error: Cannot open file '%s'.\n", args.input_file);
         goto ERROR;
@@ -274,8 +939,9 @@ int main(int argc, char *argv[])
 
     // Initialize demod
     struct md_multi_rx demod;
-    demod_type_t types = DEMOD_QUADRATURE | DEMOD_ALL_GOERTZEL;
-    md_multi_rx_init(&demod, sample_rate, types);
+    demod_type_t types = (args.quad_cross ? DEMOD_QUADRATURE_FAST : DEMOD_QUADRATURE) | DEMOD_ALL_GOERTZEL;
+    int decimation = args.decimate < 0 ? md_multi_rx_decimation(sample_rate) : (args.decimate > 1 ? args.decimate : 1);
+    md_multi_rx_init_decimated(&demod, sample_rate, types, decimation);
 
     // Initialize squelch (only if enabled)
     sql_t squelch;
@@ -286,8 +952,22 @@ int main(int argc, char *argv[])
     if (args.use_squelch)
         sql_init(&squelch, &sql_params, &sql_params_default);
 
+    // Channel access simulation, stepped every 10 ms of audio
+    bench_tx_sim_t blind_sim, csma_sim;
+    csma_params_t csma_params = csma_params_default;
+    csma_params.persist = args.persist;
+    csma_params.slottime_ms = args.slottime_ms;
+    bench_tx_sim_init(&blind_sim, "Blind TX", NULL);
+    bench_tx_sim_init(&csma_sim, "CSMA TX", &csma_params);
+    size_t chunk_size = CHUNK_SIZE;
+    if ((args.csma_load > 0.0f || args.pace) && args.rate / 100 < CHUNK_SIZE)
+        chunk_size = args.rate / 100;
+    uint32_t arrival_rng = 2463534242u;
+    uint64_t next_arrival_ms = 0;
+    uint64_t busy_ms = 0;
+
     // Process file
-    uint8_t raw_buffer[CHUNK_SIZE * 32];
+    const uint8_t *raw;
     float samples[CHUNK_SIZE];
     uint8_t frame_buffer[512];
     int packet_count = 0;
@@ -296,22 +976,25 @@ int main(int argc, char *argv[])
     LOGV("Processing file...");
 
     clock_t total_time = 0;
+    clock_t convert_time = 0;
     time_t time_zero = time(NULL);
 
+    int progress_s = args.progress_s >= 0 ? args.progress_s : (input.map ? 0 : BENCH_PROGRESS_S);
+    double wall_start = bench_wall_s();
+    double next_progress = wall_start + progress_s;
+
     for (;;)
     {
-        size_t read_count = fread(raw_buffer, bytes_per_sample, CHUNK_SIZE, fp);
+        size_t read_count = bench_input_next(&input, chunk_size, &raw);
         if (read_count == 0)
             break;
 
+        clock_t convert_start = clock();
+        pcm_to_float(&codec, raw, samples, read_count);
+        convert_time += clock() - convert_start;
+
         for (size_t i = 0; i < read_count; i++)
         {
-            samples[i] = convert_sample(
-                &raw_buffer[i * bytes_per_sample],
-                args.type,
-                args.bits,
-                args.little_endian);
-
             // Apply high boost channel equalization
             samples[i] = bf_biquad_filter(&g_hbf_filter, samples[i]);
 
@@ -341,6 +1024,48 @@ int main(int argc, char *argv[])
         end = clock();
         total_time += end - start;
 
+        if (args.pace)
+        {
+            double due = wall_start + time_sec;
+            struct timespec ts = {.tv_sec = (time_t)due, .tv_nsec = (long)((due - (time_t)due) * 1e9)};
+            while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+                ;
+        }
+
+        if (progress_s > 0 && bench_wall_s() >= next_progress)
+        {
+            double cpu_s = (double)total_time / CLOCKS_PER_SEC;
+            LOG("%.0f s of audio: %d packets, %.1f packets/min, %.1fx realtime", time_sec, packet_count,
+                time_sec > 0 ? packet_count * 60.0 / time_sec : 0.0, cpu_s > 0 ? time_sec / cpu_s : 0.0);
+            next_progress += progress_s;
+        }
+
+        if (args.csma_load > 0.0f)
+        {
+            uint64_t now_ms = (uint64_t)(time_sec * 1000.0);
+            bool busy = md_multi_rx_dcd(&demod);
+            if (busy)
+                busy_ms += (uint64_t)(read_count * 1000 / args.rate);
+
+            // Poisson arrivals, both stations see the same offered traffic
+            while (now_ms >= next_arrival_ms)
+            {
+                if (next_arrival_ms > 0)
+                {
+                    bench_tx_sim_offer(&blind_sim, now_ms);
+                    bench_tx_sim_offer(&csma_sim, now_ms);
+                }
+                arrival_rng ^= arrival_rng << 13;
+                arrival_rng ^= arrival_rng >> 17;
+                arrival_rng ^= arrival_rng << 5;
+                double u = (arrival_rng + 1.0) / 4294967297.0;
+                next_arrival_ms += 1 + (uint64_t)(-log(u) * 60000.0 / args.csma_load);
+            }
+
+            bench_tx_sim_step(&blind_sim, busy, now_ms, args.airtime_ms);
+            bench_tx_sim_step(&csma_sim, busy, now_ms, args.airtime_ms);
+        }
+
         if (frame_len <= 0)
             continue;
 
@@ -379,11 +1104,21 @@ int main(int argc, char *argv[])
 
     LOG("Packets: %d", packet_count);
     LOG("Time in modem_demodulate: %.3f s", (float)total_time / CLOCKS_PER_SEC);
+    LOG("Time in pcm_to_float: %.3f s", (float)convert_time / CLOCKS_PER_SEC);
+
+    if (args.csma_load > 0.0f)
+    {
+        double minutes = total_samples / sample_rate / 60.0;
+        LOG("Channel busy (DCD) %.1f%% of %.1f min, offered %.1f frames/min of %d ms",
+            minutes > 0 ? 100.0 * busy_ms / (minutes * 60000.0) : 0.0, minutes, args.csma_load, args.airtime_ms);
+        bench_tx_sim_report(&blind_sim, minutes);
+        bench_tx_sim_report(&csma_sim, minutes);
+    }
 
     // Cleanup
     if (sq_fp)
         fclose(sq_fp);
-    fclose(fp);
+    bench_input_close(&input);
     md_multi_rx_free(&demod);
     bf_biquad_free(&g_hbf_filter);
 
@@ -133,7 +133,7 @@ static void cal_args_parse(int argc, char *argv[], cal_args_t *args)
     argp_parse(&cal_argp, argc, argv, 0, 0, args);
 }
 
-static int audio_input_callback(float_buffer_t *buf)
+static int audio_input_callback(int channel, float_buffer_t *buf)
 {
     assert_buffer_valid(buf);
 
@@ -187,7 +187,17 @@ int main(int argc, char *argv[])
 
     LOG("Using device '%s'", args.dev_name);
 
-    if (aud_configure(args.dev_name, args.rate, true, false))
+    aud_params_t aud_params = {
+        .device_name = args.dev_name,
+        .sample_rate = args.rate,
+        .channels = 1,
+        .do_input = true,
+        .do_output = false,
+        .use_mmap = false,
+        .period_ms = 100,
+        .buffer_ms = 0,
+        .period_max_ms = 0};
+    if (aud_configure(&aud_params))
         EXIT("Failed to configure sound device");
 
     if (aud_start())
@@ -201,7 +211,11 @@ int main(int argc, char *argv[])
 
     for (;;)
     {
-        aud_process_capture(audio_input_callback, &audio_buf);
+        if (aud_process_capture(audio_input_callback, &audio_buf) == AUD_ERR_LOST)
+        {
+            LOG("Audio capture lost");
+            goto NICE_EXIT;
+        }
         usleep(50000); // 50ms polling interval
     }
 
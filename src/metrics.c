@@ -0,0 +1,391 @@
+#include "metrics.h"
+#include "common.h"
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#define METRICS_HEADER_SIZE 256
+
+static metric_t g_metrics[METRICS_MAX];
+static atomic_int g_metric_count;
+static atomic_int g_next_shard;
+static metrics_histogram_t g_histograms[METRICS_HISTOGRAMS_MAX];
+static atomic_int g_histogram_count;
+
+_Thread_local int metrics_thread_shard = -1;
+
+int metrics_shard_assign(void)
+{
+    metrics_thread_shard = atomic_fetch_add(&g_next_shard, 1) % METRICS_SHARDS;
+    return metrics_thread_shard;
+}
+
+static metric_t *metrics_register(const char *name, const char *help, metric_type_t type, const char *labels, va_list args)
+{
+    nonnull(name, "name");
+
+    int index = atomic_fetch_add(&g_metric_count, 1);
+    if (index >= METRICS_MAX)
+    {
+        atomic_store(&g_metric_count, METRICS_MAX);
+        LOG("metrics registry full, %s not registered", name);
+        return NULL;
+    }
+
+    metric_t *m = &g_metrics[index];
+    m->name = name;
+    m->help = help;
+    m->type = type;
+    m->labels[0] = '\0';
+    if (labels != NULL)
+        vsnprintf(m->labels, sizeof(m->labels), labels, args);
+    atomic_store(&m->hidden, false);
+    for (int s = 0; s < METRICS_SHARDS; s++)
+        atomic_store(&m->shards[s].value, 0);
+    return m;
+}
+
+metric_t *metrics_counter(const char *name, const char *help, const char *labels, ...)
+{
+    va_list args;
+    va_start(args, labels);
+    metric_t *m = metrics_register(name, help, METRIC_COUNTER, labels, args);
+    va_end(args);
+    return m;
+}
+
+metric_t *metrics_gauge(const char *name, const char *help, const char *labels, ...)
+{
+    va_list args;
+    va_start(args, labels);
+    metric_t *m = metrics_register(name, help, METRIC_GAUGE, labels, args);
+    va_end(args);
+    return m;
+}
+
+metrics_histogram_t *metrics_histogram(const char *name, const char *help, const char *labels, ...)
+{
+    nonnull(name, "name");
+
+    int index = atomic_fetch_add(&g_histogram_count, 1);
+    if (index >= METRICS_HISTOGRAMS_MAX)
+    {
+        atomic_store(&g_histogram_count, METRICS_HISTOGRAMS_MAX);
+        LOG("metrics histograms full, %s not registered", name);
+        return NULL;
+    }
+
+    metrics_histogram_t *h = &g_histograms[index];
+    h->name = name;
+    h->help = help;
+    h->labels[0] = '\0';
+    if (labels != NULL)
+    {
+        va_list args;
+        va_start(args, labels);
+        vsnprintf(h->labels, sizeof(h->labels), labels, args);
+        va_end(args);
+    }
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++)
+        atomic_store(&h->counts[b], 0);
+    atomic_store(&h->sum, 0);
+    atomic_store(&h->max, 0);
+    return h;
+}
+
+uint64_t metrics_histogram_bucket_low(int bucket)
+{
+    if (bucket < (1 << METRICS_HIST_SUB_BITS))
+        return (uint64_t)bucket;
+
+    int e = (bucket >> METRICS_HIST_SUB_BITS) + METRICS_HIST_SUB_BITS - 1;
+    uint64_t sub = bucket & ((1 << METRICS_HIST_SUB_BITS) - 1);
+    return ((1ull << METRICS_HIST_SUB_BITS) + sub) << (e - METRICS_HIST_SUB_BITS);
+}
+
+// Largest value falling into a bucket, the last one is open ended and reports the maximum seen
+static uint64_t metrics_histogram_bucket_high(const metrics_histogram_t *h, int bucket)
+{
+    if (bucket == METRICS_HIST_BUCKETS - 1)
+        return atomic_load_explicit(&h->max, memory_order_relaxed);
+    return metrics_histogram_bucket_low(bucket + 1) - 1;
+}
+
+uint64_t metrics_histogram_count(const metrics_histogram_t *h)
+{
+    nonnull(h, "h");
+
+    uint64_t count = 0;
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++)
+        count += atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+    return count;
+}
+
+uint64_t metrics_histogram_percentile(const metrics_histogram_t *h, double percentile)
+{
+    nonnull(h, "h");
+
+    uint64_t count = metrics_histogram_count(h);
+    if (count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)(percentile / 100.0 * count + 0.5);
+    if (rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for (int b = 0; b < METRICS_HIST_BUCKETS; b++)
+    {
+        seen += atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+        if (seen >= rank)
+        {
+            uint64_t high = metrics_histogram_bucket_high(h, b);
+            uint64_t max = atomic_load_explicit(&h->max, memory_order_relaxed);
+            return high < max ? high : max;
+        }
+    }
+    return atomic_load_explicit(&h->max, memory_order_relaxed);
+}
+
+static int metrics_histograms(void)
+{
+    int count = atomic_load(&g_histogram_count);
+    return count < METRICS_HISTOGRAMS_MAX ? count : METRICS_HISTOGRAMS_MAX;
+}
+
+int64_t metrics_value(const metric_t *m)
+{
+    nonnull(m, "m");
+
+    if (m->type == METRIC_GAUGE)
+        return (int64_t)atomic_load_explicit(&m->shards[0].value, memory_order_relaxed);
+
+    uint64_t sum = 0;
+    for (int s = 0; s < METRICS_SHARDS; s++)
+        sum += atomic_load_explicit(&m->shards[s].value, memory_order_relaxed);
+    return (int64_t)sum;
+}
+
+static int metrics_count(void)
+{
+    int count = atomic_load(&g_metric_count);
+    return count < METRICS_MAX ? count : METRICS_MAX;
+}
+
+// True for the first visible entry of its name, which carries the HELP/TYPE header of the family
+static bool metrics_first_of_name(int index)
+{
+    for (int i = 0; i < index; i++)
+        if (!atomic_load(&g_metrics[i].hidden) && strcmp(g_metrics[i].name, g_metrics[index].name) == 0)
+            return false;
+    return true;
+}
+
+typedef struct metrics_writer
+{
+    char *buf;
+    int capacity;
+    int len;
+} metrics_writer_t;
+
+static void metrics_printf(metrics_writer_t *w, const char *fmt, ...)
+{
+    if (w->len < 0)
+        return;
+
+    va_list args;
+    va_start(args, fmt);
+    int n = vsnprintf(w->buf + w->len, w->capacity - w->len, fmt, args);
+    va_end(args);
+    w->len = n < 0 || n >= w->capacity - w->len ? -1 : w->len + n;
+}
+
+int metrics_render_text(char *buf, int capacity)
+{
+    nonnull(buf, "buf");
+
+    metrics_writer_t w = {.buf = buf, .capacity = capacity, .len = 0};
+    int count = metrics_count();
+    for (int i = 0; i < count; i++)
+    {
+        const metric_t *m = &g_metrics[i];
+        if (atomic_load(&m->hidden) || !metrics_first_of_name(i))
+            continue;
+
+        if (m->help != NULL)
+            metrics_printf(&w, "# HELP %s %s\n", m->name, m->help);
+        metrics_printf(&w, "# TYPE %s %s\n", m->name, m->type == METRIC_COUNTER ? "counter" : "gauge");
+        for (int j = i; j < count; j++)
+        {
+            const metric_t *e = &g_metrics[j];
+            if (atomic_load(&e->hidden) || strcmp(e->name, m->name) != 0)
+                continue;
+            if (e->labels[0])
+                metrics_printf(&w, "%s{%s} %lld\n", e->name, e->labels, (long long)metrics_value(e));
+            else
+                metrics_printf(&w, "%s %lld\n", e->name, (long long)metrics_value(e));
+        }
+    }
+
+    int histograms = metrics_histograms();
+    for (int i = 0; i < histograms; i++)
+    {
+        const metrics_histogram_t *h = &g_histograms[i];
+        bool first = true;
+        for (int j = 0; j < i && first; j++)
+            first = strcmp(g_histograms[j].name, h->name) != 0;
+        if (first)
+        {
+            if (h->help != NULL)
+                metrics_printf(&w, "# HELP %s %s\n", h->name, h->help);
+            metrics_printf(&w, "# TYPE %s histogram\n", h->name);
+        }
+
+        // Empty buckets would only repeat the cumulative count of the one before, so only used ones are listed
+        const char *sep = h->labels[0] ? "," : "";
+        uint64_t cumulative = 0;
+        for (int b = 0; b < METRICS_HIST_BUCKETS - 1; b++)
+        {
+            uint64_t count = atomic_load_explicit(&h->counts[b], memory_order_relaxed);
+            if (count == 0)
+                continue;
+            cumulative += count;
+            metrics_printf(&w, "%s_bucket{%s%sle=\"%.6f\"} %llu\n", h->name, h->labels, sep,
+                           metrics_histogram_bucket_high(h, b) / 1e6, (unsigned long long)cumulative);
+        }
+        metrics_printf(&w, "%s_bucket{%s%sle=\"+Inf\"} %llu\n", h->name, h->labels, sep,
+                       (unsigned long long)metrics_histogram_count(h));
+        metrics_printf(&w, "%s_sum%s%s%s %.6f\n", h->name, h->labels[0] ? "{" : "", h->labels, h->labels[0] ? "}" : "",
+                       atomic_load_explicit(&h->sum, memory_order_relaxed) / 1e6);
+        metrics_printf(&w, "%s_count%s%s%s %llu\n", h->name, h->labels[0] ? "{" : "", h->labels,
+                       h->labels[0] ? "}" : "", (unsigned long long)metrics_histogram_count(h));
+    }
+    return w.len;
+}
+
+// Prometheus label list (k="v",...) as a JSON object, values never need escaping here
+static void metrics_json_labels(metrics_writer_t *w, const char *labels)
+{
+    metrics_printf(w, "{");
+    bool key = true;
+    for (const char *p = labels; *p; p++)
+    {
+        if (key && p == labels)
+            metrics_printf(w, "\"");
+        if (key && *p == '=')
+        {
+            metrics_printf(w, "\":");
+            key = false;
+        }
+        else if (!key && *p == ',')
+        {
+            metrics_printf(w, ",\"");
+            key = true;
+        }
+        else
+            metrics_printf(w, "%c", *p);
+    }
+    metrics_printf(w, "}");
+}
+
+int metrics_render_json(char *buf, int capacity)
+{
+    nonnull(buf, "buf");
+
+    metrics_writer_t w = {.buf = buf, .capacity = capacity, .len = 0};
+    metrics_printf(&w, "{\"metrics\":[");
+    bool first = true;
+    int count = metrics_count();
+    for (int i = 0; i < count; i++)
+    {
+        const metric_t *m = &g_metrics[i];
+        if (atomic_load(&m->hidden))
+            continue;
+
+        metrics_printf(&w, "%s{\"name\":\"%s\",\"type\":\"%s\",\"labels\":", first ? "" : ",", m->name,
+                       m->type == METRIC_COUNTER ? "counter" : "gauge");
+        metrics_json_labels(&w, m->labels);
+        metrics_printf(&w, ",\"value\":%lld}", (long long)metrics_value(m));
+        first = false;
+    }
+
+    // Histograms are summarized as percentiles in microseconds
+    int histograms = metrics_histograms();
+    for (int i = 0; i < histograms; i++)
+    {
+        const metrics_histogram_t *h = &g_histograms[i];
+        metrics_printf(&w, "%s{\"name\":\"%s\",\"type\":\"histogram\",\"labels\":", first ? "" : ",", h->name);
+        metrics_json_labels(&w, h->labels);
+        metrics_printf(&w, ",\"count\":%llu,\"sum_us\":%llu,\"p50_us\":%llu,\"p90_us\":%llu,\"p99_us\":%llu,\"max_us\":%llu}",
+                       (unsigned long long)metrics_histogram_count(h),
+                       (unsigned long long)atomic_load_explicit(&h->sum, memory_order_relaxed),
+                       (unsigned long long)metrics_histogram_percentile(h, 50.0),
+                       (unsigned long long)metrics_histogram_percentile(h, 90.0),
+                       (unsigned long long)metrics_histogram_percentile(h, 99.0),
+                       (unsigned long long)atomic_load_explicit(&h->max, memory_order_relaxed));
+        first = false;
+    }
+    metrics_printf(&w, "]}\n");
+    return w.len;
+}
+
+int metrics_respond(metrics_response_t *resp, const char *request, int len)
+{
+    nonnull(resp, "resp");
+    nonnull(request, "request");
+
+    bool http = len >= 4 && memcmp(request, "GET ", 4) == 0;
+    bool json = false;
+    if (http)
+    {
+        const char *path_end = memchr(request + 4, ' ', len - 4);
+        int path_len = path_end != NULL ? (int)(path_end - request - 4) : len - 4;
+        for (int i = 0; i + 4 <= path_len && !json; i++)
+            json = memcmp(request + 4 + i, "json", 4) == 0;
+    }
+    else
+        json = len >= 4 && memcmp(request, "json", 4) == 0;
+
+    // The body goes after room for the header, which is moved up against it once its length is known
+    char *body = resp->data + METRICS_HEADER_SIZE;
+    int capacity = METRICS_RESPONSE_SIZE - METRICS_HEADER_SIZE;
+    int body_len = json ? metrics_render_json(body, capacity) : metrics_render_text(body, capacity);
+    if (body_len < 0)
+    {
+        LOG("metrics do not fit the response buffer");
+        body_len = 0;
+    }
+
+    int header_len = 0;
+    char header[METRICS_HEADER_SIZE];
+    if (http)
+        header_len = snprintf(header, sizeof(header),
+                              "HTTP/1.0 200 OK\r\nContent-Type: %s\r\nContent-Length: %d\r\nConnection: close\r\n\r\n",
+                              json ? "application/json" : "text/plain; version=0.0.4", body_len);
+    memmove(resp->data + header_len, body, body_len);
+    memcpy(resp->data, header, header_len);
+    resp->len = header_len + body_len;
+    resp->sent = 0;
+    return resp->len;
+}
+
+int metrics_response_flush(metrics_response_t *resp, int fd)
+{
+    nonnull(resp, "resp");
+
+    while (resp->sent < resp->len)
+    {
+        ssize_t n = send(fd, resp->data + resp->sent, resp->len - resp->sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        resp->sent += n;
+    }
+    return resp->len - resp->sent;
+}
@@ -3,16 +3,37 @@
 #include "audio.h"
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/timerfd.h>
 
 miniwolf_t g_miniwolf;
 
 extern void tnc2_input_callback(const buffer_t *line_buf);
 
-// Callbacks defined in loop.c
-extern void tcp_client_connect_cb(int fd, void *user_data);
+// Callbacks and event handlers defined in loop.c
+extern void tcp_kiss_client_connect_cb(int fd, void *user_data);
+extern void tcp_tnc2_client_connect_cb(int fd, void *user_data);
 extern void tcp_client_disconnect_cb(int fd, void *user_data);
-extern void uds_client_connect_cb(int fd, void *user_data);
+extern void uds_kiss_client_connect_cb(int fd, void *user_data);
+extern void uds_tnc2_client_connect_cb(int fd, void *user_data);
 extern void uds_client_disconnect_cb(int fd, void *user_data);
+extern void metrics_tcp_client_connect_cb(int fd, void *user_data);
+extern void metrics_uds_client_connect_cb(int fd, void *user_data);
+extern void metrics_client_disconnect_cb(int fd, void *user_data);
+
+extern evloop_handler_t on_audio_ready;
+extern evloop_handler_t on_playback_ready;
+extern evloop_handler_t on_csma_timer;
+extern evloop_handler_t on_rx_frames_ready;
+extern evloop_handler_t on_stdin_ready;
+extern evloop_handler_t on_tcp_kiss_ready;
+extern evloop_handler_t on_tcp_tnc2_ready;
+extern evloop_handler_t on_udp_kiss_ready;
+extern evloop_handler_t on_udp_tnc2_ready;
+extern evloop_handler_t on_uds_kiss_ready;
+extern evloop_handler_t on_uds_tnc2_ready;
+extern evloop_handler_t on_metrics_tcp_ready;
+extern evloop_handler_t on_metrics_uds_ready;
 
 void miniwolf_init(miniwolf_t *mw, const options_t *opts)
 {
@@ -26,23 +47,39 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
     mw->kiss_mode = opts->kiss;
     float sample_rate = (float)opts->rate;
 
-    socket_poller_init(&mw->poller);
+    if (evloop_init(&mw->evloop) < 0)
+        EXIT("failed to create event loop");
 
-    // Add audio capture fd to poller
+    // Add audio capture fd to event loop
     mw->audio_fd = aud_get_poll_fd();
     nonzero(mw->audio_fd, "audio_fd");
-    if (socket_poller_add(&mw->poller, mw->audio_fd, POLLER_EV_IN) < 0)
-        EXIT("failed to add audio fd to poller");
+    if (evloop_add(&mw->evloop, mw->audio_fd, POLLIN, on_audio_ready, mw) < 0)
+        EXIT("failed to add audio fd to event loop");
+
+    // Playback descriptors are registered disarmed, loop.c arms them while samples are queued
+    mw->playback_armed = false;
+    mw->playback_fd_count = aud_get_playback_poll_fds(mw->playback_fds, AUD_POLL_FDS_MAX);
+    for (int i = 0; i < mw->playback_fd_count; i++)
+        if (evloop_add(&mw->evloop, mw->playback_fds[i].fd, 0, on_playback_ready, mw) < 0)
+            EXIT("failed to add playback fd to event loop");
+
+    mw->csma_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (mw->csma_timer_fd < 0 || evloop_add(&mw->evloop, mw->csma_timer_fd, POLLIN, on_csma_timer, mw) < 0)
+        EXIT("failed to set up channel access timer");
+
+    mw->wakeups = 0;
+    mw->idle_wakeups = 0;
+    mw->stats_since = time(NULL);
 
     // TCP servers
     mw->tcp_kiss_enabled = 0;
     if (opts->tcp_kiss_port > 0 && !tcp_server_init(&mw->tcp_kiss_server, opts->tcp_kiss_port, 0))
     {
         mw->tcp_kiss_enabled = 1;
-        mw->tcp_kiss_server.on_client_connect = tcp_client_connect_cb;
+        mw->tcp_kiss_server.on_client_connect = tcp_kiss_client_connect_cb;
         mw->tcp_kiss_server.on_client_disconnect = tcp_client_disconnect_cb;
         mw->tcp_kiss_server.user_data = mw;
-        socket_poller_add(&mw->poller, mw->tcp_kiss_server.listen_fd, POLLER_EV_IN);
+        evloop_add(&mw->evloop, mw->tcp_kiss_server.listen_fd, POLLIN, on_tcp_kiss_ready, mw);
         LOG("tcp kiss server enabled on port %d", opts->tcp_kiss_port);
     }
 
@@ -50,10 +87,10 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
     if (opts->tcp_tnc2_port > 0 && !tcp_server_init(&mw->tcp_tnc2_server, opts->tcp_tnc2_port, 0))
     {
         mw->tcp_tnc2_enabled = 1;
-        mw->tcp_tnc2_server.on_client_connect = tcp_client_connect_cb;
+        mw->tcp_tnc2_server.on_client_connect = tcp_tnc2_client_connect_cb;
         mw->tcp_tnc2_server.on_client_disconnect = tcp_client_disconnect_cb;
         mw->tcp_tnc2_server.user_data = mw;
-        socket_poller_add(&mw->poller, mw->tcp_tnc2_server.listen_fd, POLLER_EV_IN);
+        evloop_add(&mw->evloop, mw->tcp_tnc2_server.listen_fd, POLLIN, on_tcp_tnc2_ready, mw);
         LOG("tcp tnc2 server enabled on port %d", opts->tcp_tnc2_port);
     }
 
@@ -72,12 +109,27 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
         LOG("udp tnc2 sender enabled to %s:%d", opts->udp_tnc2_addr, opts->udp_tnc2_port);
     }
 
+    // Received frames are encoded and written on the output thread, stream clients get a bounded queue each
+    int overflow = OUTQ_DROP_OLDEST;
+    if (opts->client_overflow[0] && (overflow = outq_policy_parse(opts->client_overflow)) < 0)
+    {
+        LOG("unknown --%s policy '%s', using drop-oldest", OPT_CLIENT_OVERFLOW, opts->client_overflow);
+        overflow = OUTQ_DROP_OLDEST;
+    }
+    output_params_t output_params = {
+        .kiss_stdout = mw->kiss_mode,
+        .udp_kiss = mw->udp_kiss_enabled ? &mw->udp_kiss_sender : NULL,
+        .udp_tnc2 = mw->udp_tnc2_enabled ? &mw->udp_tnc2_sender : NULL,
+        .client_overflow = overflow};
+    if (output_init(&mw->output, &output_params) < 0 || output_start(&mw->output) < 0)
+        EXIT("failed to start output thread");
+
     // UDP servers
     mw->udp_kiss_listen_enabled = 0;
     if (opts->udp_kiss_listen_port > 0 && !udp_server_init(&mw->udp_kiss_server, opts->udp_kiss_listen_port, 0))
     {
         mw->udp_kiss_listen_enabled = 1;
-        socket_poller_add(&mw->poller, mw->udp_kiss_server.fd, POLLER_EV_IN);
+        evloop_add(&mw->evloop, mw->udp_kiss_server.fd, POLLIN, on_udp_kiss_ready, mw);
         LOG("udp kiss server enabled on port %d", opts->udp_kiss_listen_port);
     }
 
@@ -85,7 +137,7 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
     if (opts->udp_tnc2_listen_port > 0 && !udp_server_init(&mw->udp_tnc2_server, opts->udp_tnc2_listen_port, 0))
     {
         mw->udp_tnc2_listen_enabled = 1;
-        socket_poller_add(&mw->poller, mw->udp_tnc2_server.fd, POLLER_EV_IN);
+        evloop_add(&mw->evloop, mw->udp_tnc2_server.fd, POLLIN, on_udp_tnc2_ready, mw);
         LOG("udp tnc2 server enabled on port %d", opts->udp_tnc2_listen_port);
     }
 
@@ -94,10 +146,10 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
     if (opts->uds_kiss_socket_path[0] && !uds_server_init(&mw->uds_kiss_server, opts->uds_kiss_socket_path, 0))
     {
         mw->uds_kiss_enabled = 1;
-        mw->uds_kiss_server.on_client_connect = uds_client_connect_cb;
+        mw->uds_kiss_server.on_client_connect = uds_kiss_client_connect_cb;
         mw->uds_kiss_server.on_client_disconnect = uds_client_disconnect_cb;
         mw->uds_kiss_server.user_data = mw;
-        socket_poller_add(&mw->poller, mw->uds_kiss_server.listen_fd, POLLER_EV_IN);
+        evloop_add(&mw->evloop, mw->uds_kiss_server.listen_fd, POLLIN, on_uds_kiss_ready, mw);
         LOG("uds kiss server enabled on %s", opts->uds_kiss_socket_path);
     }
 
@@ -106,37 +158,106 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
     if (opts->uds_tnc2_socket_path[0] && !uds_server_init(&mw->uds_tnc2_server, opts->uds_tnc2_socket_path, 0))
     {
         mw->uds_tnc2_enabled = 1;
-        mw->uds_tnc2_server.on_client_connect = uds_client_connect_cb;
+        mw->uds_tnc2_server.on_client_connect = uds_tnc2_client_connect_cb;
         mw->uds_tnc2_server.on_client_disconnect = uds_client_disconnect_cb;
         mw->uds_tnc2_server.user_data = mw;
-        socket_poller_add(&mw->poller, mw->uds_tnc2_server.listen_fd, POLLER_EV_IN);
+        evloop_add(&mw->evloop, mw->uds_tnc2_server.listen_fd, POLLIN, on_uds_tnc2_ready, mw);
         LOG("uds tnc2 server enabled on %s", opts->uds_tnc2_socket_path);
     }
 
-    // Make stdin non-blocking and add to selector
-    fcntl(0, F_SETFL, fcntl(0, F_GETFL) | O_NONBLOCK);
-    socket_poller_add(&mw->poller, 0, POLLER_EV_IN);
+    // Metrics servers answer each request with a snapshot of the registry
+    for (int i = 0; i < MW_METRICS_CLIENTS_MAX; i++)
+        mw->metrics_clients[i].fd = -1;
+    mw->metrics_tcp_enabled = 0;
+    if (opts->metrics_tcp_port > 0 && !tcp_server_init(&mw->metrics_tcp_server, opts->metrics_tcp_port, 0))
+    {
+        mw->metrics_tcp_enabled = 1;
+        mw->metrics_tcp_server.on_client_connect = metrics_tcp_client_connect_cb;
+        mw->metrics_tcp_server.on_client_disconnect = metrics_client_disconnect_cb;
+        mw->metrics_tcp_server.user_data = mw;
+        evloop_add(&mw->evloop, mw->metrics_tcp_server.listen_fd, POLLIN, on_metrics_tcp_ready, mw);
+        LOG("metrics server enabled on port %d", opts->metrics_tcp_port);
+    }
 
-    if (opts->gain_2200 != 0.0f)
+    mw->metrics_uds_enabled = 0;
+    if (opts->metrics_uds_socket_path[0] && !uds_server_init(&mw->metrics_uds_server, opts->metrics_uds_socket_path, 0))
     {
-        LOGV("enabling high boost filter with gain of %f dB", opts->gain_2200);
-        bf_hbf_init(&mw->hbf_filter, 4, 2200.0f, sample_rate, opts->gain_2200);
+        mw->metrics_uds_enabled = 1;
+        mw->metrics_uds_server.on_client_connect = metrics_uds_client_connect_cb;
+        mw->metrics_uds_server.on_client_disconnect = metrics_client_disconnect_cb;
+        mw->metrics_uds_server.user_data = mw;
+        evloop_add(&mw->evloop, mw->metrics_uds_server.listen_fd, POLLIN, on_metrics_uds_ready, mw);
+        LOG("metrics server enabled on %s", opts->metrics_uds_socket_path);
     }
 
+    // Make stdin non-blocking and add to event loop
+    fcntl(0, F_SETFL, fcntl(0, F_GETFL) | O_NONBLOCK);
+    evloop_add(&mw->evloop, 0, POLLIN, on_stdin_ready, mw);
+
     modem_params_t modem_params = {
         .sample_rate = sample_rate,
-        .types = DEMOD_ALL_GOERTZEL | DEMOD_QUADRATURE,
+        .types = DEMOD_ALL_GOERTZEL | (opts->quad_cross ? DEMOD_QUADRATURE_FAST : DEMOD_QUADRATURE),
+        .decimation = opts->decimate ? md_multi_rx_decimation(sample_rate) : 1,
         .tx_delay = opts->tx_delay,
-        .tx_tail = opts->tx_tail};
-    modem_init(&mw->modem, &modem_params);
-
-    agc_init(&mw->input_agc, 10.0, 60e3f, sample_rate);
+        .tx_tail = opts->tx_tail,
+        .tx_burst_max = opts->tx_burst_max_ms};
 
     sql_params_t sql_params = {
         .sample_rate = sample_rate,
         .init_threshold = 0.045f,
         .strength = 0.51f};
-    sql_init(&mw->squelch, &sql_params, &sql_params_default);
+
+    csma_params_t csma_params = csma_params_default;
+    csma_params.persist = opts->persist;
+    csma_params.slottime_ms = opts->slottime_ms;
+
+    mw->csma_squelch = opts->csma_squelch && mw->squelch_enabled;
+    if (opts->csma_squelch && !mw->squelch_enabled)
+        LOG("--%s has no effect without --%s", OPT_CSMA_SQUELCH, OPT_SQUELCH);
+
+    mw->channel_count = opts->channels;
+    mw->rx_threads_enabled = opts->rx_threads;
+    for (int ch = 0; ch < mw->channel_count; ch++)
+    {
+        mw_channel_t *chan = &mw->channels[ch];
+
+        if (opts->gain_2200 != 0.0f)
+        {
+            LOGV("enabling high boost filter on channel %d with gain of %f dB", ch, opts->gain_2200);
+            bf_hbf_init(&chan->hbf_filter, 4, 2200.0f, sample_rate, opts->gain_2200);
+        }
+
+        modem_init(&chan->modem, &modem_params);
+        modem_register_metrics(&chan->modem, ch);
+
+        if (mw->rx_threads_enabled)
+        {
+            if (md_multi_rx_start_workers(&chan->modem.mrx))
+                EXIT("failed to start demodulator threads");
+            evloop_add(&mw->evloop, chan->modem.mrx.event_fd, POLLIN, on_rx_frames_ready, chan);
+            LOG("channel %d demodulators running on %d threads", ch, chan->modem.mrx.worker_count);
+        }
+
+        agc_init(&chan->input_agc, 10.0, 60e3f, sample_rate);
+        sql_init(&chan->squelch, &sql_params, &sql_params_default);
+
+        csma_init(&chan->csma, &csma_params, (uint32_t)time(NULL) ^ (uint32_t)getpid() << 8 ^ (uint32_t)ch);
+        chan->keyed = false;
+        chan->squelch_open = false;
+
+        tstamp_map_init(&chan->rx_clock, sample_rate);
+        chan->rx_samples = 0;
+        chan->tx_in_ns = 0;
+        chan->tx_timing = false;
+    }
+    LOGV("csma persist %d, slot time %d ms%s", csma_params.persist, csma_params.slottime_ms,
+         mw->csma_squelch ? ", squelch counts as busy" : "");
+
+    if (mw->channel_count > 1)
+        LOG("%d channels, kiss ports 0-%d", mw->channel_count, mw->channel_count - 1);
+
+    mw->tx_latency = metrics_histogram("miniwolf_tx_latency_seconds",
+                                       "Frame received for transmission to the first sample of its burst played", NULL);
 
     kiss_decoder_init(&mw->kiss_decoder);
     line_reader_init(&mw->stdin_line_reader, tnc2_input_callback);
@@ -147,6 +268,8 @@ void miniwolf_init(miniwolf_t *mw, const options_t *opts)
 
 void miniwolf_free(miniwolf_t *mw)
 {
+    output_free(&mw->output);
+
     if (mw->tcp_kiss_enabled)
         tcp_server_free(&mw->tcp_kiss_server);
     if (mw->tcp_tnc2_enabled)
@@ -167,7 +290,17 @@ void miniwolf_free(miniwolf_t *mw)
     if (mw->uds_tnc2_enabled)
         uds_server_free(&mw->uds_tnc2_server);
 
-    modem_free(&mw->modem);
-    bf_biquad_free(&mw->hbf_filter);
-    socket_poller_free(&mw->poller);
+    if (mw->metrics_tcp_enabled)
+        tcp_server_free(&mw->metrics_tcp_server);
+    if (mw->metrics_uds_enabled)
+        uds_server_free(&mw->metrics_uds_server);
+
+    for (int ch = 0; ch < mw->channel_count; ch++)
+    {
+        modem_free(&mw->channels[ch].modem);
+        bf_biquad_free(&mw->channels[ch].hbf_filter);
+    }
+    if (mw->csma_timer_fd >= 0)
+        close(mw->csma_timer_fd);
+    evloop_free(&mw->evloop);
 }
@@ -1,8 +1,28 @@
 #include "mod.h"
 #include "common.h"
 #include <stddef.h>
+#include <stdbool.h>
 #include <math.h>
 
+// One extra entry so interpolation never wraps
+static float g_sine_lut[MOD_LUT_SIZE + 1];
+static bool g_sine_lut_ready = false;
+
+static void mod_lut_init(void)
+{
+    if (g_sine_lut_ready)
+        return;
+
+    for (int i = 0; i <= MOD_LUT_SIZE; i++)
+        g_sine_lut[i] = (float)sin(2.0 * M_PI * i / MOD_LUT_SIZE);
+    g_sine_lut_ready = true;
+}
+
+static uint32_t mod_phase_step(float freq, float sample_rate)
+{
+    return (uint32_t)llround((double)freq / sample_rate * 4294967296.0);
+}
+
 void mod_init(modulator_t *mod, float mark_freq, float space_freq, float baud_rate, float sample_rate)
 {
     nonnull(mod, "mod");
@@ -11,26 +31,79 @@ void mod_init(modulator_t *mod, float mark_freq, float space_freq, float baud_ra
     nonzero(baud_rate, "baud_rate");
     nonzero(sample_rate, "sample_rate");
 
+    mod_lut_init();
+
     mod->mark_freq = mark_freq;
     mod->space_freq = space_freq;
     mod->baud_rate = baud_rate;
     mod->sample_rate = sample_rate;
-    synth_init(&mod->fsk_synth, sample_rate, mark_freq, 0.0f);
+    mod->phase = 0;
+    mod->mark_step = mod_phase_step(mark_freq, sample_rate);
+    mod->space_step = mod_phase_step(space_freq, sample_rate);
+    // Rational in millihertz so rates like 44100 / 1200 accumulate without drift
+    mod->bit_num = (uint64_t)llround(sample_rate * 1000.0);
+    mod->bit_den = (uint64_t)llround(baud_rate * 1000.0);
+    mod->bit_clock = 0;
+}
+
+int mod_samples_for_bits(const modulator_t *mod, int bit_count)
+{
+    nonnull(mod, "mod");
+
+    return (int)((mod->bit_clock + mod->bit_num * (uint64_t)bit_count) / mod->bit_den);
+}
+
+int mod_bits_for_samples(const modulator_t *mod, int sample_count)
+{
+    nonnull(mod, "mod");
+
+    // samples(k) = floor((clock + k * num) / den) <= sample_count  <=>  clock + k * num < (sample_count + 1) * den
+    uint64_t limit = (uint64_t)(sample_count + 1) * mod->bit_den;
+    if (limit <= mod->bit_clock)
+        return 0;
+    return (int)((limit - mod->bit_clock - 1) / mod->bit_num);
 }
 
-int mod_process(modulator_t *mod, int bit, float_buffer_t *out_samples_buf)
+int mod_process(modulator_t *mod, const bitarr_t *bits, int start, int bit_count, float_buffer_t *out_samples_buf)
 {
     nonnull(mod, "mod");
+    nonnull(bits, "bits");
     assert_buffer_valid(out_samples_buf);
 
-    int num_samples = 1 + (int)(mod->sample_rate / mod->baud_rate);
-    if (!fbuf_has_capacity_ge(out_samples_buf, num_samples))
+    if (start < 0 || start + bit_count > bits->size)
+        return -1;
+
+    int total = mod_samples_for_bits(mod, bit_count);
+    if (!fbuf_has_capacity_ge(out_samples_buf, out_samples_buf->size + total))
         return -1;
-    out_samples_buf->size = num_samples;
 
-    mod->fsk_synth.frequency = (bit) ? mod->mark_freq : mod->space_freq;
-    synth_get_samples(&mod->fsk_synth, out_samples_buf);
-    return num_samples;
+    float *out = out_samples_buf->data + out_samples_buf->size;
+    uint32_t phase = mod->phase;
+    uint64_t clock = mod->bit_clock;
+    const int frac_shift = 32 - MOD_LUT_BITS;
+    const float frac_scale = 1.0f / (float)(1u << frac_shift);
+
+    for (int b = start; b < start + bit_count; b++)
+    {
+        uint32_t step = bitarr_get(bits, b) ? mod->mark_step : mod->space_step;
+        clock += mod->bit_num;
+        int n = (int)(clock / mod->bit_den);
+        clock -= (uint64_t)n * mod->bit_den;
+
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t idx = phase >> frac_shift;
+            float frac = (float)(phase & ((1u << frac_shift) - 1)) * frac_scale;
+            float a = g_sine_lut[idx];
+            *out++ = a + (g_sine_lut[idx + 1] - a) * frac;
+            phase += step;
+        }
+    }
+
+    mod->phase = phase;
+    mod->bit_clock = clock;
+    out_samples_buf->size += total;
+    return total;
 }
 
 void mod_free(modulator_t *mod)
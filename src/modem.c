@@ -1,18 +1,101 @@
 #include "modem.h"
 #include "common.h"
 #include "buffer.h"
+#include "ring.h"
 #include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
 #include <math.h>
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
 
 const float mark_freq = 1200.0f;
 const float space_freq = 2200.0f;
 const float baud_rate = 1200.0f;
 
+#define MD_RX_BLOCK_SIZE 256
+#define MD_RX_WORKER_RING_SIZE 65536
+#define MD_RX_WORKER_FRAMES 16
+#define MD_RX_WORKER_MARKS 256
+#define MD_RX_LAG_LOG_S 10 // Worker lag is logged at most this often
+#define MD_RX_DECIM_PASSBAND 3000.0f
+
+typedef struct md_rx_frame
+{
+    uint64_t pos; // Stream position (in samples) at which the frame was completed
+    int modem;
+    uint16_t crc;
+    time_t time;
+    int size;
+    uint8_t data[MD_RX_FRAME_MAX];
+} md_rx_frame_t;
+
+// Time samples were submitted at, for every stream position up to end
+typedef struct md_rx_time_mark
+{
+    uint64_t end;
+    time_t time;
+} md_rx_time_mark_t;
+
+struct md_rx_worker
+{
+    struct md_multi_rx *mrx;
+    int chains[MD_RX_MAX];
+    int chain_count;
+
+    pthread_t thread;
+    sem_t wake;
+    sem_t idle;             // Posted after each batch while a flush waits
+    atomic_bool flushing;
+    atomic_bool stop;
+    int running;
+
+    ring_buffer_t *samples; // Submitter -> worker
+    ring_queue_t *marks;    // Submitter -> worker, queued after the samples they cover
+    ring_queue_t *frames;   // Worker -> collector
+    uint64_t submitted;     // Written by submitter only
+    uint64_t marked;        // Submitter side, end of the last queued mark
+    time_t mark_time;       // Submitter side, time of the latest submit
+    _Atomic uint64_t consumed;
+    atomic_bool dcd; // Data carrier detected on any chain of the worker, published after each block
+
+    // Collector side
+    md_rx_frame_t pending;
+    int has_pending;
+};
+
+int md_multi_rx_decimation(float sample_rate)
+{
+    int factor = (int)(sample_rate / MD_RX_DECIM_MIN_RATE);
+    return factor > 1 ? factor : 1;
+}
+
 void md_multi_rx_init(struct md_multi_rx *mrx, float sample_rate, demod_type_t types)
+{
+    md_multi_rx_init_decimated(mrx, sample_rate, types, 1);
+}
+
+void md_multi_rx_init_decimated(struct md_multi_rx *mrx, float sample_rate, demod_type_t types, int factor)
 {
     nonnull(mrx, "mrx");
     nonzero(sample_rate, "sample_rate");
     nonzero(types, "types");
+    nonzero(factor, "factor");
+
+    mrx->decim_factor = factor;
+    if (factor > 1)
+    {
+        decim_init(&mrx->decim, factor, sample_rate, MD_RX_DECIM_PASSBAND);
+        sample_rate /= factor;
+        LOGV("demodulating at %.0f Hz (decimation by %d, %d taps)", sample_rate, factor, mrx->decim.taps);
+    }
+
+    mrx->duplicates = NULL;
+    for (int i = 0; i < MD_RX_MAX; i++)
+        mrx->frames[i] = NULL;
 
     int mask = 1;
     mrx->count = 0;
@@ -23,9 +106,96 @@ void md_multi_rx_init(struct md_multi_rx *mrx, float sample_rate, demod_type_t t
         mask <<= 1;
     }
 
+    for (int i = 0; i < mrx->count; i++)
+    {
+        mrx->grz_front_src[i] = -1;
+        if (!(mrx->rxs[i].demod.type & DEMOD_ALL_GOERTZEL))
+            continue;
+
+        mrx->grz_front_src[i] = i;
+        for (int j = 0; j < i; j++)
+        {
+            if (mrx->grz_front_src[j] == j &&
+                demod_grz_front_equal(&mrx->rxs[i].demod.impl.grz.front, &mrx->rxs[j].demod.impl.grz.front))
+            {
+                LOGD("md_rx %d shares goertzel front-end of md_rx %d", i, j);
+                mrx->grz_front_src[i] = j;
+                break;
+            }
+        }
+    }
+
+    mrx->processed = 0;
+    mrx->frame_pos = 0;
+
     mrx->last_modem = -1;
     mrx->last_crc = 0;
     mrx->last_time = 0L;
+    for (int i = 0; i < MD_RX_ECHO_MAX; i++)
+    {
+        mrx->echo_crc[i] = 0;
+        mrx->echo_time[i] = 0L;
+    }
+    mrx->echo_next = 0;
+
+    mrx->workers = NULL;
+    mrx->worker_count = 0;
+    mrx->event_fd = -1;
+    atomic_store(&mrx->frames_outstanding, 0);
+    mrx->lag_samples = NULL;
+    mrx->lag_dropped = 0;
+    mrx->lag_logged = 0L;
+}
+
+static void md_multi_rx_demod_block(struct md_multi_rx *mrx, int i, const float *in, float *symbols,
+                                    float mark[][MD_RX_BLOCK_SIZE], float space[][MD_RX_BLOCK_SIZE], int n)
+{
+    struct md_rx *rx = &mrx->rxs[i];
+    int src = mrx->grz_front_src[i];
+
+    if (src < 0)
+        demod_process_block(&rx->demod, in, symbols, n);
+    else
+    {
+        if (src == i)
+            demod_grz_front_process_block(&rx->demod.impl.grz.front, in, mark[i], space[i], n);
+        demod_grz_back_process_block(&rx->demod.impl.grz, mark[src], space[src], symbols, n);
+    }
+}
+
+static bool md_multi_rx_is_echo(const struct md_multi_rx *mrx, uint16_t crc, time_t time)
+{
+    for (int i = 0; i < MD_RX_ECHO_MAX; i++)
+        if (mrx->echo_time[i] != 0 && mrx->echo_crc[i] == crc &&
+            time - mrx->echo_time[i] >= -1 && time - mrx->echo_time[i] <= MD_RX_ECHO_S)
+            return true;
+    return false;
+}
+
+void md_multi_rx_expect_echo(struct md_multi_rx *mrx, uint16_t crc, time_t time)
+{
+    nonnull(mrx, "mrx");
+
+    mrx->echo_crc[mrx->echo_next] = crc;
+    mrx->echo_time[mrx->echo_next] = time;
+    mrx->echo_next = (mrx->echo_next + 1) % MD_RX_ECHO_MAX;
+}
+
+// Returns 1 if identical frame was just (within 1s) seen on another modem, or is our own transmission
+static int md_multi_rx_dedupe(struct md_multi_rx *mrx, int modem, uint16_t crc, time_t time)
+{
+    int duplicate = (crc == mrx->last_crc && modem != mrx->last_modem && time - mrx->last_time <= 1) ||
+                    md_multi_rx_is_echo(mrx, crc, time);
+    if (modem >= 0)
+        metrics_inc(mrx->frames[modem]);
+    if (duplicate)
+        metrics_inc(mrx->duplicates);
+
+    mrx->last_modem = modem;
+    mrx->last_crc = crc;
+    mrx->last_time = time;
+
+    return duplicate;
 }
 
 int md_multi_rx_process(struct md_multi_rx *mrx, const float_buffer_t *sample_buf, buffer_t *out_frame_buf)
@@ -39,44 +209,425 @@ int md_multi_rx_process_at(struct md_multi_rx *mrx, const float_buffer_t *sample
     assert_buffer_valid(sample_buf);
     assert_buffer_valid(out_frame_buf);
 
+    // Threaded frames are collected by the owner of event_fd, not on the audio path
+    if (mrx->workers != NULL)
+    {
+        md_multi_rx_submit_at(mrx, sample_buf, time);
+        return 0;
+    }
+
     int ret = 0;
     uint16_t crc = 0;
     int modem = -2;
+    uint64_t frame_pos = 0;
+
+    float decimated[MD_RX_BLOCK_SIZE];
+    float symbols[MD_RX_BLOCK_SIZE];
+    float mark[MD_RX_MAX][MD_RX_BLOCK_SIZE];
+    float space[MD_RX_MAX][MD_RX_BLOCK_SIZE];
+
+    int step = MD_RX_BLOCK_SIZE * mrx->decim_factor;
+    for (int offset = 0; offset < sample_buf->size; offset += step)
+    {
+        int n = sample_buf->size - offset;
+        if (n > step)
+            n = step;
+        const float *in = sample_buf->data + offset;
+        if (mrx->decim_factor > 1)
+        {
+            n = decim_process_block(&mrx->decim, in, decimated, n);
+            in = decimated;
+        }
+
+        for (int i = 0; i < mrx->count; i++)
+        {
+            struct md_rx *rx = &mrx->rxs[i];
+            md_multi_rx_demod_block(mrx, i, in, symbols, mark, space, n);
+
+            // Once a md_rx has produced a frame, only it keeps writing to the output
+            if (ret == 0 || modem == i)
+            {
+                int rx_ret = md_rx_process_symbols(rx, symbols, n, out_frame_buf, &crc);
+                if (rx_ret > 0)
+                {
+                    ret = rx_ret;
+                    modem = i;
+                    frame_pos = (mrx->processed + n) * mrx->decim_factor;
+                }
+            }
+            else
+                (void)md_rx_process_symbols(rx, symbols, n, NULL, NULL);
+        }
+        mrx->processed += n;
+    }
+
+    if (ret > 0 && md_multi_rx_dedupe(mrx, modem, crc, time))
+        ret = 0; // Pretend there was no frame received
+    if (ret > 0)
+        mrx->frame_pos = frame_pos;
+
+    return ret;
+}
+
+static void *md_rx_worker_run(void *arg)
+{
+    struct md_rx_worker *worker = arg;
+    struct md_multi_rx *mrx = worker->mrx;
+
+    float in[MD_RX_BLOCK_SIZE];
+    float symbols[MD_RX_BLOCK_SIZE];
+    float mark[MD_RX_MAX][MD_RX_BLOCK_SIZE];
+    float space[MD_RX_MAX][MD_RX_BLOCK_SIZE];
+    md_rx_frame_t frame;
+    md_rx_time_mark_t time_mark = {.end = 0, .time = time(NULL)};
+
+    for (;;)
+    {
+        while (sem_wait(&worker->wake) < 0 && errno == EINTR)
+            ;
+        if (atomic_load(&worker->stop))
+            break;
+
+        for (;;)
+        {
+            // Samples are read only as far as a mark covers them, so each has its submit time
+            uint64_t consumed = atomic_load(&worker->consumed);
+            while (time_mark.end <= consumed && ring_queue_pop(worker->marks, &time_mark) == 0)
+                ;
+            if (time_mark.end <= consumed)
+                break;
+
+            size_t n = time_mark.end - consumed < MD_RX_BLOCK_SIZE ? time_mark.end - consumed : MD_RX_BLOCK_SIZE;
+            n = ring_read(worker->samples, in, n);
+            if (n == 0)
+                break;
+            uint64_t pos = consumed + n;
+
+            bool dcd = false;
+            for (int c = 0; c < worker->chain_count; c++)
+            {
+                int i = worker->chains[c];
+                md_multi_rx_demod_block(mrx, i, in, symbols, mark, space, n);
+
+                buffer_t frame_buf = {.data = frame.data, .capacity = sizeof(frame.data), .size = 0};
+                int ret = md_rx_process_symbols(&mrx->rxs[i], symbols, n, &frame_buf, &frame.crc);
+                dcd = dcd || mrx->rxs[i].bit_detector.data_detect;
+                if (ret <= 0)
+                    continue;
+
+                frame.pos = pos;
+                frame.modem = i;
+                frame.time = time_mark.time;
+                frame.size = frame_buf.size;
+                if (ring_queue_push(worker->frames, &frame))
+                    LOG("md_rx %d frame queue full, dropping frame", i);
+                else
+                    atomic_fetch_add(&mrx->frames_outstanding, 1);
+            }
+
+            atomic_store_explicit(&worker->dcd, dcd, memory_order_relaxed);
+            atomic_store(&worker->consumed, pos);
+        }
+
+        if (atomic_load(&worker->flushing))
+            sem_post(&worker->idle);
+
+        // Also signal when only the stream position advanced, frames of other workers may wait for it
+        if (atomic_load(&mrx->frames_outstanding) > 0)
+        {
+            uint64_t one = 1;
+            if (write(mrx->event_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+                LOGV("error signaling rx event: %s", strerror(errno));
+        }
+    }
+
+    return NULL;
+}
+
+int md_multi_rx_start_workers(struct md_multi_rx *mrx)
+{
+    nonnull(mrx, "mrx");
+
+    if (mrx->workers != NULL)
+        return 0;
+
+    mrx->event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (mrx->event_fd < 0)
+        return -1;
+
+    mrx->workers = calloc(mrx->count, sizeof(struct md_rx_worker));
+    if (mrx->workers == NULL)
+    {
+        close(mrx->event_fd);
+        mrx->event_fd = -1;
+        return -1;
+    }
 
+    // Chains sharing a Goertzel front-end go to the worker of the front-end owner
+    int worker_of[MD_RX_MAX];
+    mrx->worker_count = 0;
     for (int i = 0; i < mrx->count; i++)
     {
-        struct md_rx *rx = &mrx->rxs[i];
-        if (ret == 0)
+        int src = mrx->grz_front_src[i];
+        struct md_rx_worker *worker;
+        if (src < 0 || src == i)
         {
-            ret = md_rx_process(rx, sample_buf, out_frame_buf, &crc);
-            if (ret > 0)
-                modem = i;
+            worker_of[i] = mrx->worker_count;
+            worker = &mrx->workers[mrx->worker_count++];
+            worker->mrx = mrx;
         }
         else
-            (void)md_rx_process(rx, sample_buf, NULL, NULL);
+        {
+            worker_of[i] = worker_of[src];
+            worker = &mrx->workers[worker_of[src]];
+        }
+        worker->chains[worker->chain_count++] = i;
     }
 
-    if (ret > 0)
+    for (int w = 0; w < mrx->worker_count; w++)
     {
-        // If just (within 1s) seen identical frame on another modem
-        if (crc == mrx->last_crc && modem != mrx->last_modem && time - mrx->last_time <= 1)
-            ret = 0; // Pretend there was no frame received
+        struct md_rx_worker *worker = &mrx->workers[w];
+        atomic_store(&worker->stop, false);
+        atomic_store(&worker->flushing, false);
+        atomic_store(&worker->consumed, 0);
+        atomic_store(&worker->dcd, false);
+
+        if (ring_init(&worker->samples, MD_RX_WORKER_RING_SIZE) != RING_SUCCESS ||
+            ring_queue_init(&worker->marks, MD_RX_WORKER_MARKS, sizeof(md_rx_time_mark_t)) != RING_SUCCESS ||
+            ring_queue_init(&worker->frames, MD_RX_WORKER_FRAMES, sizeof(md_rx_frame_t)) != RING_SUCCESS ||
+            sem_init(&worker->wake, 0, 0) < 0)
+            goto ERROR;
+        if (sem_init(&worker->idle, 0, 0) < 0)
+        {
+            sem_destroy(&worker->wake);
+            goto ERROR;
+        }
 
-        mrx->last_modem = modem;
-        mrx->last_crc = crc;
-        mrx->last_time = time;
+        if (pthread_create(&worker->thread, NULL, md_rx_worker_run, worker) != 0)
+        {
+            sem_destroy(&worker->wake);
+            sem_destroy(&worker->idle);
+            goto ERROR;
+        }
+        worker->running = 1;
+
+        LOGD("md_rx worker %d runs %d chain(s)", w, worker->chain_count);
     }
 
-    return ret;
+    return 0;
+
+ERROR:
+    LOG("failed to start md_rx workers");
+    md_multi_rx_stop_workers(mrx);
+    return -1;
+}
+
+// Covers every sample written so far with the latest submit time, returns true if a mark was queued.
+// A full mark queue is retried on the next submit, the worker stops short of the unmarked samples until then.
+static bool md_rx_worker_mark(struct md_rx_worker *worker)
+{
+    if (worker->submitted == worker->marked)
+        return false;
+
+    md_rx_time_mark_t mark = {.end = worker->submitted, .time = worker->mark_time};
+    if (ring_queue_push(worker->marks, &mark))
+        return false;
+    worker->marked = worker->submitted;
+    return true;
+}
+
+void md_multi_rx_submit(struct md_multi_rx *mrx, const float_buffer_t *sample_buf)
+{
+    md_multi_rx_submit_at(mrx, sample_buf, time(NULL));
+}
+
+void md_multi_rx_submit_at(struct md_multi_rx *mrx, const float_buffer_t *sample_buf, time_t time)
+{
+    nonnull(mrx, "mrx");
+    assert_buffer_valid(sample_buf);
+
+    float decimated[MD_RX_BLOCK_SIZE];
+    int step = MD_RX_BLOCK_SIZE * mrx->decim_factor;
+    for (int offset = 0; offset < sample_buf->size; offset += step)
+    {
+        int n = sample_buf->size - offset;
+        if (n > step)
+            n = step;
+        const float *in = sample_buf->data + offset;
+        if (mrx->decim_factor > 1)
+        {
+            n = decim_process_block(&mrx->decim, in, decimated, n);
+            in = decimated;
+        }
+
+        for (int w = 0; w < mrx->worker_count; w++)
+        {
+            struct md_rx_worker *worker = &mrx->workers[w];
+            size_t written = ring_write(worker->samples, in, n);
+            if (written < n)
+            {
+                mrx->lag_dropped += n - written;
+                metrics_add(mrx->lag_samples, n - written);
+            }
+            worker->submitted += written;
+        }
+    }
+
+    for (int w = 0; w < mrx->worker_count; w++)
+    {
+        struct md_rx_worker *worker = &mrx->workers[w];
+        worker->mark_time = time;
+        md_rx_worker_mark(worker);
+        sem_post(&worker->wake);
+    }
+
+    if (mrx->lag_dropped > 0 && time - mrx->lag_logged >= MD_RX_LAG_LOG_S)
+    {
+        LOG("md_rx workers lagging, dropped %llu samples", (unsigned long long)mrx->lag_dropped);
+        mrx->lag_dropped = 0;
+        mrx->lag_logged = time;
+    }
+}
+
+int md_multi_rx_collect(struct md_multi_rx *mrx, buffer_t *out_frame_buf)
+{
+    nonnull(mrx, "mrx");
+    assert_buffer_valid(out_frame_buf);
+
+    uint64_t events;
+    if (read(mrx->event_fd, &events, sizeof(events)) < 0 && errno != EAGAIN)
+        LOGV("error reading rx event: %s", strerror(errno));
+
+    for (;;)
+    {
+        // A frame can be released once no worker can still produce an earlier one
+        uint64_t horizon = UINT64_MAX;
+        struct md_rx_worker *next = NULL;
+        for (int w = 0; w < mrx->worker_count; w++)
+        {
+            struct md_rx_worker *worker = &mrx->workers[w];
+            uint64_t consumed = atomic_load(&worker->consumed);
+            if (consumed < horizon)
+                horizon = consumed;
+
+            if (!worker->has_pending && ring_queue_pop(worker->frames, &worker->pending) == 0)
+                worker->has_pending = 1;
+            if (!worker->has_pending)
+                continue;
+
+            if (next == NULL || worker->pending.pos < next->pending.pos ||
+                (worker->pending.pos == next->pending.pos && worker->pending.modem < next->pending.modem))
+                next = worker;
+        }
+
+        if (next == NULL || next->pending.pos > horizon)
+            return 0;
+
+        md_rx_frame_t *frame = &next->pending;
+        next->has_pending = 0;
+        atomic_fetch_sub(&mrx->frames_outstanding, 1);
+
+        if (md_multi_rx_dedupe(mrx, frame->modem, frame->crc, frame->time))
+            continue;
+
+        if (frame->size > out_frame_buf->capacity)
+        {
+            LOG("frame of %d bytes does not fit output buffer", frame->size);
+            continue;
+        }
+
+        memcpy(out_frame_buf->data, frame->data, frame->size);
+        out_frame_buf->size = frame->size;
+        mrx->frame_pos = frame->pos * mrx->decim_factor;
+        return frame->size;
+    }
+}
+
+void md_multi_rx_flush(struct md_multi_rx *mrx)
+{
+    nonnull(mrx, "mrx");
+
+    for (int w = 0; w < mrx->worker_count; w++)
+    {
+        struct md_rx_worker *worker = &mrx->workers[w];
+        atomic_store(&worker->flushing, true);
+        while (atomic_load(&worker->consumed) < worker->submitted)
+        {
+            if (md_rx_worker_mark(worker))
+                sem_post(&worker->wake);
+            while (sem_wait(&worker->idle) < 0 && errno == EINTR)
+                ;
+        }
+        atomic_store(&worker->flushing, false);
+    }
+}
+
+void md_multi_rx_stop_workers(struct md_multi_rx *mrx)
+{
+    nonnull(mrx, "mrx");
+
+    if (mrx->workers == NULL)
+        return;
+
+    for (int w = 0; w < mrx->worker_count; w++)
+    {
+        struct md_rx_worker *worker = &mrx->workers[w];
+        if (worker->running)
+        {
+            atomic_store(&worker->stop, true);
+            sem_post(&worker->wake);
+            pthread_join(worker->thread, NULL);
+            sem_destroy(&worker->wake);
+            sem_destroy(&worker->idle);
+        }
+        if (worker->frames != NULL)
+            ring_queue_destroy(worker->frames);
+        if (worker->marks != NULL)
+            ring_queue_destroy(worker->marks);
+        if (worker->samples != NULL)
+            ring_destroy(worker->samples);
+    }
+
+    free(mrx->workers);
+    mrx->workers = NULL;
+    mrx->worker_count = 0;
+    close(mrx->event_fd);
+    mrx->event_fd = -1;
+    atomic_store(&mrx->frames_outstanding, 0);
 }
 
 void md_multi_rx_free(struct md_multi_rx *mrx)
 {
     nonnull(mrx, "mrx");
 
+    md_multi_rx_stop_workers(mrx);
+
     for (int i = 0; i < mrx->count; i++)
         md_rx_free(&mrx->rxs[i]);
     mrx->count = 0;
+
+    if (mrx->decim_factor > 1)
+        decim_free(&mrx->decim);
+    mrx->decim_factor = 1;
+}
+
+bool md_multi_rx_dcd(const struct md_multi_rx *mrx)
+{
+    nonnull(mrx, "mrx");
+
+    // Workers publish their chains' carrier detect after each block, a stale value only delays the decision by a block
+    if (mrx->workers != NULL)
+    {
+        for (int w = 0; w < mrx->worker_count; w++)
+            if (atomic_load_explicit(&mrx->workers[w].dcd, memory_order_relaxed))
+                return true;
+        return false;
+    }
+
+    for (int i = 0; i < mrx->count; i++)
+        if (mrx->rxs[i].bit_detector.data_detect)
+            return true;
+    return false;
 }
 
 void md_rx_init(struct md_rx *rx, float sample_rate, demod_type_t type)
@@ -88,6 +639,7 @@ void md_rx_init(struct md_rx *rx, float sample_rate, demod_type_t type)
 
     hldc_deframer_init(&rx->deframer);
     bitclk_init(&rx->bit_detector, sample_rate, baud_rate);
+    rx->hdlc_errors = NULL;
 }
 
 int md_rx_process(struct md_rx *rx, const float_buffer_t *sample_buf, buffer_t *out_frame_buf, uint16_t *out_crc)
@@ -99,30 +651,62 @@ int md_rx_process(struct md_rx *rx, const float_buffer_t *sample_buf, buffer_t *
     int ret = 0;
     uint16_t ret_crc = 0;
 
-    for (int i = 0; i < sample_buf->size; i++)
+    float symbols[MD_RX_BLOCK_SIZE];
+
+    for (int offset = 0; offset < sample_buf->size; offset += MD_RX_BLOCK_SIZE)
+    {
+        int n = sample_buf->size - offset;
+        if (n > MD_RX_BLOCK_SIZE)
+            n = MD_RX_BLOCK_SIZE;
+
+        demod_process_block(&rx->demod, sample_buf->data + offset, symbols, n);
+        int block_ret = md_rx_process_symbols(rx, symbols, n, out_frame_buf, &ret_crc);
+        if (block_ret > 0)
+            ret = block_ret;
+    }
+
+    if (ret > 0 && out_crc != NULL)
+        *out_crc = ret_crc;
+
+    return ret;
+}
+
+int md_rx_process_symbols(struct md_rx *rx, const float *symbols, int n, buffer_t *out_frame_buf, uint16_t *out_crc)
+{
+    nonnull(rx, "rx");
+    nonnull(symbols, "symbols");
+    // out_frame_buf and out_crc can be NULL
+
+    int bits[MD_RX_BLOCK_SIZE];
+    int ret = 0;
+    uint16_t crc_scratch = 0;
+    uint16_t *crc = (out_crc != NULL) ? out_crc : &crc_scratch;
+
+    for (int offset = 0; offset < n; offset += MD_RX_BLOCK_SIZE)
     {
-        float sample = sample_buf->data[i];
-        float symbol = demod_process(&rx->demod, sample);
+        int block_n = n - offset;
+        if (block_n > MD_RX_BLOCK_SIZE)
+            block_n = MD_RX_BLOCK_SIZE;
 
-        int bit = bitclk_detect(&rx->bit_detector, symbol);
+        int bit_count = bitclk_detect_block(&rx->bit_detector, symbols + offset, block_n, bits);
 
         if (out_frame_buf == NULL)
             continue;
 
-        if (bit != BITCLK_NONE)
+        for (int i = 0; i < bit_count; i++)
         {
-            hldc_error_e result = hldc_deframer_process(&rx->deframer, bit, out_frame_buf, &ret_crc);
+            hldc_error_e result = hldc_deframer_process(&rx->deframer, bits[i], out_frame_buf, crc);
             if (result < 0)
+            {
+                metrics_inc(rx->hdlc_errors);
                 LOGV("error %d while processing sample", result);
+            }
 
             if (out_frame_buf->size > 0)
                 ret = out_frame_buf->size;
         }
     }
 
-    if (ret > 0 && out_crc != NULL)
-        *out_crc = ret_crc;
-
     return ret;
 }
 
@@ -146,7 +730,33 @@ void md_tx_init(struct md_tx *tx, float sample_rate, float tx_delay, float tx_ta
     int tail_flags = (int)ceilf(0.001f * tx_tail * baud_rate / 8.0f);
     LOGD("head flags = %d", head_flags);
     LOGD("tail flags = %d", tail_flags);
-    hldc_framer_init(&tx->framer, head_flags, tail_flags);
+    hldc_framer_init(&tx->framer, 1, 0);
+
+    tx->head_flags = head_flags;
+    tx->tail_flags = tail_flags;
+    bitarr_init(&tx->bits, tx->bits_words, MD_TX_BITS_MAX);
+    tx->frame_bits_size = 0;
+    tx->bits_cursor = 0;
+    tx->burst_open = false;
+    tx->burst_bits_start = 0;
+    tx->burst_frames = 0;
+    tx->burst_max_bits = MD_TX_BITS_MAX;
+    tx->unsent_count = 0;
+    tx->sent_count = 0;
+    tx->backlog_head = 0;
+    tx->backlog_count = 0;
+}
+
+// Frames into frame_bits, opened by a single flag and left unclosed
+static int md_tx_frame_bits(struct md_tx *tx, const buffer_t *frame_buf, uint16_t *out_crc)
+{
+    buffer_t bits_buf = {.data = tx->frame_bits, .capacity = MD_TX_FRAME_BITS_MAX, .size = 0};
+    tx->frame_bits_size = 0;
+    if (frame_buf->size > MD_TX_FRAME_MAX || hldc_framer_process(&tx->framer, frame_buf, &bits_buf, out_crc))
+        return -1;
+
+    tx->frame_bits_size = bits_buf.size;
+    return 0;
 }
 
 int md_tx_process(struct md_tx *tx, const buffer_t *frame_buf, float_buffer_t *out_sample_buf, uint16_t *out_crc)
@@ -155,33 +765,201 @@ int md_tx_process(struct md_tx *tx, const buffer_t *frame_buf, float_buffer_t *o
     assert_buffer_valid(frame_buf);
     assert_buffer_valid(out_sample_buf);
 
-    uint8_t bits_data[8192];
-    buffer_t bits_buf = {
-        .data = bits_data,
-        .capacity = sizeof(bits_data),
-        .size = 0}; // TODO consider specialized bit array type
-    if (hldc_framer_process(&tx->framer, frame_buf, &bits_buf, out_crc))
+    uint64_t words[BITARR_WORDS(MD_TX_BITS_MAX)];
+    bitarr_t bits;
+    bitarr_init(&bits, words, MD_TX_BITS_MAX);
+
+    if (bitarr_append_nrzi_byte(&bits, 0x7E, tx->head_flags - 1) ||
+        md_tx_frame_bits(tx, frame_buf, out_crc) ||
+        bitarr_append_nrzi_levels(&bits, tx->frame_bits, tx->frame_bits_size) ||
+        bitarr_append_nrzi_byte(&bits, 0x7E, tx->tail_flags))
         return -1;
 
     out_sample_buf->size = 0;
-    for (int i = 0; i < bits_buf.size; i++)
+    return mod_process(&tx->fsk_mod, &bits, 0, bits.size, out_sample_buf);
+}
+
+// Frames at the end of the burst, head flags only for its first frame. Frames after the first
+// are joined by their opening flag; the segment is inverted if needed so its leading 0 bit is a
+// transition from the previous level (NRZI is polarity independent).
+static int md_tx_frame_into_burst(struct md_tx *tx, const uint8_t *frame, int frame_len, bool check_limit)
+{
+    if (tx->bits_cursor > 0)
+    {
+        bitarr_drop_front(&tx->bits, tx->bits_cursor);
+        tx->burst_bits_start -= tx->bits_cursor;
+        for (int i = 0; i < tx->unsent_count; i++)
+            tx->unsent_end[i] -= tx->bits_cursor;
+        tx->bits_cursor = 0;
+    }
+
+    if (tx->unsent_count == MD_TX_BURST_FRAMES_MAX)
+        return -1;
+
+    bool first = !tx->burst_open;
+    buffer_t frame_buf = {.data = (uint8_t *)frame, .capacity = frame_len, .size = frame_len};
+    uint16_t crc;
+    if (md_tx_frame_bits(tx, &frame_buf, &crc))
+        return -1;
+
+    int head_bits = first ? (tx->head_flags - 1) * 8 : 0;
+    int frame_bits = head_bits + tx->frame_bits_size;
+    int burst_bits = first ? 0 : tx->bits.size - tx->burst_bits_start;
+    // Room is kept for the tail flags that close the burst
+    int tail_bits = tx->tail_flags * 8;
+    if (tx->bits.size + frame_bits + tail_bits > tx->bits.capacity)
+        return -1;
+    if (check_limit && !first && burst_bits + frame_bits + tail_bits > tx->burst_max_bits)
+        return -1;
+
+    if (first)
     {
-        int bit = bits_buf.data[i];
+        tx->burst_bits_start = tx->bits.size;
+        bitarr_append_nrzi_byte(&tx->bits, 0x7E, tx->head_flags - 1);
+    }
+    bitarr_append_nrzi_levels(&tx->bits, tx->frame_bits, tx->frame_bits_size);
+    tx->unsent_crc[tx->unsent_count] = crc;
+    tx->unsent_end[tx->unsent_count] = tx->bits.size;
+    tx->unsent_count++;
+    tx->burst_open = true;
+    tx->burst_frames++;
+    return frame_bits;
+}
+
+static bool md_tx_backlog_push(struct md_tx *tx, const buffer_t *frame_buf)
+{
+    if (tx->backlog_count == MD_TX_BACKLOG_MAX || frame_buf->size > MD_TX_FRAME_MAX)
+        return false;
+
+    int slot = (tx->backlog_head + tx->backlog_count++) % MD_TX_BACKLOG_MAX;
+    memcpy(tx->backlog[slot], frame_buf->data, frame_buf->size);
+    tx->backlog_len[slot] = frame_buf->size;
+    return true;
+}
+
+int md_tx_queue(struct md_tx *tx, const buffer_t *frame_buf)
+{
+    nonnull(tx, "tx");
+    assert_buffer_valid(frame_buf);
+
+    // Joins the burst being sent while it is still open and under the keyup limit
+    if (tx->burst_open && tx->backlog_count == 0 &&
+        md_tx_frame_into_burst(tx, frame_buf->data, frame_buf->size, true) > 0)
+        return 1;
+
+    return md_tx_backlog_push(tx, frame_buf) ? 0 : -1;
+}
+
+int md_tx_begin_burst(struct md_tx *tx)
+{
+    nonnull(tx, "tx");
 
-        float bit_sample_data[512];
-        float_buffer_t bit_sample_buf = {
-            .data = bit_sample_data,
-            .capacity = sizeof(bit_sample_data) / sizeof(float),
-            .size = 0};
-        int sc = mod_process(&tx->fsk_mod, bit, &bit_sample_buf);
+    if (tx->burst_open || md_tx_pending(tx) > 0)
+        return 0;
 
-        if (out_sample_buf->size + sc > out_sample_buf->capacity)
-            return -1;
-        memcpy(out_sample_buf->data + out_sample_buf->size, bit_sample_buf.data, sc * sizeof(float));
-        out_sample_buf->size += sc;
+    tx->burst_frames = 0;
+    int bits = 0;
+    while (tx->backlog_count > 0)
+    {
+        int slot = tx->backlog_head;
+        int n = md_tx_frame_into_burst(tx, tx->backlog[slot], tx->backlog_len[slot], true);
+        if (n < 0)
+        {
+            if (tx->burst_frames > 0)
+                break;
+            LOG("frame of %d bytes does not fit the tx buffer, dropped", tx->backlog_len[slot]);
+        }
+        else
+            bits += n;
+        tx->backlog_head = (tx->backlog_head + 1) % MD_TX_BACKLOG_MAX;
+        tx->backlog_count--;
     }
 
-    return out_sample_buf->size;
+    if (tx->burst_frames > 1)
+        LOGV("burst of %d frames, %d bits", tx->burst_frames, bits);
+    return bits;
+}
+
+int md_tx_render(struct md_tx *tx, float_buffer_t *out_sample_buf, int max_samples)
+{
+    nonnull(tx, "tx");
+    assert_buffer_valid(out_sample_buf);
+
+    int room = out_sample_buf->capacity - out_sample_buf->size;
+    if (max_samples > room)
+        max_samples = room;
+
+    int bit_count = mod_bits_for_samples(&tx->fsk_mod, max_samples);
+    if (bit_count > md_tx_pending(tx))
+        bit_count = md_tx_pending(tx);
+    if (bit_count <= 0)
+        return 0;
+
+    int written = mod_process(&tx->fsk_mod, &tx->bits, tx->bits_cursor, bit_count, out_sample_buf);
+    if (written < 0)
+        return -1;
+
+    tx->bits_cursor += bit_count;
+    int done = 0;
+    while (done < tx->unsent_count && tx->unsent_end[done] <= tx->bits_cursor)
+    {
+        if (tx->sent_count < MD_TX_BURST_FRAMES_MAX)
+            tx->sent_crc[tx->sent_count++] = tx->unsent_crc[done];
+        done++;
+    }
+    if (done > 0)
+    {
+        tx->unsent_count -= done;
+        memmove(tx->unsent_crc, tx->unsent_crc + done, tx->unsent_count * sizeof(tx->unsent_crc[0]));
+        memmove(tx->unsent_end, tx->unsent_end + done, tx->unsent_count * sizeof(tx->unsent_end[0]));
+    }
+
+    // Nothing more joined before the queued bits ran out, the burst ends here
+    if (tx->burst_open && tx->bits_cursor == tx->bits.size)
+    {
+        bitarr_append_nrzi_byte(&tx->bits, 0x7E, tx->tail_flags);
+        tx->burst_open = false;
+    }
+    if (tx->bits_cursor == tx->bits.size)
+    {
+        bitarr_clear(&tx->bits);
+        tx->bits_cursor = 0;
+    }
+    return written;
+}
+
+int md_tx_sent(struct md_tx *tx, uint16_t *crcs, int max)
+{
+    nonnull(tx, "tx");
+    nonnull(crcs, "crcs");
+
+    int n = tx->sent_count < max ? tx->sent_count : max;
+    memcpy(crcs, tx->sent_crc, n * sizeof(crcs[0]));
+    tx->sent_count -= n;
+    memmove(tx->sent_crc, tx->sent_crc + n, tx->sent_count * sizeof(tx->sent_crc[0]));
+    return n;
+}
+
+int md_tx_pending(const struct md_tx *tx)
+{
+    nonnull(tx, "tx");
+
+    return tx->bits.size - tx->bits_cursor;
+}
+
+int md_tx_backlog(const struct md_tx *tx)
+{
+    nonnull(tx, "tx");
+
+    return tx->backlog_count;
+}
+
+void md_tx_set_burst_limit(struct md_tx *tx, float max_ms)
+{
+    nonnull(tx, "tx");
+
+    int bits = (int)(0.001f * max_ms * baud_rate);
+    tx->burst_max_bits = bits > 0 && bits < MD_TX_BITS_MAX ? bits : MD_TX_BITS_MAX;
 }
 
 void md_tx_free(struct md_tx *tx)
@@ -195,8 +973,33 @@ void modem_init(modem_t *modem, modem_params_t *params)
     nonzero(params->sample_rate, "params.sample_rate");
     nonzero(params->types, "params.types");
 
-    md_multi_rx_init(&modem->mrx, params->sample_rate, params->types);
+    md_multi_rx_init_decimated(&modem->mrx, params->sample_rate, params->types,
+                               params->decimation > 1 ? params->decimation : 1);
     md_tx_init(&modem->tx, params->sample_rate, params->tx_delay, params->tx_tail);
+    if (params->tx_burst_max > 0.0f)
+        md_tx_set_burst_limit(&modem->tx, params->tx_burst_max);
+    modem->tx_frames = NULL;
+    modem->tx_samples = NULL;
+}
+
+void modem_register_metrics(modem_t *modem, int channel)
+{
+    nonnull(modem, "modem");
+
+    struct md_multi_rx *mrx = &modem->mrx;
+    for (int i = 0; i < mrx->count; i++)
+    {
+        mrx->frames[i] = metrics_counter("miniwolf_rx_frames_total", "Frames decoded per demodulator chain",
+                                         "channel=\"%d\",chain=\"%d\"", channel, i);
+        mrx->rxs[i].hdlc_errors = metrics_counter("miniwolf_hdlc_errors_total", "HDLC deframing errors (FCS, overflow)",
+                                                  "channel=\"%d\",chain=\"%d\"", channel, i);
+    }
+    mrx->duplicates = metrics_counter("miniwolf_rx_duplicates_total", "Frames suppressed as decoded by another chain",
+                                      "channel=\"%d\"", channel);
+    mrx->lag_samples = metrics_counter("miniwolf_rx_worker_dropped_samples_total",
+                                       "Samples dropped because a demodulator thread fell behind", "channel=\"%d\"", channel);
+    modem->tx_frames = metrics_counter("miniwolf_tx_frames_total", "Frames put on air", "channel=\"%d\"", channel);
+    modem->tx_samples = metrics_counter("miniwolf_tx_samples_total", "Samples modulated", "channel=\"%d\"", channel);
 }
 
 int modem_demodulate(modem_t *modem, const float_buffer_t *sample_buf, buffer_t *out_frame_buf)
@@ -211,6 +1014,17 @@ int modem_demodulate(modem_t *modem, const float_buffer_t *sample_buf, buffer_t
     return ret;
 }
 
+int modem_collect(modem_t *modem, buffer_t *out_frame_buf)
+{
+    nonnull(modem, "modem");
+    assert_buffer_valid(out_frame_buf);
+
+    int ret = md_multi_rx_collect(&modem->mrx, out_frame_buf);
+    if (ret > 0)
+        LOGV("demodulated frame: %d bytes", ret);
+    return ret;
+}
+
 int modem_modulate(modem_t *modem, const buffer_t *frame_buf, float_buffer_t *out_sample_buf)
 {
     nonnull(modem, "modem");
@@ -220,15 +1034,89 @@ int modem_modulate(modem_t *modem, const buffer_t *frame_buf, float_buffer_t *ou
     uint16_t frame_crc;
     int ret = md_tx_process(&modem->tx, frame_buf, out_sample_buf, &frame_crc);
     if (ret > 0)
+    {
         LOGV("modulated frame: %d samples", ret);
+        metrics_inc(modem->tx_frames);
+        metrics_add(modem->tx_samples, ret);
+    }
 
     // Treat tx crc as already demodulated to filter out self-demodulations
-    modem->mrx.last_crc = frame_crc;
-    modem->mrx.last_time = time(NULL);
+    md_multi_rx_expect_echo(&modem->mrx, frame_crc, time(NULL));
 
     return ret;
 }
 
+uint64_t modem_rx_frame_pos(const modem_t *modem)
+{
+    nonnull(modem, "modem");
+
+    return modem->mrx.frame_pos;
+}
+
+bool modem_dcd(const modem_t *modem)
+{
+    nonnull(modem, "modem");
+
+    return md_multi_rx_dcd(&modem->mrx);
+}
+
+int modem_tx_queue(modem_t *modem, const buffer_t *frame_buf)
+{
+    nonnull(modem, "modem");
+    assert_buffer_valid(frame_buf);
+
+    int ret = md_tx_queue(&modem->tx, frame_buf);
+    if (ret < 0)
+        return ret;
+    LOGV("queued frame: %d bytes, %s", frame_buf->size, ret ? "joined burst" : "waiting for channel");
+
+    if (ret > 0)
+        metrics_inc(modem->tx_frames);
+
+    return ret;
+}
+
+int modem_tx_begin_burst(modem_t *modem)
+{
+    nonnull(modem, "modem");
+
+    int ret = md_tx_begin_burst(&modem->tx);
+    if (ret > 0)
+        metrics_add(modem->tx_frames, modem->tx.burst_frames);
+    return ret;
+}
+
+int modem_tx_render(modem_t *modem, float_buffer_t *out_sample_buf, int max_samples)
+{
+    nonnull(modem, "modem");
+
+    int ret = md_tx_render(&modem->tx, out_sample_buf, max_samples);
+    if (ret > 0)
+        metrics_add(modem->tx_samples, ret);
+
+    // Each frame is treated as already demodulated once its last bit is on its way to the DAC,
+    // to filter out self-demodulations of every frame of the burst
+    uint16_t crcs[MD_TX_BURST_FRAMES_MAX];
+    int sent = md_tx_sent(&modem->tx, crcs, MD_TX_BURST_FRAMES_MAX);
+    for (int i = 0; i < sent; i++)
+        md_multi_rx_expect_echo(&modem->mrx, crcs[i], time(NULL));
+    return ret;
+}
+
+bool modem_tx_pending(const modem_t *modem)
+{
+    nonnull(modem, "modem");
+
+    return md_tx_pending(&modem->tx) > 0;
+}
+
+bool modem_tx_waiting(const modem_t *modem)
+{
+    nonnull(modem, "modem");
+
+    return md_tx_backlog(&modem->tx) > 0;
+}
+
 void modem_free(modem_t *modem)
 {
     nonnull(modem, "modem");
@@ -1,4 +1,5 @@
 #include "options.h"
+#include "csma.h"
 #include <limits.h>
 
 void opts_init(options_t *opts)
@@ -16,6 +17,12 @@ void opts_init(options_t *opts)
     opts->dev_input = false;
     opts->dev_output = false;
     opts->rate = 0;
+    opts->channels = 0;
+    opts->mmap = false;
+    opts->period_ms = 0;
+    opts->buffer_ms = 0;
+    opts->period_max_ms = 0;
+    opts->sample_format[0] = '\0';
 
     opts->tcp_kiss_port = 0;
     opts->tcp_tnc2_port = 0;
@@ -28,11 +35,23 @@ void opts_init(options_t *opts)
     opts->udp_kiss_listen_port = 0;
     opts->udp_tnc2_listen_port = 0;
 
+    opts->client_overflow[0] = '\0';
+
+    opts->metrics_tcp_port = 0;
+    opts->metrics_uds_socket_path[0] = '\0';
+
     opts->squelch = 0.0f;
     opts->gain_2200 = 0.0f;
     opts->tx_delay = 0.0f;
     opts->tx_tail = 0.0f;
+    opts->tx_burst_max_ms = 0.0f;
     opts->exit_idle_s = 0;
+    opts->quad_cross = false;
+    opts->rx_threads = false;
+    opts->decimate = false;
+    opts->persist = 0;
+    opts->slottime_ms = 0;
+    opts->csma_squelch = false;
 }
 
 void opts_defaults(options_t *opts)
@@ -40,7 +59,12 @@ void opts_defaults(options_t *opts)
     nonnull(opts, "opts");
 
     REPLACE_IF_a_WITH_b(opts->rate, 0, 44100);
+    REPLACE_IF_a_WITH_b(opts->channels, 0, 1);
+    REPLACE_IF_a_WITH_b(opts->period_ms, 0, 90);
     REPLACE_IF_a_WITH_b(opts->tx_delay, 0.0f, 300.0f);
     REPLACE_IF_a_WITH_b(opts->tx_tail, 0.0f, 30.0f);
+    REPLACE_IF_a_WITH_b(opts->tx_burst_max_ms, 0.0f, 5000.0f);
     REPLACE_IF_a_WITH_b(opts->exit_idle_s, 0, LONG_MAX);
+    REPLACE_IF_a_WITH_b(opts->persist, 0, CSMA_PERSIST_DEFAULT);
+    REPLACE_IF_a_WITH_b(opts->slottime_ms, 0, CSMA_SLOTTIME_MS_DEFAULT);
 }
@@ -17,6 +17,12 @@ static struct argp_option options[] = {
     {OPT_DEV_INPUT, OPT_SHORT_DEV_INPUT, 0, 0, "Use sound device for input", 3},
     {OPT_DEV_OUTPUT, OPT_SHORT_DEV_OUTPUT, 0, 0, "Use sound device for output", 3},
     {OPT_RATE, OPT_SHORT_RATE, "RATE", 0, "Sample rate (default: 44100Hz)", 3},
+    {OPT_CHANNELS, OPT_SHORT_CHANNELS, "N", 0, "Interleaved channels, one modem and KISS port each (default: 1)", 3},
+    {OPT_MMAP, OPT_SHORT_MMAP, 0, 0, "Access sound device buffers directly (mmap)", 3},
+    {OPT_PERIOD_MS, OPT_SHORT_PERIOD_MS, "MS", 0, "Sound device period (default: 90ms)", 3},
+    {OPT_BUFFER_MS, OPT_SHORT_BUFFER_MS, "MS", 0, "Sound device buffer (default: 4 periods)", 3},
+    {OPT_PERIOD_MAX_MS, OPT_SHORT_PERIOD_MAX_MS, "MS", 0, "Grow period up to MS on repeated xruns (default: fixed period)", 3},
+    {OPT_SAMPLE_FORMAT, OPT_SHORT_SAMPLE_FORMAT, "FORMAT", 0, "Device sample format: S16, S24, S24_3, S32, F32, with _BE (S24_3BE) for big endian (default: auto)", 3},
 
     {OPT_TCP_KISS_PORT, OPT_SHORT_TCP_KISS_PORT, "PORT", 0, "TCP server port in KISS format", 4},
     {OPT_TCP_TNC2_PORT, OPT_SHORT_TCP_TNC2_PORT, "PORT", 0, "TCP server port in TNC2 format", 4},
@@ -31,12 +37,22 @@ static struct argp_option options[] = {
 
     {OPT_UDS_KISS_SOCKET, OPT_SHORT_UDS_KISS_SOCKET, "PATH", 0, "Unix domain socket path for KISS packets", 4},
     {OPT_UDS_TNC2_SOCKET, OPT_SHORT_UDS_TNC2_SOCKET, "PATH", 0, "Unix domain socket path for TNC2 packets", 4},
+    {OPT_CLIENT_OVERFLOW, OPT_SHORT_CLIENT_OVERFLOW, "POLICY", 0, "When a TCP/UDS client falls behind: drop-oldest, drop-newest, disconnect (default: drop-oldest)", 4},
+    {OPT_METRICS_TCP_PORT, OPT_SHORT_METRICS_TCP_PORT, "PORT", 0, "TCP port serving metrics as Prometheus text or JSON", 4},
+    {OPT_METRICS_UDS_SOCKET, OPT_SHORT_METRICS_UDS_SOCKET, "PATH", 0, "Unix domain socket path serving metrics", 4},
 
     {OPT_SQUELCH, OPT_SHORT_SQUELCH, "VAL", 0, "Enable pseudo-squelch with given strength (0.0-1.0)", 5},
     {OPT_GAIN_2200, OPT_SHORT_GAIN_2200, "GAIN", 0, "Equalization to apply at 2200 Hz [dB]", 5},
     {OPT_TX_DELAY, OPT_SHORT_TX_DELAY, "MS", 0, "Time to send flags before a packet (default: 300ms)", 5},
     {OPT_TX_TAIL, OPT_SHORT_TX_TAIL, "MS", 0, "Time to send flags after a packet (default: 30ms)", 5},
+    {OPT_TX_BURST_MAX_MS, OPT_SHORT_TX_BURST_MAX_MS, "MS", 0, "Longest keyup when sending queued packets back to back (default: 5000ms)", 5},
     {OPT_EXIT_IDLE_S, OPT_SHORT_EXIT_IDLE_S, "S", 0, "Exit the program if no packets received in S seconds", 5},
+    {OPT_QUAD_CROSS, OPT_SHORT_QUAD_CROSS, 0, 0, "Use the cross-product quadrature discriminator instead of atan2", 5},
+    {OPT_RX_THREADS, OPT_SHORT_RX_THREADS, 0, 0, "Run each demodulator on its own thread", 5},
+    {OPT_DECIMATE, OPT_SHORT_DECIMATE, 0, 0, "Demodulate at a reduced internal rate (44.1/48 kHz only)", 5},
+    {OPT_PERSIST, OPT_SHORT_PERSIST, "P", 0, "CSMA persistence, transmit chance per clear slot is (P+1)/256 (default: 63)", 5},
+    {OPT_SLOTTIME_MS, OPT_SHORT_SLOTTIME_MS, "MS", 0, "CSMA slot time (default: 100ms)", 5},
+    {OPT_CSMA_SQUELCH, OPT_SHORT_CSMA_SQUELCH, 0, 0, "Treat open squelch as a busy channel, in addition to DCD", 5},
 
     {0, 0, 0, 0, 0, 0}};
 
@@ -103,9 +119,36 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case OPT_SHORT_UDS_TNC2_SOCKET:
         strncpy(opts->uds_tnc2_socket_path, arg, OPT_STR_SIZE - 1);
         break;
+    case OPT_SHORT_CLIENT_OVERFLOW:
+        strncpy(opts->client_overflow, arg, OPT_STR_SIZE - 1);
+        break;
+    case OPT_SHORT_METRICS_TCP_PORT:
+        opts->metrics_tcp_port = atoi(arg);
+        break;
+    case OPT_SHORT_METRICS_UDS_SOCKET:
+        strncpy(opts->metrics_uds_socket_path, arg, OPT_STR_SIZE - 1);
+        break;
     case OPT_SHORT_RATE:
         opts->rate = atoi(arg);
         break;
+    case OPT_SHORT_CHANNELS:
+        opts->channels = atoi(arg);
+        break;
+    case OPT_SHORT_MMAP:
+        opts->mmap = true;
+        break;
+    case OPT_SHORT_PERIOD_MS:
+        opts->period_ms = atoi(arg);
+        break;
+    case OPT_SHORT_BUFFER_MS:
+        opts->buffer_ms = atoi(arg);
+        break;
+    case OPT_SHORT_PERIOD_MAX_MS:
+        opts->period_max_ms = atoi(arg);
+        break;
+    case OPT_SHORT_SAMPLE_FORMAT:
+        strncpy(opts->sample_format, arg, OPT_STR_SIZE - 1);
+        break;
     case OPT_SHORT_SQUELCH:
         opts->squelch = atof(arg);
         break;
@@ -118,9 +161,30 @@ static error_t parse_opt(int key, char *arg, struct argp_state *state)
     case OPT_SHORT_TX_TAIL:
         opts->tx_tail = atof(arg);
         break;
+    case OPT_SHORT_TX_BURST_MAX_MS:
+        opts->tx_burst_max_ms = atof(arg);
+        break;
     case OPT_SHORT_EXIT_IDLE_S:
         opts->exit_idle_s = atoi(arg);
         break;
+    case OPT_SHORT_QUAD_CROSS:
+        opts->quad_cross = true;
+        break;
+    case OPT_SHORT_RX_THREADS:
+        opts->rx_threads = true;
+        break;
+    case OPT_SHORT_DECIMATE:
+        opts->decimate = true;
+        break;
+    case OPT_SHORT_PERSIST:
+        opts->persist = atoi(arg);
+        break;
+    case OPT_SHORT_SLOTTIME_MS:
+        opts->slottime_ms = atoi(arg);
+        break;
+    case OPT_SHORT_CSMA_SQUELCH:
+        opts->csma_squelch = true;
+        break;
     case ARGP_KEY_NO_ARGS:
         break;
     default:
@@ -18,24 +18,40 @@ void opts_parse_conf_file(options_t *opts, const char *filename)
     opts->kiss = conf_get_bool_or_default(&conf, OPT_KISS, opts->kiss);
     opts->dev_input = conf_get_bool_or_default(&conf, OPT_DEV_INPUT, opts->dev_input);
     opts->dev_output = conf_get_bool_or_default(&conf, OPT_DEV_OUTPUT, opts->dev_output);
+    opts->quad_cross = conf_get_bool_or_default(&conf, OPT_QUAD_CROSS, opts->quad_cross);
+    opts->mmap = conf_get_bool_or_default(&conf, OPT_MMAP, opts->mmap);
+    opts->rx_threads = conf_get_bool_or_default(&conf, OPT_RX_THREADS, opts->rx_threads);
+    opts->decimate = conf_get_bool_or_default(&conf, OPT_DECIMATE, opts->decimate);
+    opts->csma_squelch = conf_get_bool_or_default(&conf, OPT_CSMA_SQUELCH, opts->csma_squelch);
 
     opts->rate = conf_get_int_or_default(&conf, OPT_RATE, opts->rate);
+    opts->channels = conf_get_int_or_default(&conf, OPT_CHANNELS, opts->channels);
+    opts->period_ms = conf_get_int_or_default(&conf, OPT_PERIOD_MS, opts->period_ms);
+    opts->buffer_ms = conf_get_int_or_default(&conf, OPT_BUFFER_MS, opts->buffer_ms);
+    opts->period_max_ms = conf_get_int_or_default(&conf, OPT_PERIOD_MAX_MS, opts->period_max_ms);
+    opts->persist = conf_get_int_or_default(&conf, OPT_PERSIST, opts->persist);
+    opts->slottime_ms = conf_get_int_or_default(&conf, OPT_SLOTTIME_MS, opts->slottime_ms);
     opts->tcp_kiss_port = conf_get_int_or_default(&conf, OPT_TCP_KISS_PORT, opts->tcp_kiss_port);
     opts->tcp_tnc2_port = conf_get_int_or_default(&conf, OPT_TCP_TNC2_PORT, opts->tcp_tnc2_port);
     opts->udp_kiss_port = conf_get_int_or_default(&conf, OPT_UDP_KISS_PORT, opts->udp_kiss_port);
     opts->udp_tnc2_port = conf_get_int_or_default(&conf, OPT_UDP_TNC2_PORT, opts->udp_tnc2_port);
     opts->udp_kiss_listen_port = conf_get_int_or_default(&conf, OPT_UDP_KISS_LISTEN_PORT, opts->udp_kiss_listen_port);
     opts->udp_tnc2_listen_port = conf_get_int_or_default(&conf, OPT_UDP_TNC2_LISTEN_PORT, opts->udp_tnc2_listen_port);
+    opts->metrics_tcp_port = conf_get_int_or_default(&conf, OPT_METRICS_TCP_PORT, opts->metrics_tcp_port);
 
     opts->squelch = conf_get_float_or_default(&conf, OPT_SQUELCH, opts->squelch);
     opts->gain_2200 = conf_get_float_or_default(&conf, OPT_GAIN_2200, opts->gain_2200);
     opts->tx_delay = conf_get_float_or_default(&conf, OPT_TX_DELAY, opts->tx_delay);
     opts->tx_tail = conf_get_float_or_default(&conf, OPT_TX_TAIL, opts->tx_tail);
+    opts->tx_burst_max_ms = conf_get_float_or_default(&conf, OPT_TX_BURST_MAX_MS, opts->tx_burst_max_ms);
 
     const char *val;
     val = conf_get_str_or_default(&conf, OPT_DEV_NAME, opts->dev_name);
     if (opts->dev_name[0] == '\0')
         strncpy(opts->dev_name, val, OPT_STR_SIZE - 1);
+    val = conf_get_str_or_default(&conf, OPT_SAMPLE_FORMAT, opts->sample_format);
+    if (opts->sample_format[0] == '\0')
+        strncpy(opts->sample_format, val, OPT_STR_SIZE - 1);
     val = conf_get_str_or_default(&conf, OPT_UDP_KISS_ADDR, opts->udp_kiss_addr);
     if (opts->udp_kiss_addr[0] == '\0')
         strncpy(opts->udp_kiss_addr, val, OPT_STR_SIZE - 1);
@@ -50,4 +66,12 @@ void opts_parse_conf_file(options_t *opts, const char *filename)
     val = conf_get_str_or_default(&conf, OPT_UDS_TNC2_SOCKET, opts->uds_tnc2_socket_path);
     if (opts->uds_tnc2_socket_path[0] == '\0')
         strncpy(opts->uds_tnc2_socket_path, val, OPT_STR_SIZE - 1);
+
+    val = conf_get_str_or_default(&conf, OPT_CLIENT_OVERFLOW, opts->client_overflow);
+    if (opts->client_overflow[0] == '\0')
+        strncpy(opts->client_overflow, val, OPT_STR_SIZE - 1);
+
+    val = conf_get_str_or_default(&conf, OPT_METRICS_UDS_SOCKET, opts->metrics_uds_socket_path);
+    if (opts->metrics_uds_socket_path[0] == '\0')
+        strncpy(opts->metrics_uds_socket_path, val, OPT_STR_SIZE - 1);
 }
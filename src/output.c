@@ -0,0 +1,505 @@
+#include "output.h"
+#include "common.h"
+#include "ax25.h"
+#include "kiss.h"
+#include "tnc2.h"
+#include "tstamp.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+#define OUTPUT_CTL_SIZE (2 * OUTPUT_CLIENTS_MAX)
+#define OUTPUT_POLL_TIMEOUT 1000
+#define OUTPUT_STATS_INTERVAL_S 60
+
+typedef struct output_ctl
+{
+    bool add;
+    int fd;
+    int dup_fd;
+    output_client_kind_t kind;
+} output_ctl_t;
+
+static const char *output_client_kind_name(output_client_kind_t kind)
+{
+    switch (kind)
+    {
+    case OUTPUT_CLIENT_TCP_KISS:
+        return "tcp kiss";
+    case OUTPUT_CLIENT_TCP_TNC2:
+        return "tcp tnc2";
+    case OUTPUT_CLIENT_UDS_KISS:
+        return "uds kiss";
+    case OUTPUT_CLIENT_UDS_TNC2:
+        return "uds tnc2";
+    }
+    return "?";
+}
+
+static void output_wake(output_t *out)
+{
+    if (!atomic_exchange(&out->sleeping, false))
+        return;
+
+    uint64_t one = 1;
+    if (write(out->wake_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+        LOGV("error waking output thread: %s", strerror(errno));
+}
+
+//
+
+static void on_output_client_writable(int fd, uint32_t revents, void *ctx);
+
+static void output_client_metrics(output_t *out, int slot)
+{
+    const output_client_t *client = &out->clients[slot];
+    metrics_set(out->client_bytes[slot], client->queue.bytes);
+    metrics_set(out->client_dropped[slot], (int64_t)client->queue.dropped);
+    metrics_hide(out->client_bytes[slot], !client->active);
+    metrics_hide(out->client_dropped[slot], !client->active);
+}
+
+static void output_client_want_write(output_t *out, output_client_t *client, bool want)
+{
+    if (client->want_write == want)
+        return;
+
+    if (want)
+        evloop_add(&out->evloop, client->fd, POLLOUT, on_output_client_writable, out);
+    else
+        evloop_remove(&out->evloop, client->fd);
+    client->want_write = want;
+}
+
+// The server notices the shutdown as end of stream on its next read and reports the disconnect
+static void output_client_close(output_t *out, output_client_t *client, const char *reason)
+{
+    if (client->closing)
+        return;
+
+    LOG("%s client %d %s, disconnecting", output_client_kind_name(client->kind), client->server_fd, reason);
+    shutdown(client->fd, SHUT_RDWR);
+    output_client_want_write(out, client, false);
+    client->closing = true;
+}
+
+static void on_output_client_writable(int fd, uint32_t revents, void *ctx)
+{
+    output_t *out = ctx;
+
+    for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+    {
+        output_client_t *client = &out->clients[i];
+        if (!client->active || client->fd != fd)
+            continue;
+
+        int left = outq_flush(&client->queue, fd);
+        if (left < 0)
+            output_client_close(out, client, "write failed");
+        else
+            output_client_want_write(out, client, left > 0);
+        output_client_metrics(out, i);
+        return;
+    }
+}
+
+static bool output_has_clients(const output_t *out, output_client_kind_t a, output_client_kind_t b)
+{
+    for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+        if (out->clients[i].active && (out->clients[i].kind == a || out->clients[i].kind == b))
+            return true;
+    return false;
+}
+
+static void output_broadcast(output_t *out, output_client_kind_t kind, const uint8_t *data, int len)
+{
+    for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+    {
+        output_client_t *client = &out->clients[i];
+        if (!client->active || client->kind != kind || client->closing)
+            continue;
+
+        if (outq_push(&client->queue, data, len) < 0)
+        {
+            if (client->queue.policy == OUTQ_DISCONNECT)
+            {
+                output_client_close(out, client, "cannot keep up");
+                continue;
+            }
+            LOGV("%s client %d: output queue full, packet dropped", output_client_kind_name(kind), client->server_fd);
+        }
+
+        // While POLLOUT is armed the writable handler drains the backlog, otherwise try the socket right away
+        // and only arm it when the kernel buffer is full
+        if (!client->want_write)
+        {
+            int left = outq_flush(&client->queue, client->fd);
+            if (left < 0)
+                output_client_close(out, client, "write failed");
+            else if (left > 0)
+                output_client_want_write(out, client, true);
+        }
+        output_client_metrics(out, i);
+    }
+}
+
+static void output_apply_ctl(output_t *out)
+{
+    output_ctl_t ctl;
+    while (ring_queue_pop(out->ctl, &ctl) == 0)
+    {
+        if (ctl.add)
+        {
+            output_client_t *client = NULL;
+            int slot = 0;
+            for (; slot < OUTPUT_CLIENTS_MAX; slot++)
+                if (!out->clients[slot].active)
+                {
+                    client = &out->clients[slot];
+                    break;
+                }
+            if (client == NULL)
+            {
+                LOG("%s client %d: no output queue left, it will not receive packets",
+                    output_client_kind_name(ctl.kind), ctl.fd);
+                close(ctl.dup_fd);
+                continue;
+            }
+
+            client->active = true;
+            client->fd = ctl.dup_fd;
+            client->server_fd = ctl.fd;
+            client->kind = ctl.kind;
+            client->want_write = false;
+            client->closing = false;
+            outq_init(&client->queue, out->params.client_overflow);
+            output_client_metrics(out, slot);
+            continue;
+        }
+
+        for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+        {
+            output_client_t *client = &out->clients[i];
+            if (!client->active || client->server_fd != ctl.fd)
+                continue;
+
+            if (client->queue.dropped > 0)
+                LOG("%s client %d disconnected, %llu packets dropped", output_client_kind_name(client->kind),
+                    client->server_fd, (unsigned long long)client->queue.dropped);
+            output_client_want_write(out, client, false);
+            close(client->fd);
+            client->active = false;
+            output_client_metrics(out, i);
+            break;
+        }
+    }
+}
+
+//
+
+static void output_write_frame(output_t *out, const output_rx_frame_t *frame)
+{
+    LOGD("writing frame: %d bytes, channel %d", frame->size, frame->channel);
+
+    bool kiss_stdout = out->params.kiss_stdout;
+    if (kiss_stdout || out->params.udp_kiss ||
+        output_has_clients(out, OUTPUT_CLIENT_TCP_KISS, OUTPUT_CLIENT_UDS_KISS))
+    {
+        kiss_message_t kiss_msg;
+        kiss_msg.port = frame->channel;
+        kiss_msg.command = 0;
+        memcpy(&kiss_msg.data, frame->data, frame->size);
+        kiss_msg.data_length = frame->size;
+
+        char kiss_buffer[512];
+        int kiss_len = kiss_encode(&kiss_msg, kiss_buffer, sizeof(kiss_buffer));
+        if (kiss_len <= 0)
+            return;
+
+        if (kiss_stdout)
+        {
+            fwrite(kiss_buffer, 1, kiss_len, stdout);
+            fflush(stdout);
+        }
+
+        buffer_t kiss_send_buf = {.data = (unsigned char *)kiss_buffer, .capacity = sizeof(kiss_buffer), .size = kiss_len};
+        if (out->params.udp_kiss)
+            udp_sender_send(out->params.udp_kiss, &kiss_send_buf);
+
+        output_broadcast(out, OUTPUT_CLIENT_TCP_KISS, kiss_send_buf.data, kiss_len);
+        output_broadcast(out, OUTPUT_CLIENT_UDS_KISS, kiss_send_buf.data, kiss_len);
+    }
+
+    if (!kiss_stdout || out->params.udp_tnc2 ||
+        output_has_clients(out, OUTPUT_CLIENT_TCP_TNC2, OUTPUT_CLIENT_UDS_TNC2))
+    {
+        buffer_t frame_buf = {.data = (unsigned char *)frame->data, .capacity = frame->size, .size = frame->size};
+        ax25_packet_t packet;
+        if (ax25_packet_unpack(&packet, &frame_buf))
+            return;
+
+        char tnc2_data[512];
+        buffer_t tnc2_buf = {
+            .data = (unsigned char *)tnc2_data,
+            .capacity = sizeof(tnc2_data),
+            .size = 0};
+        int tnc2_len = tnc2_packet_to_string(&packet, &tnc2_buf);
+        if (tnc2_len <= 0)
+            return;
+
+        // Add newline before the end of the tnc2 string
+        if (tnc2_len + 1 < sizeof(tnc2_data))
+        {
+            tnc2_data[tnc2_len++] = '\n';
+            tnc2_data[tnc2_len] = '\0';
+        }
+
+        if (!kiss_stdout)
+        {
+            fwrite(tnc2_data, 1, tnc2_len, stdout);
+            fflush(stdout);
+        }
+
+        buffer_t tnc2_send_buf = {.data = (unsigned char *)tnc2_data, .capacity = sizeof(tnc2_data), .size = tnc2_len};
+        if (out->params.udp_tnc2)
+            udp_sender_send(out->params.udp_tnc2, &tnc2_send_buf);
+
+        output_broadcast(out, OUTPUT_CLIENT_TCP_TNC2, tnc2_send_buf.data, tnc2_len);
+        output_broadcast(out, OUTPUT_CLIENT_UDS_TNC2, tnc2_send_buf.data, tnc2_len);
+    }
+}
+
+static void output_stats(output_t *out, time_t now)
+{
+    if (now - out->stats_since < OUTPUT_STATS_INTERVAL_S)
+        return;
+
+    if (out->rx_latency && metrics_histogram_count(out->rx_latency) > 0)
+        LOGV("output: rx latency p50 %.1f ms, p99 %.1f ms, max %.1f ms",
+             metrics_histogram_percentile(out->rx_latency, 50.0) / 1000.0,
+             metrics_histogram_percentile(out->rx_latency, 99.0) / 1000.0,
+             atomic_load(&out->rx_latency->max) / 1000.0);
+
+    uint64_t dropped = atomic_load(&out->frames_dropped);
+    if (dropped > 0)
+        LOGV("output: %llu frames dropped on a full queue", (unsigned long long)dropped);
+    for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+    {
+        const output_client_t *client = &out->clients[i];
+        if (client->active && client->queue.dropped > 0)
+            LOGV("%s client %d: %d bytes queued, %llu packets dropped", output_client_kind_name(client->kind),
+                 client->server_fd, client->queue.bytes, (unsigned long long)client->queue.dropped);
+    }
+    out->stats_since = now;
+}
+
+static void on_output_wake(int fd, uint32_t revents, void *ctx)
+{
+    uint64_t count;
+    if (read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN)
+        LOGV("error reading output wakeup: %s", strerror(errno));
+}
+
+static void *output_run(void *arg)
+{
+    output_t *out = arg;
+    output_rx_frame_t frame;
+
+    for (;;)
+    {
+        output_apply_ctl(out);
+        while (ring_queue_pop(out->frames, &frame) == 0)
+        {
+            output_write_frame(out, &frame);
+            if (frame.audio_ns > 0)
+                metrics_observe(out->rx_latency, (uint64_t)(tstamp_now_ns() - frame.audio_ns) / 1000);
+        }
+        metrics_set(out->queue_frames, (int64_t)ring_queue_count(out->frames));
+        if (atomic_load(&out->stop))
+            break;
+
+        // Producers only signal once this is set, so look at the queues again before sleeping
+        atomic_store(&out->sleeping, true);
+        if (ring_queue_count(out->frames) > 0 || ring_queue_count(out->ctl) > 0)
+        {
+            atomic_store(&out->sleeping, false);
+            continue;
+        }
+
+        if (evloop_run_once(&out->evloop, OUTPUT_POLL_TIMEOUT) < 0 && errno != EINTR)
+            LOG("output event loop wait error: %s", strerror(errno));
+        atomic_store(&out->sleeping, false);
+        output_stats(out, time(NULL));
+    }
+
+    return NULL;
+}
+
+//
+
+int output_init(output_t *out, const output_params_t *params)
+{
+    nonnull(out, "out");
+    nonnull(params, "params");
+
+    out->params = *params;
+    out->frames = NULL;
+    out->ctl = NULL;
+    out->running = false;
+    out->stats_since = time(NULL);
+    atomic_store(&out->sleeping, false);
+    atomic_store(&out->stop, false);
+    atomic_store(&out->frames_dropped, 0);
+    out->rx_latency = metrics_histogram("miniwolf_rx_latency_seconds",
+                                        "Closing flag captured to frame written to stdout, UDP and client queues", NULL);
+    out->queue_frames = metrics_gauge("miniwolf_output_queue_frames", "Received frames waiting for output", NULL);
+    out->dropped_frames = metrics_counter("miniwolf_output_dropped_frames_total",
+                                          "Received frames dropped on a full output queue", NULL);
+    for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+    {
+        out->clients[i].active = false;
+        out->client_bytes[i] = metrics_gauge("miniwolf_client_queue_bytes", "Bytes queued for a TCP/UDS client",
+                                             "slot=\"%d\"", i);
+        out->client_dropped[i] = metrics_gauge("miniwolf_client_dropped_packets",
+                                               "Packets dropped for the client in a slot since it connected",
+                                               "slot=\"%d\"", i);
+        metrics_hide(out->client_bytes[i], true);
+        metrics_hide(out->client_dropped[i], true);
+    }
+
+    out->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (out->wake_fd < 0)
+        return -1;
+
+    if (evloop_init(&out->evloop) < 0 ||
+        evloop_add(&out->evloop, out->wake_fd, POLLIN, on_output_wake, out) < 0 ||
+        ring_queue_init(&out->frames, OUTPUT_QUEUE_FRAMES, sizeof(output_rx_frame_t)) != RING_SUCCESS ||
+        ring_queue_init(&out->ctl, OUTPUT_CTL_SIZE, sizeof(output_ctl_t)) != RING_SUCCESS)
+        return -1;
+
+    return 0;
+}
+
+int output_start(output_t *out)
+{
+    nonnull(out, "out");
+
+    if (out->running)
+        return 0;
+    if (pthread_create(&out->thread, NULL, output_run, out) != 0)
+        return -1;
+
+    out->running = true;
+    return 0;
+}
+
+int output_push(output_t *out, int channel, const buffer_t *frame_buf, int64_t audio_ns)
+{
+    nonnull(out, "out");
+    assert_buffer_valid(frame_buf);
+
+    output_rx_frame_t frame;
+    if (frame_buf->size > OUTPUT_FRAME_MAX)
+        return -1;
+
+    frame.channel = channel;
+    frame.time = time(NULL);
+    frame.audio_ns = audio_ns;
+    frame.size = frame_buf->size;
+    memcpy(frame.data, frame_buf->data, frame_buf->size);
+
+    if (ring_queue_push(out->frames, &frame))
+    {
+        atomic_fetch_add(&out->frames_dropped, 1);
+        metrics_inc(out->dropped_frames);
+        return -1;
+    }
+    metrics_set(out->queue_frames, (int64_t)ring_queue_count(out->frames));
+    return 0;
+}
+
+void output_notify(output_t *out)
+{
+    nonnull(out, "out");
+
+    if (ring_queue_count(out->frames) > 0)
+        output_wake(out);
+}
+
+static void output_push_ctl(output_t *out, const output_ctl_t *ctl)
+{
+    if (ring_queue_push(out->ctl, ctl))
+    {
+        LOG("output control queue full, client %d ignored", ctl->fd);
+        if (ctl->add)
+            close(ctl->dup_fd);
+        return;
+    }
+    output_wake(out);
+}
+
+void output_client_add(output_t *out, int fd, output_client_kind_t kind)
+{
+    nonnull(out, "out");
+
+    // The duplicate outlives the server closing its socket until the output thread sees the disconnect
+    output_ctl_t ctl = {.add = true, .fd = fd, .dup_fd = fcntl(fd, F_DUPFD_CLOEXEC, 0), .kind = kind};
+    if (ctl.dup_fd < 0)
+    {
+        LOG("%s client %d: %s", output_client_kind_name(kind), fd, strerror(errno));
+        return;
+    }
+    output_push_ctl(out, &ctl);
+}
+
+void output_client_remove(output_t *out, int fd)
+{
+    nonnull(out, "out");
+
+    output_ctl_t ctl = {.add = false, .fd = fd, .dup_fd = -1};
+    output_push_ctl(out, &ctl);
+}
+
+void output_free(output_t *out)
+{
+    nonnull(out, "out");
+
+    if (out->running)
+    {
+        atomic_store(&out->stop, true);
+        atomic_store(&out->sleeping, true);
+        output_wake(out);
+        pthread_join(out->thread, NULL);
+        out->running = false;
+    }
+
+    for (int i = 0; i < OUTPUT_CLIENTS_MAX; i++)
+        if (out->clients[i].active)
+        {
+            close(out->clients[i].fd);
+            out->clients[i].active = false;
+        }
+    if (out->ctl != NULL)
+    {
+        output_ctl_t ctl;
+        while (ring_queue_pop(out->ctl, &ctl) == 0)
+            if (ctl.add)
+                close(ctl.dup_fd);
+        ring_queue_destroy(out->ctl);
+        out->ctl = NULL;
+    }
+    if (out->frames != NULL)
+    {
+        ring_queue_destroy(out->frames);
+        out->frames = NULL;
+    }
+    evloop_free(&out->evloop);
+    if (out->wake_fd >= 0)
+        close(out->wake_fd);
+    out->wake_fd = -1;
+}
@@ -0,0 +1,129 @@
+#include "outq.h"
+#include "common.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+void outq_init(outq_t *q, outq_policy_t policy)
+{
+    nonnull(q, "q");
+
+    q->head = 0;
+    q->bytes = 0;
+    q->msg_head = 0;
+    q->msg_count = 0;
+    q->head_sent = 0;
+    q->policy = policy;
+    q->dropped = 0;
+}
+
+static bool outq_fits(const outq_t *q, int len)
+{
+    return q->msg_count < OUTQ_MSGS_MAX && q->bytes + len <= OUTQ_BYTES;
+}
+
+static void outq_drop_head(outq_t *q)
+{
+    int len = q->msg_len[q->msg_head];
+    q->head = (q->head + len) % OUTQ_BYTES;
+    q->bytes -= len;
+    q->msg_head = (q->msg_head + 1) % OUTQ_MSGS_MAX;
+    q->msg_count--;
+    q->dropped++;
+}
+
+int outq_push(outq_t *q, const uint8_t *data, int len)
+{
+    nonnull(q, "q");
+    nonnull(data, "data");
+
+    if (len <= 0)
+        return 0;
+
+    // A partially written message has to be finished to keep the stream framed
+    if (q->policy == OUTQ_DROP_OLDEST && len <= OUTQ_BYTES)
+        while (!outq_fits(q, len) && q->msg_count > 0 && q->head_sent == 0)
+            outq_drop_head(q);
+
+    if (!outq_fits(q, len))
+    {
+        q->dropped++;
+        return -1;
+    }
+
+    int tail = (q->head + q->bytes) % OUTQ_BYTES;
+    int first = len < OUTQ_BYTES - tail ? len : OUTQ_BYTES - tail;
+    memcpy(q->data + tail, data, first);
+    memcpy(q->data, data + first, len - first);
+    q->msg_len[(q->msg_head + q->msg_count) % OUTQ_MSGS_MAX] = len;
+    q->msg_count++;
+    q->bytes += len;
+    return 0;
+}
+
+static void outq_consume(outq_t *q, int n)
+{
+    q->head = (q->head + n) % OUTQ_BYTES;
+    q->bytes -= n;
+    while (n > 0)
+    {
+        int left = q->msg_len[q->msg_head] - q->head_sent;
+        int take = n < left ? n : left;
+        q->head_sent += take;
+        n -= take;
+        if (q->head_sent == q->msg_len[q->msg_head])
+        {
+            q->msg_head = (q->msg_head + 1) % OUTQ_MSGS_MAX;
+            q->msg_count--;
+            q->head_sent = 0;
+        }
+    }
+}
+
+int outq_flush(outq_t *q, int fd)
+{
+    nonnull(q, "q");
+
+    while (q->bytes > 0)
+    {
+        int len = q->bytes < OUTQ_BYTES - q->head ? q->bytes : OUTQ_BYTES - q->head;
+        ssize_t n = send(fd, q->data + q->head, len, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                break;
+            return -1;
+        }
+        outq_consume(q, (int)n);
+    }
+    return q->bytes;
+}
+
+int outq_policy_parse(const char *name)
+{
+    if (name == NULL)
+        return -1;
+    if (strcmp(name, "drop-oldest") == 0)
+        return OUTQ_DROP_OLDEST;
+    if (strcmp(name, "drop-newest") == 0)
+        return OUTQ_DROP_NEWEST;
+    if (strcmp(name, "disconnect") == 0)
+        return OUTQ_DISCONNECT;
+    return -1;
+}
+
+const char *outq_policy_name(outq_policy_t policy)
+{
+    switch (policy)
+    {
+    case OUTQ_DROP_OLDEST:
+        return "drop-oldest";
+    case OUTQ_DROP_NEWEST:
+        return "drop-newest";
+    case OUTQ_DISCONNECT:
+        return "disconnect";
+    }
+    return "?";
+}
@@ -0,0 +1,336 @@
+#include "pcm.h"
+#include "common.h"
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define PCM_HOST_LITTLE_ENDIAN false
+#else
+#define PCM_HOST_LITTLE_ENDIAN true
+#endif
+
+// Kernels are plain per-format loops with the byte order decision hoisted out,
+// memcpy loads and power of two scales so the compiler vectorizes them.
+
+static void pcm_f32_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    if (!swap)
+    {
+        memcpy(out, in, n * sizeof(float));
+        return;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t v;
+        memcpy(&v, in + i * 4, 4);
+        v = __builtin_bswap32(v);
+        memcpy(&out[i], &v, 4);
+    }
+}
+
+static void pcm_f64_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint64_t v;
+        double d;
+        memcpy(&v, in + i * 8, 8);
+        if (swap)
+            v = __builtin_bswap64(v);
+        memcpy(&d, &v, 8);
+        out[i] = (float)d;
+    }
+}
+
+static void pcm_s8_to_float(const uint8_t *in, float *out, int n)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = (int8_t)in[i] * (1.0f / 128.0f);
+}
+
+static void pcm_u8_to_float(const uint8_t *in, float *out, int n)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = in[i] * (1.0f / 128.0f) - 1.0f;
+}
+
+static void pcm_s16_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    if (swap)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            uint16_t v;
+            memcpy(&v, in + i * 2, 2);
+            out[i] = (int16_t)__builtin_bswap16(v) * (1.0f / 32768.0f);
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        int16_t v;
+        memcpy(&v, in + i * 2, 2);
+        out[i] = v * (1.0f / 32768.0f);
+    }
+}
+
+static void pcm_u16_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint16_t v;
+        memcpy(&v, in + i * 2, 2);
+        if (swap)
+            v = __builtin_bswap16(v);
+        out[i] = v * (2.0f / 65536.0f) - 1.0f;
+    }
+}
+
+static void pcm_s24_3_to_float(const uint8_t *in, float *out, int n, bool little_endian)
+{
+    int lo = little_endian ? 0 : 2;
+    int hi = little_endian ? 2 : 0;
+    for (int i = 0; i < n; i++)
+    {
+        const uint8_t *p = in + i * 3;
+        uint32_t v = (uint32_t)p[lo] | (uint32_t)p[1] << 8 | (uint32_t)p[hi] << 16;
+        out[i] = ((int32_t)(v << 8) >> 8) * (1.0f / 8388608.0f);
+    }
+}
+
+static void pcm_s24_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t v;
+        memcpy(&v, in + i * 4, 4);
+        if (swap)
+            v = __builtin_bswap32(v);
+        out[i] = ((int32_t)(v << 8) >> 8) * (1.0f / 8388608.0f);
+    }
+}
+
+static void pcm_s32_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    if (swap)
+    {
+        for (int i = 0; i < n; i++)
+        {
+            uint32_t v;
+            memcpy(&v, in + i * 4, 4);
+            out[i] = (int32_t)__builtin_bswap32(v) * (1.0f / 2147483648.0f);
+        }
+        return;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        int32_t v;
+        memcpy(&v, in + i * 4, 4);
+        out[i] = v * (1.0f / 2147483648.0f);
+    }
+}
+
+static void pcm_u32_to_float(const uint8_t *in, float *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t v;
+        memcpy(&v, in + i * 4, 4);
+        if (swap)
+            v = __builtin_bswap32(v);
+        out[i] = v * (2.0f / 4294967296.0f) - 1.0f;
+    }
+}
+
+static inline float pcm_clip(float x)
+{
+    return x > 1.0f ? 1.0f : (x < -1.0f ? -1.0f : x);
+}
+
+static void pcm_float_to_f32(const float *in, uint8_t *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        float x = pcm_clip(in[i]);
+        uint32_t v;
+        memcpy(&v, &x, 4);
+        if (swap)
+            v = __builtin_bswap32(v);
+        memcpy(out + i * 4, &v, 4);
+    }
+}
+
+static void pcm_float_to_s16(const float *in, uint8_t *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint16_t v = (uint16_t)(int16_t)(pcm_clip(in[i]) * 32767.0f);
+        if (swap)
+            v = __builtin_bswap16(v);
+        memcpy(out + i * 2, &v, 2);
+    }
+}
+
+static void pcm_float_to_s24_3(const float *in, uint8_t *out, int n, bool little_endian)
+{
+    int lo = little_endian ? 0 : 2;
+    int hi = little_endian ? 2 : 0;
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t v = (uint32_t)(int32_t)(pcm_clip(in[i]) * 8388607.0f);
+        uint8_t *p = out + i * 3;
+        p[lo] = v;
+        p[1] = v >> 8;
+        p[hi] = v >> 16;
+    }
+}
+
+static void pcm_float_to_s24(const float *in, uint8_t *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t v = (uint32_t)(int32_t)(pcm_clip(in[i]) * 8388607.0f);
+        if (swap)
+            v = __builtin_bswap32(v);
+        memcpy(out + i * 4, &v, 4);
+    }
+}
+
+static void pcm_float_to_s32(const float *in, uint8_t *out, int n, bool swap)
+{
+    for (int i = 0; i < n; i++)
+    {
+        // 2^31 - 1 rounds up to 2^31 in float, so full scale is clamped after scaling instead
+        float x = pcm_clip(in[i]) * 2147483648.0f;
+        uint32_t v = (uint32_t)(x >= 2147483648.0f ? INT32_MAX : (int32_t)x);
+        if (swap)
+            v = __builtin_bswap32(v);
+        memcpy(out + i * 4, &v, 4);
+    }
+}
+
+int pcm_codec_init(pcm_codec_t *codec, pcm_format_t format, bool little_endian)
+{
+    nonnull(codec, "codec");
+
+    static const int sample_bytes[] = {
+        [PCM_FORMAT_F32] = 4,
+        [PCM_FORMAT_F64] = 8,
+        [PCM_FORMAT_S8] = 1,
+        [PCM_FORMAT_S16] = 2,
+        [PCM_FORMAT_S24_3] = 3,
+        [PCM_FORMAT_S24] = 4,
+        [PCM_FORMAT_S32] = 4,
+        [PCM_FORMAT_U8] = 1,
+        [PCM_FORMAT_U16] = 2,
+        [PCM_FORMAT_U32] = 4,
+    };
+
+    if ((int)format < 0 || format > PCM_FORMAT_U32)
+        return -1;
+
+    codec->format = format;
+    codec->little_endian = little_endian;
+    codec->sample_bytes = sample_bytes[format];
+    return 0;
+}
+
+void pcm_to_float(const pcm_codec_t *codec, const void *in, float *out, int n)
+{
+    const uint8_t *src = in;
+    bool swap = codec->little_endian != PCM_HOST_LITTLE_ENDIAN;
+
+    switch (codec->format)
+    {
+    case PCM_FORMAT_F32:
+        pcm_f32_to_float(src, out, n, swap);
+        break;
+    case PCM_FORMAT_F64:
+        pcm_f64_to_float(src, out, n, swap);
+        break;
+    case PCM_FORMAT_S8:
+        pcm_s8_to_float(src, out, n);
+        break;
+    case PCM_FORMAT_S16:
+        pcm_s16_to_float(src, out, n, swap);
+        break;
+    case PCM_FORMAT_S24_3:
+        pcm_s24_3_to_float(src, out, n, codec->little_endian);
+        break;
+    case PCM_FORMAT_S24:
+        pcm_s24_to_float(src, out, n, swap);
+        break;
+    case PCM_FORMAT_S32:
+        pcm_s32_to_float(src, out, n, swap);
+        break;
+    case PCM_FORMAT_U8:
+        pcm_u8_to_float(src, out, n);
+        break;
+    case PCM_FORMAT_U16:
+        pcm_u16_to_float(src, out, n, swap);
+        break;
+    case PCM_FORMAT_U32:
+        pcm_u32_to_float(src, out, n, swap);
+        break;
+    }
+}
+
+int pcm_from_float(const pcm_codec_t *codec, const float *in, void *out, int n)
+{
+    uint8_t *dst = out;
+    bool swap = codec->little_endian != PCM_HOST_LITTLE_ENDIAN;
+
+    switch (codec->format)
+    {
+    case PCM_FORMAT_F32:
+        pcm_float_to_f32(in, dst, n, swap);
+        return 0;
+    case PCM_FORMAT_S16:
+        pcm_float_to_s16(in, dst, n, swap);
+        return 0;
+    case PCM_FORMAT_S24_3:
+        pcm_float_to_s24_3(in, dst, n, codec->little_endian);
+        return 0;
+    case PCM_FORMAT_S24:
+        pcm_float_to_s24(in, dst, n, swap);
+        return 0;
+    case PCM_FORMAT_S32:
+        pcm_float_to_s32(in, dst, n, swap);
+        return 0;
+    default:
+        return -1;
+    }
+}
+
+bool pcm_codec_is_native_float(const pcm_codec_t *codec)
+{
+    return codec->format == PCM_FORMAT_F32 && codec->little_endian == PCM_HOST_LITTLE_ENDIAN;
+}
+
+const char *pcm_format_name(pcm_format_t format)
+{
+    switch (format)
+    {
+    case PCM_FORMAT_F32:
+        return "F32";
+    case PCM_FORMAT_F64:
+        return "F64";
+    case PCM_FORMAT_S8:
+        return "S8";
+    case PCM_FORMAT_S16:
+        return "S16";
+    case PCM_FORMAT_S24_3:
+        return "S24_3";
+    case PCM_FORMAT_S24:
+        return "S24";
+    case PCM_FORMAT_S32:
+        return "S32";
+    case PCM_FORMAT_U8:
+        return "U8";
+    case PCM_FORMAT_U16:
+        return "U16";
+    case PCM_FORMAT_U32:
+        return "U32";
+    }
+    return "?";
+}
@@ -116,6 +116,86 @@ size_t ring_read(ring_buffer_t *ring, float *samples, size_t num_samples)
     return to_read;
 }
 
+struct ring_queue
+{
+    unsigned char *items;
+    size_t item_size;
+    size_t size;
+    _Atomic size_t read_idx;
+    _Atomic size_t write_idx;
+};
+
+ring_error_t ring_queue_init(ring_queue_t **queue, size_t capacity, size_t item_size)
+{
+    nonnull(queue, "queue");
+    nonzero(capacity, "capacity");
+    nonzero(item_size, "item_size");
+
+    *queue = malloc(sizeof(ring_queue_t));
+    if (!*queue)
+        return RING_ERR_MEM_BUFFER;
+
+    (*queue)->items = calloc(capacity, item_size);
+    if (!(*queue)->items)
+    {
+        free(*queue);
+        *queue = NULL;
+        return RING_ERR_MEM_BUFFER;
+    }
+
+    (*queue)->item_size = item_size;
+    (*queue)->size = capacity;
+    atomic_store(&(*queue)->read_idx, 0);
+    atomic_store(&(*queue)->write_idx, 0);
+
+    return RING_SUCCESS;
+}
+
+void ring_queue_destroy(ring_queue_t *queue)
+{
+    nonnull(queue, "queue");
+
+    free(queue->items);
+    free(queue);
+}
+
+int ring_queue_push(ring_queue_t *queue, const void *item)
+{
+    nonnull(queue, "queue");
+    nonnull(item, "item");
+
+    size_t write = atomic_load(&queue->write_idx);
+    size_t read = atomic_load(&queue->read_idx);
+    if (write - read >= queue->size)
+        return -1;
+
+    memcpy(&queue->items[(write % queue->size) * queue->item_size], item, queue->item_size);
+    atomic_store(&queue->write_idx, write + 1);
+    return 0;
+}
+
+int ring_queue_pop(ring_queue_t *queue, void *item)
+{
+    nonnull(queue, "queue");
+    nonnull(item, "item");
+
+    size_t write = atomic_load(&queue->write_idx);
+    size_t read = atomic_load(&queue->read_idx);
+    if (write == read)
+        return -1;
+
+    memcpy(item, &queue->items[(read % queue->size) * queue->item_size], queue->item_size);
+    atomic_store(&queue->read_idx, read + 1);
+    return 0;
+}
+
+size_t ring_queue_count(const ring_queue_t *queue)
+{
+    nonnull(queue, "queue");
+
+    return atomic_load(&queue->write_idx) - atomic_load(&queue->read_idx);
+}
+
 ring_error_t ring_simple_init(ring_simple_t *ring, size_t capacity)
 {
     nonnull(ring, "ring");
@@ -146,3 +226,13 @@ float ring_simple_shift1(ring_simple_t *ring, const float sample)
     ring->head = (ring->head + 1) % ring->size;
     return old;
 }
+
+void ring_simple_free(ring_simple_t *ring)
+{
+    nonnull(ring, "ring");
+
+    free(ring->buffer);
+    ring->buffer = NULL;
+    ring->size = 0;
+    ring->head = 0;
+}
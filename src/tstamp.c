@@ -0,0 +1,43 @@
+#include "tstamp.h"
+#include "common.h"
+
+void tstamp_map_init(tstamp_map_t *map, float sample_rate)
+{
+    nonnull(map, "map");
+    nonzero(sample_rate, "sample_rate");
+
+    map->sample_rate = sample_rate;
+    map->head = 0;
+    map->count = 0;
+}
+
+void tstamp_map_add(tstamp_map_t *map, uint64_t pos, int64_t ns)
+{
+    nonnull(map, "map");
+
+    map->pos[map->head] = pos;
+    map->ns[map->head] = ns;
+    map->head = (map->head + 1) % TSTAMP_ANCHORS;
+    if (map->count < TSTAMP_ANCHORS)
+        map->count++;
+}
+
+int64_t tstamp_map_time(const tstamp_map_t *map, uint64_t pos)
+{
+    nonnull(map, "map");
+
+    if (map->count == 0)
+        return 0;
+
+    // Newest first; positions older than every anchor are extrapolated back from the oldest
+    int anchor = 0;
+    for (int i = 1; i <= map->count; i++)
+    {
+        anchor = (map->head - i + TSTAMP_ANCHORS) % TSTAMP_ANCHORS;
+        if (map->pos[anchor] <= pos)
+            break;
+    }
+
+    double offset_s = ((double)pos - (double)map->pos[anchor]) / map->sample_rate;
+    return map->ns[anchor] + (int64_t)(offset_s * 1e9);
+}
@@ -2,9 +2,18 @@
 #include "test_ring.h"
 #include "test_modem.h"
 #include "test_mavg.h"
+#include "test_filter.h"
+#include "test_latctl.h"
+#include "test_pcm.h"
+#include "test_evloop.h"
+#include "test_csma.h"
+#include "test_bitarr.h"
+#include "test_outq.h"
+#include "test_metrics.h"
+#include "test_tstamp.h"
 
 static const float sample_rates[] = {16000.0f, 22050.0f, 32000.0f, 44100.0f, 48000.0f};
-static const uint32_t demod_flags[] = {DEMOD_GOERTZEL_OPTIM, DEMOD_QUADRATURE};
+static const uint32_t demod_flags[] = {DEMOD_GOERTZEL_OPTIM, DEMOD_QUADRATURE, DEMOD_QUADRATURE_FAST};
 
 const char *demod_name(uint32_t flags)
 {
@@ -14,6 +23,8 @@ const char *demod_name(uint32_t flags)
         return "Goertzel (Pessimistic)";
     if (flags == DEMOD_QUADRATURE)
         return "Quadrature";
+    if (flags == DEMOD_QUADRATURE_FAST)
+        return "Quadrature (Cross product)";
     return "Unknown";
 }
 
@@ -27,6 +38,7 @@ int main(void)
     test_ring_full();
     test_ring_read_empty();
     test_ring_wrap();
+    test_ring_queue_push_pop();
     test_ring_shift1_empty();
     test_ring_shift1_delay();
     end_module();
@@ -46,6 +58,62 @@ int main(void)
     test_ema_free();
     end_module();
 
+    begin_module("Filter");
+    test_filter_lpf_block_matches_sample();
+    test_filter_hpf_block_in_place();
+    test_filter_bpf_block_matches_sample();
+    test_filter_mlpf_lanes_match_lpf();
+    test_filter_mlpf_block_in_place();
+    test_filter_decim_passband_stopband();
+    end_module();
+
+    begin_module("Latency Controller");
+    test_latctl_grows_on_xruns();
+    test_latctl_sparse_xruns();
+    test_latctl_shrinks_when_calm();
+    test_latctl_set_period();
+    test_latctl_disabled();
+    end_module();
+
+    begin_module("PCM");
+    test_pcm_s16_endianness();
+    test_pcm_s24_sign_extension();
+    test_pcm_round_trip();
+    test_pcm_s32_full_scale();
+    end_module();
+
+    begin_module("Event Loop");
+    test_evloop_dispatch();
+    test_evloop_regular_file();
+    end_module();
+
+    begin_module("Bit Array");
+    test_bitarr_append_get();
+    test_bitarr_nrzi();
+    end_module();
+
+    begin_module("Output Queue");
+    test_outq_overflow_policies();
+    test_outq_flush_partial();
+    end_module();
+
+    begin_module("Metrics");
+    test_metrics_counter_gauge();
+    test_metrics_serve();
+    test_metrics_histogram();
+    test_metrics_histogram_precision();
+    end_module();
+
+    begin_module("Timestamps");
+    test_tstamp_map();
+    end_module();
+
+    begin_module("CSMA");
+    test_csma_waits_while_busy();
+    test_csma_persistence();
+    test_csma_full_duplex();
+    end_module();
+
     begin_module("Bell202");
     for (int j = 0; j < sizeof(demod_flags) / sizeof(demod_flags[0]); j++)
     {
@@ -73,6 +141,7 @@ int main(void)
             test_modem_empty_payload(sample_rate, demod_flag);
             test_modem_max_size_payload(sample_rate, demod_flag);
             test_modem_various_patterns(sample_rate, demod_flag);
+            test_modem_demod_block_matches_sample(sample_rate, demod_flag);
             md_rx_free(&rx);
             md_tx_free(&tx);
         }
@@ -81,7 +150,20 @@ int main(void)
     }
     // Multi-receiver and high-level API tests
     test_modem_multi_rx_basic();
+    test_modem_multi_rx_shared_front();
+    test_modem_multi_rx_decimated();
+    test_modem_multi_rx_dcd();
     test_modem_multi_rx_mixed_packets();
+    test_modem_multi_rx_threaded();
+    test_modem_multi_rx_threaded_time();
+    for (int i = 0; i < sizeof(sample_rates) / sizeof(sample_rates[0]); i++)
+    {
+        test_modem_mod_exact_baud(sample_rates[i]);
+        test_modem_tx_streaming(sample_rates[i]);
+    }
+    test_modem_mod_matches_sine();
+    test_modem_tx_burst();
+    test_modem_tx_echo();
     test_modem_highlevel_init_free();
     end_module();
 
@@ -0,0 +1,71 @@
+#ifndef TEST_BITARR_H
+#define TEST_BITARR_H
+
+#include "test.h"
+#include "bitarr.h"
+#include "nrzi.h"
+
+void test_bitarr_append_get()
+{
+    uint64_t words[BITARR_WORDS(200)];
+    for (int i = 0; i < BITARR_WORDS(200); i++)
+        words[i] = ~0ull;
+    bitarr_t ba;
+    bitarr_init(&ba, words, 200);
+
+    uint8_t bytes[130];
+    for (int i = 0; i < 130; i++)
+        bytes[i] = (i % 3) == 0;
+    assert_equal_int(bitarr_append(&ba, 1), 0, "append");
+    assert_equal_int(bitarr_append_bytes(&ba, bytes, 130), 0, "append across word boundaries");
+    assert_equal_int(ba.size, 131, "size");
+
+    int mismatches = bitarr_get(&ba, 0) != 1;
+    for (int i = 0; i < 130; i++)
+        mismatches += bitarr_get(&ba, i + 1) != bytes[i];
+    assert_equal_int(mismatches, 0, "bits read back, stale words cleared");
+
+    assert_equal_int(bitarr_append_bytes(&ba, bytes, 70), -1, "rejects bits past capacity");
+    assert_equal_int(ba.size, 131, "nothing appended on overflow");
+
+    bitarr_drop_front(&ba, 67);
+    mismatches = 0;
+    for (int i = 0; i < 64; i++)
+        mismatches += bitarr_get(&ba, i) != bytes[i + 66];
+    assert_equal_int(ba.size, 64, "size after drop");
+    assert_equal_int(mismatches, 0, "remaining bits shifted down");
+    bitarr_append(&ba, 1);
+    assert_equal_int(bitarr_last(&ba), 1, "append after drop");
+}
+
+void test_bitarr_nrzi()
+{
+    uint64_t words[4];
+    bitarr_t ba;
+    bitarr_init(&ba, words, 256);
+
+    assert_equal_int(bitarr_append_nrzi_byte(&ba, 0x7E, 3), 0, "flags");
+    int level;
+    nrzi_encoder_init(&level);
+    int mismatches = 0;
+    for (int i = 0; i < 24; i++)
+        mismatches += bitarr_get(&ba, i) != nrzi_encode((0x7E >> (i % 8)) & 1, &level);
+    assert_equal_int(mismatches, 0, "matches nrzi_encode");
+
+    // A flag framed from the idle level starts high; it must still be a transition here
+    uint8_t levels[8];
+    nrzi_encoder_init(&level);
+    for (int i = 0; i < 8; i++)
+        levels[i] = nrzi_encode((0x7E >> i) & 1, &level);
+    int last = bitarr_last(&ba);
+    assert_equal_int(bitarr_append_nrzi_levels(&ba, levels, 8), 0, "segment");
+    assert_true(bitarr_get(&ba, 24) != last, "segment opens with a transition");
+
+    int last_bit = 0;
+    int decoded = 0;
+    for (int i = 0; i < ba.size; i++)
+        decoded = decoded >> 1 | nrzi_decode(bitarr_get(&ba, i), &last_bit) << 7;
+    assert_equal_int(decoded, 0x7E, "segment decodes as a flag");
+}
+
+#endif
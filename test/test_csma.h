@@ -0,0 +1,53 @@
+#ifndef TEST_CSMA_H
+#define TEST_CSMA_H
+
+#include "test.h"
+#include "csma.h"
+
+void test_csma_waits_while_busy()
+{
+    csma_t csma;
+    csma_params_t params = {.persist = 255, .slottime_ms = 100, .full_duplex = false};
+    csma_init(&csma, &params, 1);
+
+    int wait_ms;
+    assert_equal_int(csma_poll(&csma, true, 1000, &wait_ms), CSMA_WAIT, "busy channel defers");
+    assert_equal_int(wait_ms, 100, "retry after one slot");
+    assert_equal_int(csma_poll(&csma, false, 1050, &wait_ms), CSMA_WAIT, "no attempt within the slot");
+    assert_equal_int(wait_ms, 50, "remaining slot time");
+    assert_equal_int(csma_poll(&csma, false, 1100, &wait_ms), CSMA_TRANSMIT, "persist 255 transmits on clear slot");
+}
+
+void test_csma_persistence()
+{
+    csma_t csma;
+    csma_params_t params = {.persist = 63, .slottime_ms = 10, .full_duplex = false};
+    csma_init(&csma, &params, 42);
+
+    int wait_ms;
+    int granted = 0;
+    const int attempts = 10000;
+    for (int i = 0; i < attempts; i++)
+    {
+        csma_reset(&csma);
+        if (csma_poll(&csma, false, (uint64_t)i * 10, &wait_ms) == CSMA_TRANSMIT)
+            granted++;
+    }
+    assert_true(granted > attempts / 4 - 300 && granted < attempts / 4 + 300, "grant rate close to 64/256");
+}
+
+void test_csma_full_duplex()
+{
+    csma_t csma;
+    csma_params_t params = {.persist = 0, .slottime_ms = 0, .full_duplex = true};
+    csma_init(&csma, &params, 7);
+
+    int wait_ms;
+    assert_equal_int(csma_poll(&csma, true, 0, &wait_ms), CSMA_TRANSMIT, "full duplex ignores busy channel");
+
+    csma.params.full_duplex = false;
+    assert_equal_int(csma_poll(&csma, true, 0, &wait_ms), CSMA_WAIT, "half duplex defers");
+    assert_equal_int(wait_ms, 1, "zero slot time still waits");
+}
+
+#endif
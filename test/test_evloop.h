@@ -0,0 +1,72 @@
+#ifndef TEST_EVLOOP_H
+#define TEST_EVLOOP_H
+
+#include "test.h"
+#include "evloop.h"
+#include <poll.h>
+#include <stdio.h>
+#include <unistd.h>
+
+typedef struct test_evloop_hits
+{
+    int count;
+    int last_fd;
+} test_evloop_hits_t;
+
+static void test_evloop_handler(int fd, uint32_t revents, void *ctx)
+{
+    test_evloop_hits_t *hits = ctx;
+    char c;
+    while (read(fd, &c, 1) == 1 && c != '\n')
+        ;
+    hits->count++;
+    hits->last_fd = fd;
+}
+
+void test_evloop_dispatch()
+{
+    evloop_t loop;
+    int a[2], b[2];
+    test_evloop_hits_t hits_a = {0}, hits_b = {0};
+
+    assert_equal_int(evloop_init(&loop), 0, "evloop init");
+    assert_true(pipe(a) == 0 && pipe(b) == 0, "pipes created");
+    evloop_add(&loop, a[0], POLLIN, test_evloop_handler, &hits_a);
+    evloop_add(&loop, b[0], POLLIN, test_evloop_handler, &hits_b);
+    assert_equal_int(evloop_add(&loop, a[0], POLLIN, test_evloop_handler, &hits_b), -1, "double registration rejected");
+
+    assert_equal_int(evloop_run_once(&loop, 0), 0, "nothing ready");
+
+    write(b[1], "x\n", 2);
+    assert_equal_int(evloop_run_once(&loop, 100), 1, "one fd ready");
+    assert_equal_int(hits_b.count, 1, "ready fd dispatched to its handler");
+    assert_equal_int(hits_b.last_fd, b[0], "handler gets its fd");
+    assert_equal_int(hits_a.count, 0, "idle fd not dispatched");
+
+    evloop_remove(&loop, b[0]);
+    write(b[1], "x\n", 2);
+    write(a[1], "x\n", 2);
+    evloop_run_once(&loop, 100);
+    assert_equal_int(hits_b.count, 1, "removed fd not dispatched");
+    assert_equal_int(hits_a.count, 1, "remaining fd dispatched");
+
+    evloop_free(&loop);
+    close(a[0]), close(a[1]), close(b[0]), close(b[1]);
+}
+
+void test_evloop_regular_file()
+{
+    evloop_t loop;
+    test_evloop_hits_t hits = {0};
+    FILE *file = tmpfile();
+
+    evloop_init(&loop);
+    assert_equal_int(evloop_add(&loop, fileno(file), POLLIN, test_evloop_handler, &hits), 0, "regular file accepted");
+    assert_equal_int(evloop_run_once(&loop, 1000), 1, "regular file always ready");
+    assert_equal_int(hits.count, 1, "regular file dispatched");
+
+    evloop_free(&loop);
+    fclose(file);
+}
+
+#endif
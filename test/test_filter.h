@@ -0,0 +1,163 @@
+#ifndef TEST_FILTER_H
+#define TEST_FILTER_H
+
+#include "test.h"
+#include "filter.h"
+#include "decim.h"
+#include <stdlib.h>
+#include <math.h>
+
+#define TEST_FILTER_SAMPLES 500
+
+static inline void test_filter_fill_input(float *in, int n)
+{
+    srand(11);
+    for (int i = 0; i < n; i++)
+        in[i] = (float)rand() / RAND_MAX - 0.5f;
+}
+
+void test_filter_lpf_block_matches_sample(void)
+{
+    float in[TEST_FILTER_SAMPLES], out_sample[TEST_FILTER_SAMPLES], out_block[TEST_FILTER_SAMPLES];
+    test_filter_fill_input(in, TEST_FILTER_SAMPLES);
+
+    for (int order = 2; order <= 8; order += 2)
+    {
+        bf_lpf_t f_sample, f_block;
+        bf_lpf_init(&f_sample, order, 1000.0f, 22050.0f);
+        bf_lpf_init(&f_block, order, 1000.0f, 22050.0f);
+
+        for (int i = 0; i < TEST_FILTER_SAMPLES; i++)
+            out_sample[i] = bf_lpf_filter(&f_sample, in[i]);
+        bf_lpf_filter_block(&f_block, in, out_block, 100);
+        bf_lpf_filter_block(&f_block, in + 100, out_block + 100, TEST_FILTER_SAMPLES - 100);
+
+        assert_memory(out_block, out_sample, sizeof(out_sample), "lpf block matches per-sample");
+
+        bf_lpf_free(&f_sample);
+        bf_lpf_free(&f_block);
+    }
+}
+
+void test_filter_hpf_block_in_place(void)
+{
+    float in[TEST_FILTER_SAMPLES], out_sample[TEST_FILTER_SAMPLES];
+    test_filter_fill_input(in, TEST_FILTER_SAMPLES);
+
+    bf_hpf_t f_sample, f_block;
+    bf_hpf_init(&f_sample, 4, 300.0f, 22050.0f);
+    bf_hpf_init(&f_block, 4, 300.0f, 22050.0f);
+
+    for (int i = 0; i < TEST_FILTER_SAMPLES; i++)
+        out_sample[i] = bf_hpf_filter(&f_sample, in[i]);
+    bf_hpf_filter_block(&f_block, in, in, TEST_FILTER_SAMPLES);
+
+    assert_memory(in, out_sample, sizeof(out_sample), "hpf in-place block matches per-sample");
+
+    bf_hpf_free(&f_sample);
+    bf_hpf_free(&f_block);
+}
+
+void test_filter_bpf_block_matches_sample(void)
+{
+    float in[TEST_FILTER_SAMPLES], out_sample[TEST_FILTER_SAMPLES], out_block[TEST_FILTER_SAMPLES];
+    test_filter_fill_input(in, TEST_FILTER_SAMPLES);
+
+    bf_bpf_t f_sample, f_block;
+    bf_bpf_init(&f_sample, 8, 900.0f, 2500.0f, 22050.0f);
+    bf_bpf_init(&f_block, 8, 900.0f, 2500.0f, 22050.0f);
+
+    for (int i = 0; i < TEST_FILTER_SAMPLES; i++)
+        out_sample[i] = bf_bpf_filter(&f_sample, in[i]);
+    bf_bpf_filter_block(&f_block, in, out_block, TEST_FILTER_SAMPLES);
+
+    assert_memory(out_block, out_sample, sizeof(out_sample), "bpf block matches per-sample");
+
+    bf_bpf_free(&f_sample);
+    bf_bpf_free(&f_block);
+}
+
+void test_filter_mlpf_lanes_match_lpf(void)
+{
+    float in[TEST_FILTER_SAMPLES];
+    test_filter_fill_input(in, TEST_FILTER_SAMPLES);
+
+    bf_mlpf_t mlpf;
+    bf_lpf_t lpf[BF_LANES];
+    bf_mlpf_init(&mlpf, 6, 1200.0f, 44100.0f);
+    for (int l = 0; l < BF_LANES; l++)
+        bf_lpf_init(&lpf[l], 6, 1200.0f, 44100.0f);
+
+    int mismatches = 0;
+    for (int i = 0; i < TEST_FILTER_SAMPLES; i++)
+    {
+        bf_lanes_t x;
+        for (int l = 0; l < BF_LANES; l++)
+            x[l] = in[(i + 37 * l) % TEST_FILTER_SAMPLES];
+        bf_lanes_t y = bf_mlpf_filter(&mlpf, x);
+        for (int l = 0; l < BF_LANES; l++)
+            if (fabsf(y[l] - bf_lpf_filter(&lpf[l], x[l])) > 1e-6f)
+                mismatches++;
+    }
+    assert_equal_int(mismatches, 0, "every mlpf lane matches a scalar lpf");
+
+    bf_mlpf_free(&mlpf);
+    for (int l = 0; l < BF_LANES; l++)
+        bf_lpf_free(&lpf[l]);
+}
+
+void test_filter_mlpf_block_in_place(void)
+{
+    float in[TEST_FILTER_SAMPLES];
+    test_filter_fill_input(in, TEST_FILTER_SAMPLES);
+
+    bf_lanes_t x[TEST_FILTER_SAMPLES], out_sample[TEST_FILTER_SAMPLES];
+    for (int i = 0; i < TEST_FILTER_SAMPLES; i++)
+        for (int l = 0; l < BF_LANES; l++)
+            x[i][l] = in[(i + 37 * l) % TEST_FILTER_SAMPLES];
+
+    bf_mlpf_t f_sample, f_block;
+    bf_mlpf_init(&f_sample, 6, 1200.0f, 44100.0f);
+    bf_mlpf_init(&f_block, 6, 1200.0f, 44100.0f);
+
+    for (int i = 0; i < TEST_FILTER_SAMPLES; i++)
+        out_sample[i] = bf_mlpf_filter(&f_sample, x[i]);
+    bf_mlpf_process_block(&f_block, x, x, 100);
+    bf_mlpf_process_block(&f_block, x + 100, x + 100, TEST_FILTER_SAMPLES - 100);
+
+    assert_memory(x, out_sample, sizeof(out_sample), "mlpf in-place block matches per-sample");
+
+    bf_mlpf_free(&f_sample);
+    bf_mlpf_free(&f_block);
+}
+
+static float test_filter_decim_tone_rms(float freq, float sample_rate, int factor)
+{
+    const int n = 4800;
+    float in[n], out[n];
+    for (int i = 0; i < n; i++)
+        in[i] = sinf(2.0f * M_PI * freq * i / sample_rate);
+
+    decim_t decim;
+    decim_init(&decim, factor, sample_rate, 3000.0f);
+    int out_count = decim_process_block(&decim, in, out, n);
+    assert_equal_int(out_count, n / factor, "decimator output count");
+
+    float power = 0.0f;
+    for (int i = out_count / 2; i < out_count; i++)
+        power += out[i] * out[i];
+    decim_free(&decim);
+
+    return sqrtf(power / (out_count - out_count / 2));
+}
+
+void test_filter_decim_passband_stopband(void)
+{
+    float pass = test_filter_decim_tone_rms(2200.0f, 48000.0f, 2);
+    float stop = test_filter_decim_tone_rms(20000.0f, 48000.0f, 2);
+
+    assert_true(fabsf(pass - sqrtf(0.5f)) < 0.02f, "decimator passes 2200 Hz");
+    assert_true(stop < 0.01f * sqrtf(0.5f), "decimator rejects 20 kHz by 40 dB");
+}
+
+#endif
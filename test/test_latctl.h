@@ -0,0 +1,73 @@
+#ifndef TEST_LATCTL_H
+#define TEST_LATCTL_H
+
+#include "test.h"
+#include "latctl.h"
+
+void test_latctl_grows_on_xruns()
+{
+    latctl_t ctl;
+    latctl_init(&ctl, 10, 80, &latctl_params_default, 0);
+
+    assert_equal_int(latctl_xrun(&ctl, 1000), 0, "single xrun keeps period");
+    assert_equal_int(latctl_xrun(&ctl, 2000), 20, "second xrun in window doubles period");
+    assert_equal_int(latctl_xrun(&ctl, 3000), 0, "window restarts after resize");
+    assert_equal_int(latctl_xrun(&ctl, 4000), 40, "grows again");
+    latctl_xrun(&ctl, 5000);
+    assert_equal_int(latctl_xrun(&ctl, 6000), 80, "grows to max");
+    latctl_xrun(&ctl, 7000);
+    assert_equal_int(latctl_xrun(&ctl, 8000), 0, "never grows above max");
+    assert_equal_int((int)ctl.total_xruns, 8, "all xruns counted");
+}
+
+void test_latctl_sparse_xruns()
+{
+    latctl_t ctl;
+    latctl_init(&ctl, 10, 80, &latctl_params_default, 0);
+
+    assert_equal_int(latctl_xrun(&ctl, 1000), 0, "first xrun keeps period");
+    assert_equal_int(latctl_xrun(&ctl, 20000), 0, "xrun outside window keeps period");
+    assert_equal_int(ctl.period_ms, 10, "period unchanged");
+}
+
+void test_latctl_shrinks_when_calm()
+{
+    latctl_t ctl;
+    latctl_init(&ctl, 10, 80, &latctl_params_default, 0);
+    latctl_xrun(&ctl, 0);
+    latctl_xrun(&ctl, 0);
+    latctl_xrun(&ctl, 0);
+    latctl_xrun(&ctl, 0);
+    assert_equal_int(ctl.period_ms, 40, "grown to 40 ms");
+
+    assert_equal_int(latctl_tick(&ctl, 30000), 0, "no shrink before calm period");
+    assert_equal_int(latctl_tick(&ctl, 60000), 20, "shrinks after calm period");
+    assert_equal_int(latctl_tick(&ctl, 90000), 0, "calm period restarts after resize");
+    assert_equal_int(latctl_tick(&ctl, 120000), 10, "shrinks back to configured period");
+    assert_equal_int(latctl_tick(&ctl, 999999), 0, "never shrinks below configured period");
+}
+
+void test_latctl_set_period()
+{
+    latctl_t ctl;
+    latctl_init(&ctl, 10, 80, &latctl_params_default, 0);
+    latctl_xrun(&ctl, 0);
+    assert_equal_int(latctl_xrun(&ctl, 0), 20, "grown to 20 ms");
+
+    latctl_set_period(&ctl, 10, 100);
+    assert_equal_int(ctl.period_ms, 10, "failed resize taken back");
+    assert_equal_int(latctl_tick(&ctl, 200), 0, "nothing left to shrink");
+    latctl_set_period(&ctl, 1000, 300);
+    assert_equal_int(ctl.period_ms, 80, "clamped to max");
+}
+
+void test_latctl_disabled()
+{
+    latctl_t ctl;
+    latctl_init(&ctl, 10, 0, &latctl_params_default, 0);
+
+    for (int i = 0; i < 10; i++)
+        assert_equal_int(latctl_xrun(&ctl, i), 0, "max below period disables growth");
+}
+
+#endif
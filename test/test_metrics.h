@@ -0,0 +1,158 @@
+#ifndef TEST_METRICS_H
+#define TEST_METRICS_H
+
+#include "test.h"
+#include "metrics.h"
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+#define TEST_METRICS_THREADS 4
+#define TEST_METRICS_INCREMENTS 10000
+
+static void *metrics_inc_thread(void *arg)
+{
+    metric_t *m = arg;
+    for (int i = 0; i < TEST_METRICS_INCREMENTS; i++)
+        metrics_inc(m);
+    return NULL;
+}
+
+void test_metrics_counter_gauge()
+{
+    metric_t *counter = metrics_counter("test_events_total", "Test events", "chain=\"%d\"", 1);
+    metric_t *gauge = metrics_gauge("test_fill", NULL, NULL);
+    assert_true(counter != NULL && gauge != NULL, "metrics registered");
+
+    pthread_t threads[TEST_METRICS_THREADS];
+    for (int i = 0; i < TEST_METRICS_THREADS; i++)
+        pthread_create(&threads[i], NULL, metrics_inc_thread, counter);
+    for (int i = 0; i < TEST_METRICS_THREADS; i++)
+        pthread_join(threads[i], NULL);
+    assert_equal_int((int)metrics_value(counter), TEST_METRICS_THREADS * TEST_METRICS_INCREMENTS,
+                     "increments from all threads counted");
+
+    metrics_set(gauge, 42);
+    metrics_set(gauge, 7);
+    assert_equal_int((int)metrics_value(gauge), 7, "gauge holds the last value");
+
+    metrics_inc(NULL);
+    metrics_set(NULL, 1);
+
+    static char buf[65536];
+    assert_true(metrics_render_text(buf, sizeof(buf)) > 0, "text rendered");
+    assert_true(strstr(buf, "# TYPE test_events_total counter\n") != NULL, "text has the type line");
+    assert_true(strstr(buf, "test_events_total{chain=\"1\"} 40000\n") != NULL, "text has the labelled value");
+
+    metrics_hide(gauge, true);
+    metrics_render_text(buf, sizeof(buf));
+    assert_true(strstr(buf, "test_fill") == NULL, "hidden gauge left out");
+    metrics_hide(gauge, false);
+
+    assert_true(metrics_render_json(buf, sizeof(buf)) > 0, "json rendered");
+    assert_true(strstr(buf, "{\"name\":\"test_events_total\",\"type\":\"counter\",\"labels\":{\"chain\":\"1\"},\"value\":40000}") != NULL,
+                "json has the labelled value");
+    assert_equal_int(metrics_render_text(buf, 16), -1, "small buffer reported");
+}
+
+void test_metrics_serve()
+{
+    int sv[2];
+    static char buf[65536];
+    static metrics_response_t resp;
+    const char *request = "GET /metrics.json HTTP/1.1\r\n\r\n";
+
+    assert_equal_int(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0, "socketpair");
+    assert_true(metrics_respond(&resp, request, strlen(request)) > 0, "http response rendered");
+    assert_equal_int(metrics_response_flush(&resp, sv[0]), 0, "http response sent");
+    int n = read(sv[1], buf, sizeof(buf) - 1);
+    buf[n > 0 ? n : 0] = '\0';
+    assert_true(strncmp(buf, "HTTP/1.0 200 OK\r\n", 17) == 0, "http status line");
+    assert_true(strstr(buf, "application/json") != NULL, "json content type");
+    close(sv[0]);
+    close(sv[1]);
+
+    // A client that does not read gets what fits its socket, the rest waits instead of blocking
+    assert_equal_int(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0, "socketpair");
+    int sndbuf = 4096;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+    resp.len = sizeof(resp.data);
+    resp.sent = 0;
+    memset(resp.data, '#', sizeof(resp.data));
+    int left = metrics_response_flush(&resp, sv[0]);
+    assert_true(left > 0 && left < resp.len, "slow client leaves a partial response");
+    close(sv[0]);
+    close(sv[1]);
+
+    assert_equal_int(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0, "socketpair");
+    metrics_respond(&resp, "\n", 1);
+    assert_equal_int(metrics_response_flush(&resp, sv[0]), 0, "raw response sent");
+    n = read(sv[1], buf, sizeof(buf) - 1);
+    buf[n > 0 ? n : 0] = '\0';
+    assert_true(strncmp(buf, "# HELP", 6) == 0, "raw request gets text");
+    close(sv[0]);
+    close(sv[1]);
+}
+
+void test_metrics_histogram()
+{
+    int misplaced = 0;
+    for (uint64_t v = 0; v < 100000; v += 7)
+    {
+        int b = metrics_histogram_bucket(v);
+        if (metrics_histogram_bucket_low(b) > v || v >= metrics_histogram_bucket_low(b + 1))
+            misplaced++;
+    }
+    assert_equal_int(misplaced, 0, "values within their buckets");
+    assert_equal_int(metrics_histogram_bucket(UINT64_MAX), METRICS_HIST_BUCKETS - 1, "huge values in the last bucket");
+
+    metrics_histogram_t *h = metrics_histogram("test_latency_seconds", "Test latency", NULL);
+    assert_true(h != NULL, "histogram registered");
+    assert_equal_int((int)metrics_histogram_percentile(h, 50.0), 0, "empty histogram");
+
+    for (int i = 1; i <= 100; i++)
+        metrics_observe(h, i * 1000);
+    assert_equal_int((int)metrics_histogram_count(h), 100, "all values counted");
+    uint64_t p50 = metrics_histogram_percentile(h, 50.0);
+    assert_true(p50 >= 50000 && p50 < 50000 + 50000 / 32, "median within bucket precision");
+    assert_equal_int((int)metrics_histogram_percentile(h, 100.0), 100000, "top percentile capped at max");
+
+    static char buf[65536];
+    metrics_render_text(buf, sizeof(buf));
+    assert_true(strstr(buf, "# TYPE test_latency_seconds histogram\n") != NULL, "histogram type line");
+    assert_true(strstr(buf, "test_latency_seconds_bucket{le=\"+Inf\"} 100\n") != NULL, "histogram total bucket");
+    assert_true(strstr(buf, "test_latency_seconds_sum 5.050000\n") != NULL, "histogram sum in seconds");
+    metrics_render_json(buf, sizeof(buf));
+    assert_true(strstr(buf, "\"name\":\"test_latency_seconds\",\"type\":\"histogram\"") != NULL, "histogram in json");
+}
+
+void test_metrics_histogram_precision()
+{
+    // Geometric spread from 1 ms to 1 s, e.g. p99 of 8 ms and 10 ms must land in different buckets
+    const int n = 1000;
+    static uint64_t values[1000];
+    metrics_histogram_t *h = metrics_histogram("test_precision_seconds", "Test precision", NULL);
+    assert_true(h != NULL, "histogram registered");
+    for (int i = 0; i < n; i++)
+    {
+        values[i] = (uint64_t)(1000.0 * pow(1000.0, (double)i / (n - 1)));
+        metrics_observe(h, values[i]);
+    }
+
+    const double percentiles[] = {1.0, 10.0, 25.0, 50.0, 75.0, 90.0, 99.0, 99.9};
+    double worst = 0.0;
+    for (int p = 0; p < (int)(sizeof(percentiles) / sizeof(percentiles[0])); p++)
+    {
+        uint64_t rank = (uint64_t)(percentiles[p] / 100.0 * n + 0.5);
+        uint64_t exact = values[rank - 1];
+        double error = fabs((double)metrics_histogram_percentile(h, percentiles[p]) - exact) / exact;
+        if (error > worst)
+            worst = error;
+    }
+    assert_true(worst <= 1.0 / (1 << METRICS_HIST_SUB_BITS), "quantiles within 1/32 of the exact value");
+    assert_true(metrics_histogram_bucket(8000) != metrics_histogram_bucket(10000), "8 ms and 10 ms apart");
+}
+
+#endif
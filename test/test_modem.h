@@ -408,6 +408,34 @@ void test_modem_with_digipeaters(float sample_rate, int num_digipeaters, uint32_
     test_modem_free_pair(&tx, &rx);
 }
 
+void test_modem_demod_block_matches_sample(float sample_rate, uint32_t demod_flags)
+{
+    const int num_samples = 1000;
+    demod_params_t params = {.mark_freq = 1200.0f, .space_freq = 2200.0f, .baud_rate = 1200.0f, .sample_rate = sample_rate};
+
+    demod_t demod_sample, demod_block;
+    demod_init(&demod_sample, demod_flags, &params);
+    demod_init(&demod_block, demod_flags, &params);
+
+    float in[num_samples];
+    srand(7);
+    for (int i = 0; i < num_samples; i++)
+        in[i] = sinf(2.0f * M_PI * ((i / 37) % 2 ? 1200.0f : 2200.0f) * i / sample_rate) + awgn(0.1f);
+
+    float out_sample[num_samples];
+    for (int i = 0; i < num_samples; i++)
+        out_sample[i] = demod_process(&demod_sample, in[i]);
+
+    float out_block[num_samples];
+    demod_process_block(&demod_block, in, out_block, 300);
+    demod_process_block(&demod_block, in + 300, out_block + 300, num_samples - 300);
+
+    assert_memory(out_block, out_sample, sizeof(out_sample), "block output matches per-sample output");
+
+    demod_free(&demod_sample);
+    demod_free(&demod_block);
+}
+
 void test_modem_snr_performance(uint32_t demod_flags)
 {
     const float sample_rate = 22050.0f;
@@ -509,6 +537,100 @@ void test_modem_multi_rx_basic()
     md_multi_rx_free(&mrx);
 }
 
+void test_modem_multi_rx_dcd()
+{
+    const float sample_rate = 22050.0f;
+    const int max_samples = test_modem_max_samples(sample_rate, 2.0f);
+
+    struct md_multi_rx mrx;
+    test_modem_init_multi(&mrx, sample_rate, DEMOD_ALL);
+
+    struct md_tx tx;
+    md_tx_init(&tx, sample_rate, tx_delay, tx_tail);
+
+    uint8_t data[64];
+    test_modem_generate_random_ascii(data, sizeof(data), 3);
+    buffer_t frame_buf = {.data = data, .capacity = sizeof(data), .size = sizeof(data)};
+
+    float samples[max_samples];
+    float_buffer_t sample_buf = {.data = samples, .capacity = max_samples, .size = 0};
+    int sample_count = md_tx_process(&tx, &frame_buf, &sample_buf, NULL);
+    assert_true(sample_count > 0, "modulation successful");
+    assert_true(!md_multi_rx_dcd(&mrx), "no carrier before signal");
+
+    // Feed only the first half of the frame, DCD has to be up mid-packet
+    uint8_t decoded[MD_RX_FRAME_MAX];
+    buffer_t decoded_buf = {.data = decoded, .capacity = sizeof(decoded), .size = 0};
+    float_buffer_t half_buf = {.data = samples, .capacity = sample_count / 2, .size = sample_count / 2};
+    md_multi_rx_process(&mrx, &half_buf, &decoded_buf);
+    assert_true(md_multi_rx_dcd(&mrx), "carrier detected mid-packet");
+
+    // Noise after the frame releases it
+    float noise[4096];
+    for (int i = 0; i < 4096; i++)
+        noise[i] = awgn(0.3f);
+    float_buffer_t noise_buf = {.data = noise, .capacity = 4096, .size = 4096};
+    for (int i = 0; i < 5; i++)
+        md_multi_rx_process(&mrx, &noise_buf, &decoded_buf);
+    assert_true(!md_multi_rx_dcd(&mrx), "carrier released on noise");
+
+    md_tx_free(&tx);
+    md_multi_rx_free(&mrx);
+}
+
+void test_modem_multi_rx_decimated()
+{
+    const float sample_rate = 48000.0f;
+    const int max_samples = test_modem_max_samples(sample_rate, 2.0f);
+    const int max_frame = 256;
+
+    assert_equal_int(md_multi_rx_decimation(48000.0f), 2, "48 kHz decimates by 2");
+    assert_equal_int(md_multi_rx_decimation(22050.0f), 1, "22.05 kHz is not decimated");
+
+    struct md_multi_rx mrx;
+    md_multi_rx_init_decimated(&mrx, sample_rate, DEMOD_ALL, md_multi_rx_decimation(sample_rate));
+
+    struct md_tx tx;
+    md_tx_init(&tx, sample_rate, tx_delay, tx_tail);
+
+    ax25_packet_t packet;
+    test_modem_create_aprs_packet(&packet, "XX0TST", "APN001", "!5221.20N/02043.85E# DECIMATED");
+
+    uint8_t packed_data[max_frame];
+    buffer_t packed_buf = {.data = packed_data, .capacity = sizeof(packed_data), .size = 0};
+    ax25_packet_pack(&packet, &packed_buf);
+
+    float samples[max_samples];
+    float_buffer_t sample_buf = {.data = samples, .capacity = max_samples, .size = 0};
+    md_tx_process(&tx, &packed_buf, &sample_buf, NULL);
+
+    uint8_t decoded[max_frame];
+    buffer_t decoded_buf = {.data = decoded, .capacity = sizeof(decoded), .size = 0};
+    int decoded_len = md_multi_rx_process(&mrx, &sample_buf, &decoded_buf);
+
+    assert_true(decoded_len > 0, "decimated multi-rx demodulation successful");
+    assert_equal_int(decoded_buf.size, packed_buf.size, "decimated decoded length matches original");
+    assert_memory(decoded, packed_data, packed_buf.size, "decimated decoded data matches original");
+    assert_true(mrx.frame_pos > (uint64_t)sample_buf.size / 2 && mrx.frame_pos <= (uint64_t)sample_buf.size,
+                "frame position in input samples");
+
+    md_tx_free(&tx);
+    md_multi_rx_free(&mrx);
+}
+
+void test_modem_multi_rx_shared_front()
+{
+    struct md_multi_rx mrx;
+    test_modem_init_multi(&mrx, 22050.0f, DEMOD_ALL);
+
+    assert_equal_int(mrx.count, 3, "multi-rx count");
+    assert_equal_int(mrx.grz_front_src[0], 0, "optim owns its goertzel front-end");
+    assert_equal_int(mrx.grz_front_src[1], 0, "pesim shares optim goertzel front-end");
+    assert_equal_int(mrx.grz_front_src[2], -1, "quadrature has no goertzel front-end");
+
+    md_multi_rx_free(&mrx);
+}
+
 void test_modem_multi_rx_mixed_packets()
 {
     const float sample_rate = 22050.0f;
@@ -568,6 +690,359 @@ void test_modem_multi_rx_mixed_packets()
     md_multi_rx_free(&mrx);
 }
 
+void test_modem_multi_rx_threaded()
+{
+    const float sample_rate = 22050.0f;
+    const int max_samples = test_modem_max_samples(sample_rate, 4.0f);
+    const int max_frame = 256;
+    const int chunk = 4800;
+
+    struct md_multi_rx mrx;
+    test_modem_init_multi(&mrx, sample_rate, DEMOD_ALL);
+    assert_equal_int(md_multi_rx_start_workers(&mrx), 0, "workers started");
+    assert_equal_int(mrx.worker_count, 2, "goertzel chains share a worker");
+
+    struct md_tx tx;
+    md_tx_init(&tx, sample_rate, tx_delay, tx_tail);
+
+    ax25_packet_t packet1, packet2;
+    test_modem_create_aprs_packet(&packet1, "SRC1", "DST1", "Packet 1");
+    test_modem_create_aprs_packet(&packet2, "SRC2", "DST2", "Packet 2");
+
+    uint8_t packed1[max_frame], packed2[max_frame];
+    buffer_t packed1_buf = {.data = packed1, .capacity = max_frame, .size = 0};
+    buffer_t packed2_buf = {.data = packed2, .capacity = max_frame, .size = 0};
+    ax25_packet_pack(&packet1, &packed1_buf);
+    ax25_packet_pack(&packet2, &packed2_buf);
+
+    float samples[max_samples];
+    float_buffer_t sample_buf = {.data = samples, .capacity = max_samples, .size = 0};
+    md_tx_process(&tx, &packed1_buf, &sample_buf, NULL);
+
+    int silence_start = sample_buf.size;
+    int silence_samples = test_modem_max_samples(sample_rate, 0.5f);
+    memset(samples + silence_start, 0, silence_samples * sizeof(float));
+
+    float_buffer_t temp_buf = {.data = samples + silence_start + silence_samples,
+                               .capacity = max_samples - silence_start - silence_samples,
+                               .size = 0};
+    md_tx_process(&tx, &packed2_buf, &temp_buf, NULL);
+    int total_samples = silence_start + silence_samples + temp_buf.size;
+
+    for (int offset = 0; offset < total_samples; offset += chunk)
+    {
+        int n = total_samples - offset < chunk ? total_samples - offset : chunk;
+        float_buffer_t chunk_buf = {.data = samples + offset, .capacity = n, .size = n};
+        md_multi_rx_submit(&mrx, &chunk_buf);
+    }
+    md_multi_rx_flush(&mrx);
+
+    uint8_t decoded[max_frame];
+    buffer_t decoded_buf = {.data = decoded, .capacity = max_frame, .size = 0};
+
+    int len1 = md_multi_rx_collect(&mrx, &decoded_buf);
+    assert_equal_int(len1, packed1_buf.size, "threaded first frame length");
+    assert_memory(decoded, packed1, packed1_buf.size, "threaded first frame in stream order");
+    assert_true(mrx.frame_pos <= (uint64_t)silence_start + 256, "first frame position before the silence");
+
+    int len2 = md_multi_rx_collect(&mrx, &decoded_buf);
+    assert_equal_int(len2, packed2_buf.size, "threaded second frame length");
+    assert_memory(decoded, packed2, packed2_buf.size, "threaded second frame in stream order");
+    assert_true(mrx.frame_pos > (uint64_t)(silence_start + silence_samples), "second frame position after the silence");
+
+    assert_equal_int(md_multi_rx_collect(&mrx, &decoded_buf), 0, "duplicates from other chains dropped");
+
+    md_tx_free(&tx);
+    md_multi_rx_free(&mrx);
+    assert_true(mrx.workers == NULL, "workers stopped on free");
+}
+
+void test_modem_multi_rx_threaded_time()
+{
+    const float sample_rate = 22050.0f;
+    const int max_samples = test_modem_max_samples(sample_rate, 4.0f);
+    const int max_frame = 256;
+    const time_t sim_time = 1000;
+
+    struct md_multi_rx mrx;
+    test_modem_init_multi(&mrx, sample_rate, DEMOD_ALL);
+    assert_equal_int(md_multi_rx_start_workers(&mrx), 0, "workers started");
+
+    struct md_tx tx;
+    md_tx_init(&tx, sample_rate, tx_delay, tx_tail);
+
+    ax25_packet_t packet1, packet2;
+    test_modem_create_aprs_packet(&packet1, "SRC1", "DST1", "Packet 1");
+    test_modem_create_aprs_packet(&packet2, "SRC2", "DST2", "Packet 2");
+
+    uint8_t packed1[max_frame], packed2[max_frame];
+    buffer_t packed1_buf = {.data = packed1, .capacity = max_frame, .size = 0};
+    buffer_t packed2_buf = {.data = packed2, .capacity = max_frame, .size = 0};
+    ax25_packet_pack(&packet1, &packed1_buf);
+    ax25_packet_pack(&packet2, &packed2_buf);
+
+    float samples[max_samples];
+    float_buffer_t sample_buf = {.data = samples, .capacity = max_samples, .size = 0};
+    uint16_t crc1;
+    md_tx_process(&tx, &packed1_buf, &sample_buf, &crc1);
+    float_buffer_t temp_buf = {.data = samples + sample_buf.size, .capacity = max_samples - sample_buf.size, .size = 0};
+    md_tx_process(&tx, &packed2_buf, &temp_buf, NULL);
+    sample_buf.size += temp_buf.size;
+
+    // An echo is only recognized if frames carry the submit time rather than the wall clock
+    md_multi_rx_expect_echo(&mrx, crc1, sim_time);
+    md_multi_rx_submit_at(&mrx, &sample_buf, sim_time);
+    md_multi_rx_flush(&mrx);
+
+    uint8_t decoded[max_frame];
+    buffer_t decoded_buf = {.data = decoded, .capacity = max_frame, .size = 0};
+    int len = md_multi_rx_collect(&mrx, &decoded_buf);
+    assert_equal_int(len, packed2_buf.size, "echo stamped with submit time suppressed");
+    assert_memory(decoded, packed2, packed2_buf.size, "other frame collected");
+    assert_equal_int(md_multi_rx_collect(&mrx, &decoded_buf), 0, "no more frames");
+
+    md_tx_free(&tx);
+    md_multi_rx_free(&mrx);
+}
+
+void test_modem_mod_exact_baud(float sample_rate)
+{
+    modulator_t mod;
+    mod_init(&mod, 2200.0f, 1200.0f, 1200.0f, sample_rate);
+
+    const int bit_count = 1200;
+    uint64_t words[BITARR_WORDS(1200)];
+    bitarr_t bits;
+    bitarr_init(&bits, words, bit_count);
+    for (int i = 0; i < bit_count; i++)
+        bitarr_append(&bits, (i * 7) % 3 == 0);
+
+    static float samples[48000];
+    float_buffer_t sample_buf = {.data = samples, .capacity = sizeof(samples) / sizeof(float), .size = 0};
+
+    // One second worth of bits in ragged chunks must still be exactly one second of samples
+    int written = 0;
+    for (int off = 0, chunk = 1; off < bit_count; off += chunk, chunk = chunk % 13 + 1)
+    {
+        int n = off + chunk > bit_count ? bit_count - off : chunk;
+        written += mod_process(&mod, &bits, off, n, &sample_buf);
+    }
+    assert_equal_int(written, (int)sample_rate, "one second of bits yields sample_rate samples");
+    assert_equal_int(sample_buf.size, (int)sample_rate, "buffer size matches");
+
+    float max_step = 0.0f;
+    for (int i = 1; i < sample_buf.size; i++)
+        max_step = fmaxf(max_step, fabsf(samples[i] - samples[i - 1]));
+    float bound = 2.0f * sinf(M_PI * 2200.0f / sample_rate) + 1e-3f;
+    assert_true(max_step <= bound, "phase continuous across bits and calls");
+
+    float_buffer_t small_buf = {.data = samples, .capacity = 10, .size = 0};
+    assert_equal_int(mod_process(&mod, &bits, 0, 8, &small_buf), -1, "rejects output that does not fit");
+    assert_equal_int(small_buf.size, 0, "no partial output");
+
+    mod_free(&mod);
+}
+
+void test_modem_mod_matches_sine()
+{
+    modulator_t mod;
+    mod_init(&mod, 2200.0f, 1200.0f, 1200.0f, 44100.0f);
+
+    uint8_t ones[4] = {1, 1, 1, 1};
+    uint64_t words[1];
+    bitarr_t bits;
+    bitarr_init(&bits, words, 64);
+    bitarr_append_bytes(&bits, ones, 4);
+    float samples[256];
+    float_buffer_t sample_buf = {.data = samples, .capacity = 256, .size = 0};
+    int n = mod_process(&mod, &bits, 0, 4, &sample_buf);
+    assert_equal_int(n, 147, "four bits at 44100 Hz are 147 samples");
+
+    float max_err = 0.0f;
+    for (int i = 0; i < n; i++)
+        max_err = fmaxf(max_err, fabsf(samples[i] - sinf(2.0f * M_PI * 2200.0f * i / 44100.0f)));
+    assert_true(max_err < 1e-4f, "interpolated LUT tracks sinf");
+
+    mod_free(&mod);
+}
+
+void test_modem_tx_streaming(float sample_rate)
+{
+    struct md_tx batch_tx, stream_tx;
+    md_tx_init(&batch_tx, sample_rate, tx_delay, tx_tail);
+    md_tx_init(&stream_tx, sample_rate, tx_delay, tx_tail);
+
+    uint8_t data[128];
+    test_modem_generate_random_ascii(data, sizeof(data), 7);
+    buffer_t frame_buf = {.data = data, .capacity = sizeof(data), .size = sizeof(data)};
+
+    const int max_samples = test_modem_max_samples(sample_rate, 2.0f);
+    float batch[max_samples];
+    float stream[max_samples];
+    float_buffer_t batch_buf = {.data = batch, .capacity = max_samples, .size = 0};
+    float_buffer_t stream_buf = {.data = stream, .capacity = max_samples, .size = 0};
+
+    int batch_count = md_tx_process(&batch_tx, &frame_buf, &batch_buf, NULL);
+    assert_equal_int(md_tx_queue(&stream_tx, &frame_buf), 0, "frame waits for keyup");
+    assert_equal_int(md_tx_pending(&stream_tx), 0, "nothing on air before the burst starts");
+    int bits = md_tx_begin_burst(&stream_tx);
+    assert_true(bits > 0, "burst started");
+    assert_equal_int(md_tx_backlog(&stream_tx), 0, "backlog taken into the burst");
+
+    // Period-sized pulls, as the playback path does
+    int pulls = 0;
+    while (md_tx_pending(&stream_tx) > 0 && pulls++ < 10000)
+        md_tx_render(&stream_tx, &stream_buf, 441);
+    assert_equal_int(stream_buf.size, batch_count, "streamed sample count matches batch");
+
+    int mismatches = 0;
+    for (int i = 0; i < batch_count && i < stream_buf.size; i++)
+        if (fabsf(stream[i] - batch[i]) > 1e-6f)
+            mismatches++;
+    assert_equal_int(mismatches, 0, "streamed samples match batch");
+    assert_equal_int(md_tx_render(&stream_tx, &stream_buf, 441), 0, "nothing left to render");
+
+    int queued = 0;
+    while (md_tx_queue(&stream_tx, &frame_buf) >= 0)
+        queued++;
+    assert_equal_int(queued, MD_TX_BACKLOG_MAX, "backlog bounded, overflow rejected");
+
+    md_tx_free(&batch_tx);
+    md_tx_free(&stream_tx);
+}
+
+static int test_modem_count_frames(struct md_rx *rx, const float_buffer_t *sample_buf)
+{
+    uint8_t decoded[MD_RX_FRAME_MAX];
+    int frames = 0;
+    for (int off = 0; off < sample_buf->size; off += 256)
+    {
+        int n = sample_buf->size - off < 256 ? sample_buf->size - off : 256;
+        float_buffer_t chunk = {.data = sample_buf->data + off, .capacity = n, .size = n};
+        buffer_t decoded_buf = {.data = decoded, .capacity = sizeof(decoded), .size = 0};
+        if (md_rx_process(rx, &chunk, &decoded_buf, NULL) > 0)
+            frames++;
+    }
+    return frames;
+}
+
+void test_modem_tx_burst()
+{
+    const float sample_rate = 22050.0f;
+    const int max_samples = test_modem_max_samples(sample_rate, 4.0f);
+
+    struct md_tx tx;
+    struct md_rx rx;
+    md_tx_init(&tx, sample_rate, 300.0f, tx_tail);
+    md_rx_init(&rx, sample_rate, DEMOD_GOERTZEL_OPTIM);
+
+    uint8_t data[3][48];
+    for (int i = 0; i < 3; i++)
+    {
+        test_modem_generate_random_ascii(data[i], sizeof(data[i]), 11 + i);
+        buffer_t frame_buf = {.data = data[i], .capacity = sizeof(data[i]), .size = sizeof(data[i])};
+        md_tx_queue(&tx, &frame_buf);
+    }
+    assert_equal_int(md_tx_backlog(&tx), 3, "three frames waiting");
+    md_tx_begin_burst(&tx);
+    assert_equal_int(md_tx_backlog(&tx), 0, "all frames in one burst");
+
+    float *samples = malloc(max_samples * sizeof(float));
+    float_buffer_t sample_buf = {.data = samples, .capacity = max_samples, .size = 0};
+    while (md_tx_pending(&tx) > 0)
+        md_tx_render(&tx, &sample_buf, 1024);
+
+    // One 300 ms preamble instead of three
+    int single_frame = (int)(sample_rate * (0.3f + (48 + 2 + 2) * 8 / 1200.0f));
+    assert_true(sample_buf.size < 3 * single_frame - (int)(sample_rate * 0.5f), "preamble sent once");
+    assert_equal_int(test_modem_count_frames(&rx, &sample_buf), 3, "all burst frames decode");
+
+    // A frame arriving while the burst is still being rendered joins it
+    md_tx_init(&tx, sample_rate, 300.0f, tx_tail);
+    buffer_t frame_buf = {.data = data[0], .capacity = sizeof(data[0]), .size = sizeof(data[0])};
+    md_tx_queue(&tx, &frame_buf);
+    md_tx_begin_burst(&tx);
+    sample_buf.size = 0;
+    md_tx_render(&tx, &sample_buf, 2048);
+    assert_equal_int(md_tx_queue(&tx, &frame_buf), 1, "frame joins open burst");
+    while (md_tx_pending(&tx) > 0)
+        md_tx_render(&tx, &sample_buf, 1024);
+    md_rx_init(&rx, sample_rate, DEMOD_GOERTZEL_OPTIM);
+    assert_equal_int(test_modem_count_frames(&rx, &sample_buf), 2, "joined frame decodes");
+    assert_equal_int(md_tx_queue(&tx, &frame_buf), 0, "closed burst sends later frames to the backlog");
+
+    // Keyup limit splits the backlog into several bursts
+    md_tx_init(&tx, sample_rate, 300.0f, tx_tail);
+    md_tx_set_burst_limit(&tx, 1100.0f);
+    for (int i = 0; i < 3; i++)
+        md_tx_queue(&tx, &frame_buf);
+    md_tx_begin_burst(&tx);
+    assert_equal_int(md_tx_backlog(&tx), 1, "limit leaves a frame for the next keyup");
+
+    free(samples);
+    md_tx_free(&tx);
+    md_rx_free(&rx);
+}
+
+static int test_modem_demodulate_chunks(modem_t *modem, const float_buffer_t *sample_buf)
+{
+    int frames = 0;
+    uint8_t decoded[MD_RX_FRAME_MAX];
+    for (int off = 0; off < sample_buf->size; off += 1024)
+    {
+        int n = sample_buf->size - off < 1024 ? sample_buf->size - off : 1024;
+        float_buffer_t chunk = {.data = sample_buf->data + off, .capacity = n, .size = n};
+        buffer_t decoded_buf = {.data = decoded, .capacity = sizeof(decoded), .size = 0};
+        if (modem_demodulate(modem, &chunk, &decoded_buf) > 0)
+            frames++;
+    }
+    return frames;
+}
+
+void test_modem_tx_echo()
+{
+    const float sample_rate = 22050.0f;
+    const int max_samples = test_modem_max_samples(sample_rate, 4.0f);
+    const int burst_frames = 3;
+
+    // A single chain, so every suppressed frame is an echo rather than another chain's duplicate
+    modem_t modem;
+    modem_params_t params = {
+        .sample_rate = sample_rate,
+        .types = DEMOD_GOERTZEL_OPTIM,
+        .tx_delay = 300.0f,
+        .tx_tail = tx_tail};
+    modem_init(&modem, &params);
+    modem.mrx.duplicates = metrics_counter("test_modem_echo_duplicates_total", "Test echo duplicates", NULL);
+
+    uint8_t data[3][48];
+    for (int i = 0; i < burst_frames; i++)
+    {
+        test_modem_generate_random_ascii(data[i], sizeof(data[i]), 21 + i);
+        buffer_t frame_buf = {.data = data[i], .capacity = sizeof(data[i]), .size = sizeof(data[i])};
+        modem_tx_queue(&modem, &frame_buf);
+    }
+    modem_tx_begin_burst(&modem);
+
+    float *samples = malloc(max_samples * sizeof(float));
+    float_buffer_t sample_buf = {.data = samples, .capacity = max_samples, .size = 0};
+    while (modem_tx_pending(&modem))
+        modem_tx_render(&modem, &sample_buf, 1024);
+
+    // Control: a receiver that did not transmit decodes the whole burst
+    modem_t control;
+    modem_init(&control, &params);
+    assert_equal_int(test_modem_demodulate_chunks(&control, &sample_buf), burst_frames, "burst decodes without echo");
+    modem_free(&control);
+
+    // Every frame of the burst, not only the last, is recognized as our own
+    assert_equal_int(test_modem_demodulate_chunks(&modem, &sample_buf), 0, "own burst frames suppressed");
+    assert_equal_int((int)metrics_value(modem.mrx.duplicates), burst_frames, "every burst frame counted as echo");
+
+    free(samples);
+    modem_free(&modem);
+}
+
 void test_modem_highlevel_init_free()
 {
     modem_t modem;
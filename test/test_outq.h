@@ -0,0 +1,87 @@
+#ifndef TEST_OUTQ_H
+#define TEST_OUTQ_H
+
+#include "test.h"
+#include "outq.h"
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+
+static int outq_fill(outq_t *q, uint8_t tag)
+{
+    uint8_t msg[1000];
+    memset(msg, tag, sizeof(msg));
+    return outq_push(q, msg, sizeof(msg));
+}
+
+void test_outq_overflow_policies()
+{
+    static outq_t q;
+
+    outq_init(&q, OUTQ_DROP_OLDEST);
+    for (int i = 0; i < 10; i++)
+        outq_fill(&q, i);
+    assert_equal_int(q.msg_count, 8, "drop-oldest keeps what fits");
+    assert_equal_int((int)q.dropped, 2, "drop-oldest counts drops");
+    assert_equal_int(q.data[q.head], 2, "oldest messages went first");
+
+    outq_init(&q, OUTQ_DROP_NEWEST);
+    for (int i = 0; i < 10; i++)
+        outq_fill(&q, i);
+    assert_equal_int(q.msg_count, 8, "drop-newest keeps what fits");
+    assert_equal_int(q.data[q.head], 0, "queued messages kept");
+    assert_equal_int(outq_fill(&q, 10), -1, "new message rejected");
+
+    outq_init(&q, OUTQ_DISCONNECT);
+    int ret = 0;
+    for (int i = 0; i < 9; i++)
+        ret = outq_fill(&q, i);
+    assert_equal_int(ret, -1, "disconnect reports overflow");
+
+    assert_equal_int(outq_policy_parse("drop-newest"), OUTQ_DROP_NEWEST, "policy parsed");
+    assert_equal_int(outq_policy_parse("bogus"), -1, "unknown policy rejected");
+}
+
+void test_outq_flush_partial()
+{
+    static outq_t q;
+    outq_init(&q, OUTQ_DROP_OLDEST);
+
+    int sv[2];
+    assert_equal_int(socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0, "socketpair");
+    int sndbuf = 1024;
+    setsockopt(sv[0], SOL_SOCKET, SO_SNDBUF, &sndbuf, sizeof(sndbuf));
+
+    // Enough to stall the socket, the rest stays queued and the head is left partially written
+    for (int i = 0; i < 8; i++)
+        outq_fill(&q, i + 1);
+    int left = outq_flush(&q, sv[0]);
+    assert_true(left > 0, "flush stops when the socket is full");
+
+    // New messages cannot evict one already on the wire
+    int partial = q.head_sent > 0;
+    outq_fill(&q, 9);
+
+    static uint8_t got[16384];
+    int total = 0;
+    while (left > 0)
+    {
+        total += read(sv[1], got + total, sizeof(got) - total);
+        left = outq_flush(&q, sv[0]);
+    }
+    assert_equal_int(left, 0, "queue drained");
+    while (total % 1000 != 0)
+        total += read(sv[1], got + total, sizeof(got) - total);
+
+    int torn = 0;
+    for (int i = 0; i < total; i += 1000)
+        for (int j = 1; j < 1000; j++)
+            torn += got[i + j] != got[i];
+    assert_equal_int(torn, 0, "messages arrive whole");
+    assert_true(!partial || got[0] == 1, "partially sent head kept");
+
+    close(sv[0]);
+    close(sv[1]);
+}
+
+#endif
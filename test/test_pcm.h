@@ -0,0 +1,90 @@
+#ifndef TEST_PCM_H
+#define TEST_PCM_H
+
+#include "test.h"
+#include "pcm.h"
+#include <stdint.h>
+#include <math.h>
+
+void test_pcm_s16_endianness()
+{
+    const uint8_t le[] = {0x00, 0x40, 0x00, 0x80, 0xff, 0x7f};
+    const uint8_t be[] = {0x40, 0x00, 0x80, 0x00, 0x7f, 0xff};
+    float out_le[3], out_be[3];
+    pcm_codec_t codec;
+
+    pcm_codec_init(&codec, PCM_FORMAT_S16, true);
+    assert_equal_int(codec.sample_bytes, 2, "s16 sample bytes");
+    pcm_to_float(&codec, le, out_le, 3);
+    pcm_codec_init(&codec, PCM_FORMAT_S16, false);
+    pcm_to_float(&codec, be, out_be, 3);
+
+    assert_equal_float(out_le[0], 0.5f, "s16 le half scale");
+    assert_equal_float(out_le[1], -1.0f, "s16 le negative full scale");
+    assert_memory(out_le, out_be, sizeof(out_le), "s16 be matches le");
+}
+
+void test_pcm_s24_sign_extension()
+{
+    const uint8_t packed[] = {0x00, 0x00, 0xc0, 0x00, 0x00, 0x40};
+    const uint8_t padded[] = {0x00, 0x00, 0xc0, 0x00, 0x00, 0x00, 0x40, 0x00};
+    float out_packed[2], out_padded[2];
+    pcm_codec_t codec;
+
+    pcm_codec_init(&codec, PCM_FORMAT_S24_3, true);
+    assert_equal_int(codec.sample_bytes, 3, "s24_3 sample bytes");
+    pcm_to_float(&codec, packed, out_packed, 2);
+    pcm_codec_init(&codec, PCM_FORMAT_S24, true);
+    pcm_to_float(&codec, padded, out_padded, 2);
+
+    assert_equal_float(out_packed[0], -0.5f, "s24_3 negative");
+    assert_equal_float(out_packed[1], 0.5f, "s24_3 positive");
+    assert_memory(out_packed, out_padded, sizeof(out_packed), "s24 matches s24_3");
+}
+
+void test_pcm_round_trip()
+{
+    const pcm_format_t formats[] = {PCM_FORMAT_F32, PCM_FORMAT_S16, PCM_FORMAT_S24_3, PCM_FORMAT_S24, PCM_FORMAT_S32};
+    const float in[] = {0.0f, 0.25f, -0.75f, 0.999f, -0.999f, 1.5f};
+    uint8_t raw[sizeof(in)];
+    float out[6];
+
+    for (int f = 0; f < 5; f++)
+    {
+        for (int le = 0; le < 2; le++)
+        {
+            pcm_codec_t codec;
+            pcm_codec_init(&codec, formats[f], le);
+            assert_equal_int(pcm_from_float(&codec, in, raw, 6), 0, "encode supported");
+            pcm_to_float(&codec, raw, out, 6);
+
+            int ok = 1;
+            for (int i = 0; i < 6; i++)
+            {
+                float expected = in[i] > 1.0f ? 1.0f : in[i];
+                ok &= fabsf(out[i] - expected) < 1e-4f;
+            }
+            assert_true(ok, pcm_format_name(formats[f]));
+        }
+    }
+
+    pcm_codec_t codec;
+    pcm_codec_init(&codec, PCM_FORMAT_U16, true);
+    assert_equal_int(pcm_from_float(&codec, in, raw, 6), -1, "unsigned encode unsupported");
+}
+
+void test_pcm_s32_full_scale()
+{
+    const float in[] = {1.0f, -1.0f, 2.0f, 0.5f};
+    int32_t out[4];
+    pcm_codec_t codec;
+
+    pcm_codec_init(&codec, PCM_FORMAT_S32, true);
+    assert_equal_int(pcm_from_float(&codec, in, out, 4), 0, "s32 encode supported");
+    assert_true(out[0] == INT32_MAX, "s32 positive full scale does not wrap");
+    assert_true(out[1] == INT32_MIN, "s32 negative full scale");
+    assert_true(out[2] == INT32_MAX, "s32 clipped");
+    assert_true(out[3] == 1 << 30, "s32 half scale");
+}
+
+#endif
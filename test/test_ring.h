@@ -81,6 +81,39 @@ void test_ring_wrap(void)
     ring_destroy(ring);
 }
 
+void test_ring_queue_push_pop(void)
+{
+    typedef struct
+    {
+        int id;
+        char tag[6];
+    } item_t;
+
+    ring_queue_t *queue = NULL;
+    assert_equal_int(ring_queue_init(&queue, 2, sizeof(item_t)), RING_SUCCESS, "queue init success");
+
+    item_t out;
+    assert_equal_int(ring_queue_pop(queue, &out), -1, "pop empty fails");
+
+    for (int round = 0; round < 3; round++)
+    {
+        item_t a = {.id = round * 2, .tag = "first"};
+        item_t b = {.id = round * 2 + 1, .tag = "last"};
+        assert_equal_int(ring_queue_push(queue, &a), 0, "push a");
+        assert_equal_int(ring_queue_push(queue, &b), 0, "push b");
+        assert_equal_int(ring_queue_push(queue, &a), -1, "push full fails");
+        assert_equal_int((int)ring_queue_count(queue), 2, "count full");
+
+        assert_equal_int(ring_queue_pop(queue, &out), 0, "pop a");
+        assert_equal_int(out.id, a.id, "pop a id");
+        assert_memory(out.tag, a.tag, sizeof(a.tag), "pop a tag");
+        assert_equal_int(ring_queue_pop(queue, &out), 0, "pop b");
+        assert_equal_int(out.id, b.id, "pop b id");
+    }
+
+    ring_queue_destroy(queue);
+}
+
 void test_ring_shift1_empty(void)
 {
     ring_simple_t ring;
@@ -0,0 +1,24 @@
+#ifndef TEST_TSTAMP_H
+#define TEST_TSTAMP_H
+
+#include "test.h"
+#include "tstamp.h"
+
+void test_tstamp_map()
+{
+    tstamp_map_t map;
+    tstamp_map_init(&map, 1000.0f);
+    assert_equal_int((int)tstamp_map_time(&map, 10), 0, "no anchors, unknown time");
+
+    // Blocks of 100 samples, the second one captured 50 ms late
+    tstamp_map_add(&map, 0, 1000000000);
+    tstamp_map_add(&map, 100, 1150000000);
+    assert_equal_int((int)(tstamp_map_time(&map, 50) - 1000000000), 50000000, "within the first block");
+    assert_equal_int((int)(tstamp_map_time(&map, 120) - 1000000000), 170000000, "nearest earlier anchor used");
+
+    for (int i = 2; i < TSTAMP_ANCHORS + 2; i++)
+        tstamp_map_add(&map, i * 100, 1150000000 + (int64_t)(i - 1) * 100000000);
+    assert_equal_int((int)(tstamp_map_time(&map, 150) - 1000000000), 200000000, "older than every anchor extrapolated");
+}
+
+#endif